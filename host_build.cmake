@@ -0,0 +1,406 @@
+# Host (Linux) build of the examples
+#
+#   cmake -S . -B build-host -DPRESTO_HOST_BUILD=ON
+#
+# PicoPlusPsram is backed by a heap region managed by lwmem, ST7701Cached,
+# the FT6236 i2c bus, FatFs and the Pico SDK calls used by the examples are replaced
+# by the stand-ins in src/host. See src/host/HostSim.h for the environment
+# variables that control frame count, frame dumps and touch replay.
+
+project(presto-cached-examples C CXX)
+set(CMAKE_C_STANDARD 11)
+set(CMAKE_CXX_STANDARD 17)
+
+if (NOT PIMORONI_PRESTO_PATH)
+    set(PIMORONI_PRESTO_PATH ../../presto/)
+endif()
+if(NOT IS_ABSOLUTE ${PIMORONI_PRESTO_PATH})
+    get_filename_component(
+        PIMORONI_PRESTO_PATH
+        "${CMAKE_CURRENT_BINARY_DIR}/${PIMORONI_PRESTO_PATH}"
+        ABSOLUTE)
+endif()
+message("PIMORONI_PRESTO_PATH is ${PIMORONI_PRESTO_PATH}")
+
+# The stand-ins must be found before the headers they replace
+set(PRESTO_HOST_PATH ${CMAKE_CURRENT_LIST_DIR}/src/host)
+include_directories(BEFORE ${PRESTO_HOST_PATH})
+include_directories(${PIMORONI_PICO_PATH} ${PIMORONI_PRESTO_PATH})
+list(APPEND CMAKE_MODULE_PATH ${PIMORONI_PICO_PATH})
+
+include_directories(${CMAKE_CURRENT_LIST_DIR}/uzlib/src)
+
+# The parts of uzlib AssetLoader uses to inflate zlib streams
+add_library(uzlib INTERFACE)
+target_sources(uzlib INTERFACE
+    ${CMAKE_CURRENT_LIST_DIR}/uzlib/src/tinflate.c
+    ${CMAKE_CURRENT_LIST_DIR}/uzlib/src/tinfzlib.c
+    ${CMAKE_CURRENT_LIST_DIR}/uzlib/src/adler32.c
+    ${CMAKE_CURRENT_LIST_DIR}/uzlib/src/crc32.c
+)
+
+# Stand-ins for the Pico SDK and Presto libraries the examples link
+add_library(pico_stdlib INTERFACE)
+target_sources(pico_stdlib INTERFACE ${PRESTO_HOST_PATH}/HostSim.cpp)
+target_include_directories(pico_stdlib INTERFACE ${PRESTO_HOST_PATH} ${CMAKE_CURRENT_LIST_DIR}/src)
+target_compile_definitions(pico_stdlib INTERFACE PRESTO_HOST=1)
+
+foreach(STAND_IN st7701_presto pico_multicore pimoroni_i2c hardware_interp hardware_dma)
+    add_library(${STAND_IN} INTERFACE)
+    target_link_libraries(${STAND_IN} INTERFACE pico_stdlib)
+endforeach()
+
+# Core 1 runs on a thread
+find_package(Threads REQUIRED)
+target_link_libraries(pico_multicore INTERFACE Threads::Threads)
+
+add_subdirectory(lwmem)
+
+include(libraries/pico_graphics/pico_graphics)
+
+
+######################################
+# Single Psram buffer 480x480
+######################################
+
+add_executable(SinglePsramBuffer480x480
+    src/SinglePsramBuffer480x480.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/FT6236.cpp
+    src/BeamRacer.cpp
+    src/DisplayList.cpp
+    src/TouchPredictor.cpp
+)
+
+target_link_libraries(SinglePsramBuffer480x480
+    st7701_presto
+    pico_stdlib
+    pico_multicore
+    pimoroni_i2c
+    hardware_interp
+    pico_graphics
+    lwmem
+)
+
+
+######################################
+# Double Psram buffer 480x480
+######################################
+
+add_executable(DoublePsramBuffer480x480
+    src/DoublePsramBuffer480x480.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/FT6236.cpp
+    src/PsramArena.cpp
+    src/ParticleSystem.cpp
+    src/StripRenderer.cpp
+    src/SplitRenderer.cpp
+    src/DisplayList.cpp
+    src/FrameScheduler.cpp
+    src/host/PsramDmaHost.cpp
+)
+
+target_link_libraries(DoublePsramBuffer480x480
+    st7701_presto
+    pico_stdlib
+    pico_multicore
+    pimoroni_i2c
+    hardware_interp
+    hardware_dma
+    pico_graphics
+    lwmem
+)
+
+
+######################################
+# Triple Psram buffer 480x480
+######################################
+
+add_executable(TriplePsramBuffer480x480
+    src/TriplePsramBuffer480x480.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/FT6236.cpp
+    src/PsramArena.cpp
+    src/ParticleSystem.cpp
+    src/host/PsramDmaHost.cpp
+)
+
+target_link_libraries(TriplePsramBuffer480x480
+    st7701_presto
+    pico_stdlib
+    pico_multicore
+    pimoroni_i2c
+    hardware_interp
+    hardware_dma
+    pico_graphics
+    lwmem
+)
+
+
+######################################
+# Paletted Psram buffer 480x480
+######################################
+
+add_executable(PalettedPsramBuffer480x480
+    src/PalettedPsramBuffer480x480.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/FT6236.cpp
+    src/PaletteExpander.cpp
+    src/ParticleSystem.cpp
+    src/host/PsramDmaHost.cpp
+)
+
+target_link_libraries(PalettedPsramBuffer480x480
+    st7701_presto
+    pico_stdlib
+    pico_multicore
+    pimoroni_i2c
+    hardware_interp
+    hardware_dma
+    pico_graphics
+    lwmem
+)
+
+
+######################################
+# Low resolution Psram buffer 480x480
+######################################
+
+add_executable(LowResPsramBuffer480x480
+    src/LowResPsramBuffer480x480.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/FT6236.cpp
+    src/Upscaler.cpp
+    src/ParticleSystem.cpp
+    src/host/PsramDmaHost.cpp
+)
+
+target_link_libraries(LowResPsramBuffer480x480
+    st7701_presto
+    pico_stdlib
+    pico_multicore
+    pimoroni_i2c
+    hardware_interp
+    hardware_dma
+    pico_graphics
+    lwmem
+)
+
+
+######################################
+# Slab allocator benchmark
+######################################
+
+add_executable(SlabBenchmark
+    src/SlabBenchmark.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/PsramSlab.cpp
+    src/PsramTrace.cpp
+)
+
+target_link_libraries(SlabBenchmark
+    pico_stdlib
+    lwmem
+)
+
+
+######################################
+# Particle system benchmark
+######################################
+
+add_executable(ParticleBenchmark
+    src/ParticleBenchmark.cpp 
+    src/ParticleSystem.cpp
+)
+
+target_link_libraries(ParticleBenchmark
+    pico_stdlib
+)
+
+
+######################################
+# Psram cached/uncached benchmark
+######################################
+
+add_executable(PsramBenchmark
+    src/PsramBenchmark.cpp 
+    src/host/PicoPlusPsramHost.cpp
+)
+
+target_link_libraries(PsramBenchmark
+    pico_stdlib
+    lwmem
+)
+
+
+######################################
+# Psram bandwidth benchmark
+######################################
+
+# Exits with 1 if a kernel leaves the wrong result
+add_executable(PsramBandwidth
+    src/PsramBandwidth.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/host/PsramDmaHost.cpp
+)
+
+target_link_libraries(PsramBandwidth
+    pico_stdlib
+    hardware_dma
+    lwmem
+)
+
+
+######################################
+# Buffered file io benchmark
+######################################
+
+# FatFs reads host files through the ff.h stand-in
+add_executable(FileBenchmark
+    src/FileBenchmark.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/BufferedFile.cpp
+    src/fileio.cpp
+    src/AssetLoader.cpp
+    src/TextureCache.cpp
+)
+
+target_include_directories(FileBenchmark PRIVATE ${PIMORONI_PICO_PATH}/libraries/pico_vector)
+
+target_link_libraries(FileBenchmark
+    pico_stdlib
+    uzlib
+    lwmem
+)
+
+
+######################################
+# Asset packer
+######################################
+
+# Packs images for AssetLoader, uses the host's zlib to compress
+find_package(ZLIB REQUIRED)
+
+add_executable(AssetPack
+    src/AssetPack.cpp 
+)
+
+target_link_libraries(AssetPack
+    pico_stdlib
+    ZLIB::ZLIB
+)
+
+
+######################################
+# Touch prediction replay
+######################################
+
+add_executable(TouchReplay
+    src/TouchReplay.cpp 
+    src/TouchPredictor.cpp
+)
+
+target_link_libraries(TouchReplay
+    pico_stdlib
+)
+
+
+######################################
+# Psram timing test
+######################################
+
+# Exits with 1 if the timing math is wrong, PsramTiming.h needs nothing else
+add_executable(PsramTimingTest
+    src/PsramTimingTest.cpp 
+)
+
+
+######################################
+# Psram arena test
+######################################
+
+# Exits with 1 if a bump, alignment, overflow or Reset() check fails
+add_executable(PsramArenaTest
+    src/PsramArenaTest.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/PsramArena.cpp
+)
+
+target_link_libraries(PsramArenaTest
+    pico_stdlib
+    lwmem
+)
+
+
+######################################
+# Asset round trip test
+######################################
+
+# Writes a PPM for AssetPack and loads what it packs back, see the tests below
+add_executable(AssetTest
+    src/AssetTest.cpp 
+    src/host/PicoPlusPsramHost.cpp
+    src/BufferedFile.cpp
+    src/fileio.cpp
+    src/AssetLoader.cpp
+    src/TextureCache.cpp
+)
+
+target_include_directories(AssetTest PRIVATE ${PIMORONI_PICO_PATH}/libraries/pico_vector)
+
+target_link_libraries(AssetTest
+    pico_stdlib
+    uzlib
+    lwmem
+)
+
+
+######################################
+# Regression tests
+######################################
+
+#   ctest --test-dir build-host --output-on-failure
+#
+# Every tool here exits with 1 if a check fails, the timings they print are not checked:
+#   PsramTimingTest   - the timing math
+#   PsramArenaTest    - bump allocation, alignment, overflow to lwmem and Reset()
+#   PsramBandwidth    - a kernel leaves the wrong result
+#   SlabBenchmark     - an allocation fails, objects overlap or memory is not given back
+#   ParticleBenchmark - the fixed point particles drift from the float ones
+#   PsramBenchmark    - a frame drawn through the cached view differs from the uncached one
+#   TouchReplay       - prediction is no closer than the last sample on the made up strokes
+#   FileBenchmark     - a fileio read sums differently from the FatFs read of the same bytes
+#   AssetTest         - a packed image does not load back pixel for pixel
+# The examples run for a few hundred frames with random touches and must exit cleanly.
+enable_testing()
+
+foreach(TOOL PsramTimingTest PsramArenaTest PsramBandwidth SlabBenchmark ParticleBenchmark PsramBenchmark TouchReplay)
+    add_test(NAME ${TOOL} COMMAND ${TOOL})
+endforeach()
+
+# Writes its test file into the build directory
+add_test(NAME FileBenchmark COMMAND FileBenchmark WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+
+# AssetTest writes an image, AssetPack packs it whole and as a sheet of frames, then
+# AssetTest loads each and compares the pixels
+add_test(NAME AssetTestWrite COMMAND AssetTest write asset_test.ppm WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+add_test(NAME AssetPackImage COMMAND AssetPack asset_test.ppm asset_test.rgz WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+add_test(NAME AssetPackSheet COMMAND AssetPack -s 16x16 asset_test.ppm asset_test_sheet.rgz WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+add_test(NAME AssetTestImage COMMAND AssetTest check asset_test.rgz WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+add_test(NAME AssetTestSheet COMMAND AssetTest check asset_test_sheet.rgz WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR})
+set_tests_properties(AssetTestWrite PROPERTIES FIXTURES_SETUP AssetPpm)
+set_tests_properties(AssetPackImage AssetPackSheet PROPERTIES FIXTURES_REQUIRED AssetPpm FIXTURES_SETUP AssetRgz)
+set_tests_properties(AssetTestImage AssetTestSheet PROPERTIES FIXTURES_REQUIRED AssetRgz)
+
+foreach(EXAMPLE SinglePsramBuffer480x480 DoublePsramBuffer480x480 TriplePsramBuffer480x480 PalettedPsramBuffer480x480 LowResPsramBuffer480x480)
+    add_test(NAME ${EXAMPLE} COMMAND ${EXAMPLE})
+    set_tests_properties(${EXAMPLE} PROPERTIES ENVIRONMENT "PRESTO_HOST_FRAMES=300;PRESTO_TOUCH_FUZZ=1" TIMEOUT 120)
+endforeach()
+
+# DoublePsramBuffer480x480 draws the same frames on every run without touches, update
+# the checksum when its drawing changes on purpose
+add_test(NAME DoublePsramBuffer480x480Checksum COMMAND DoublePsramBuffer480x480)
+set_tests_properties(DoublePsramBuffer480x480Checksum PROPERTIES
+    ENVIRONMENT "PRESTO_HOST_FRAMES=301"
+    PASS_REGULAR_EXPRESSION "checksum=4a9654ae"
+    TIMEOUT 120)
@@ -0,0 +1,195 @@
+#include "af-file-io.h"
+
+#include "AssetLoader.h"
+#include "PicoPlusPsram.h"
+
+AssetLoader::AssetLoader(uint32_t uWindowSize) : m_uWindowSize(uWindowSize)
+{
+  static bool bInitialised = false;
+  if(!bInitialised)
+  {
+    uzlib_init();
+    bInitialised = true;
+  }
+
+  m_pWindow = (uint8_t *)malloc(m_uWindowSize);
+  m_source = {};
+  m_source.pLoader = this;
+}
+
+AssetLoader::~AssetLoader(void)
+{
+  Cancel();
+  free(m_pWindow);
+}
+
+// Called by uzlib when it has used the window, refill it and return the first byte
+int AssetLoader::ReadSource(TINF_DATA *pDecomp)
+{
+  AssetLoader *pLoader = ((Source *)pDecomp)->pLoader;
+
+  size_t uRead = fileio_read(pLoader->m_pFile, pLoader->m_pWindow, pLoader->m_uWindowSize);
+  if(!uRead)
+    return -1;
+
+  pLoader->m_uCompressedSize += uRead;
+  pDecomp->source = pLoader->m_pWindow + 1;
+  pDecomp->source_limit = pLoader->m_pWindow + uRead;
+  return pLoader->m_pWindow[0];
+}
+
+bool AssetLoader::Open(const char *pPath)
+{
+  Cancel();
+
+  if(!m_pWindow || !(m_pFile = fileio_open(pPath)))
+    return false;
+
+  // the header is read with the start of the stream so every read is a whole window from a window boundary
+  m_uHeaderRead = fileio_read(m_pFile, m_pWindow, m_uWindowSize);
+  m_uCompressedSize = m_uHeaderRead;
+  if(m_uHeaderRead < sizeof(Header))
+  {
+    Cancel();
+    return false;
+  }
+
+  memcpy(&m_header, m_pWindow, sizeof(Header));
+  // an image of no pixels would leave Step() nothing to decode into
+  if(m_header.uMagic != c_uMagic || !m_header.uWidth || !m_header.uHeight || !m_header.uFrameWidth || !m_header.uFrameHeight ||
+     m_header.uDataSize != m_header.uWidth * m_header.uHeight * 2 ||
+     m_header.uWidth % m_header.uFrameWidth || m_header.uHeight % m_header.uFrameHeight)
+  {
+    Cancel();
+    return false;
+  }
+  return true;
+}
+
+bool AssetLoader::Start(void *pDest, size_t uDestSize)
+{
+  if(!m_pFile || m_pData)
+    return false;
+
+  if(pDest)
+  {
+    if(uDestSize < m_header.uDataSize)
+    {
+      Cancel();
+      return false;
+    }
+    m_pData = pDest;
+    m_bOwnsData = false;
+  }
+  else
+  {
+    PsramTrace::Scope tag("assets");
+    m_pData = PicoPlusPsram::getInstance().Malloc(m_header.uDataSize);
+    m_bOwnsData = true;
+    if(!m_pData)
+    {
+      Cancel();
+      return false;
+    }
+  }
+
+  uzlib_uncompress_init(&m_source.decomp, nullptr, 0);
+  m_source.decomp.source = m_pWindow + sizeof(Header);
+  m_source.decomp.source_limit = m_pWindow + m_uHeaderRead;
+  m_source.decomp.source_read_cb = ReadSource;
+
+  if(uzlib_zlib_parse_header(&m_source.decomp) < 0)
+  {
+    Cancel();
+    return false;
+  }
+
+  // no dictionary, back references are read from the pixels already decompressed
+  m_source.decomp.dest_start = (uint8_t *)m_pData;
+  m_source.decomp.dest = (uint8_t *)m_pData;
+  return true;
+}
+
+AssetLoader::Result AssetLoader::Step(uint32_t uMaxBytes)
+{
+  if(!m_pFile)
+    return m_pData ? resultDone : resultError;
+
+  // opened but not started
+  if(!m_pData)
+    return resultError;
+
+  TINF_DATA &decomp = m_source.decomp;
+  uint8_t *pEnd = (uint8_t *)m_pData + m_header.uDataSize;
+  size_t uLeft = pEnd - decomp.dest;
+
+  // uzlib always decodes at least one symbol, so once every pixel is written it is given
+  // the last byte back to decode into rather than writing past pEnd. The end of the stream
+  // leaves it alone, anything else is more pixels than the header said.
+  if(!uLeft)
+  {
+    uint8_t uLast = pEnd[-1];
+    decomp.dest = pEnd - 1;
+    decomp.dest_limit = pEnd;
+
+    int iResult = uzlib_uncompress_chksum(&decomp);
+    bool bExtra = decomp.dest != pEnd - 1;
+    pEnd[-1] = uLast;
+    decomp.dest = pEnd;
+
+    if(iResult == TINF_DONE && !bExtra)
+    {
+      Finish();
+      return resultDone;
+    }
+
+    Cancel();
+    return resultError;
+  }
+
+  decomp.dest_limit = decomp.dest + (uMaxBytes < uLeft ? uMaxBytes : uLeft);
+
+  int iResult = uzlib_uncompress_chksum(&decomp);
+  if(iResult == TINF_DONE && decomp.dest == pEnd)
+  {
+    Finish();
+    return resultDone;
+  }
+
+  // an error, a checksum that does not match or fewer pixels than the header said
+  if(iResult != TINF_OK)
+  {
+    Cancel();
+    return resultError;
+  }
+  return resultBusy;
+}
+
+void *AssetLoader::Load(const char *pPath, void *pDest, size_t uDestSize)
+{
+  if(!Begin(pPath, pDest, uDestSize))
+    return nullptr;
+
+  Result result;
+  while((result = Step()) == resultBusy)
+    ;
+
+  return result == resultDone ? Release() : nullptr;
+}
+
+void AssetLoader::Finish(void)
+{
+  if(m_pFile)
+    fileio_close(m_pFile);
+  m_pFile = nullptr;
+}
+
+void AssetLoader::Cancel(void)
+{
+  Finish();
+
+  if(m_bOwnsData)
+    PicoPlusPsram::getInstance().Free(m_pData);
+  m_pData = nullptr;
+  m_bOwnsData = false;
+}
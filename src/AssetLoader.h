@@ -0,0 +1,135 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "uzlib.h"
+
+// AssetLoader
+//  Streams a compressed RGB565 image or sprite sheet, made with AssetPack, from a file
+//  through fileio_* and uzlib straight into its destination, usually psram. The compressed
+//  data only passes through a small SRAM window, refilled by uzlib as it needs more, and the
+//  pixels are decompressed in place, so nothing holds the whole file or a second copy of
+//  the pixels.
+//
+//  An asset file is a Header followed by a zlib stream of the pixels, in the byte order
+//  PicoGraphics_PenRGB565 uses so they can be copied straight into a frame. A sprite sheet
+//  is stored a frame at a time, left to right then top to bottom, so each frame's pixels are
+//  together.
+//
+//  Loading can be spread over several frames by calling Step() with a limit each frame.
+//
+//  Usage:
+//    Load(path)                 - load it all now, returns the pixels
+//    Begin(path), Step(bytes)   - or load a step at a time until Step() returns resultDone,
+//                                 Begin() can be split into Open() and Start()
+//    Release()                  - take ownership of the psram the pixels were loaded into
+class AssetLoader
+{
+public:
+  static const uint32_t c_uMagic = 0x35365241;  // "AR65"
+
+  struct Header
+  {
+    uint32_t uMagic;
+    uint16_t uWidth;        // of the whole image or sheet
+    uint16_t uHeight;
+    uint16_t uFrameWidth;   // of each sprite, the whole image if it is not a sheet
+    uint16_t uFrameHeight;
+    uint32_t uDataSize;     // bytes of pixels once decompressed
+
+    uint32_t GetFrameCount(void) const
+    {
+      return (uWidth / uFrameWidth) * (uHeight / uFrameHeight);
+    }
+
+    uint32_t GetFrameSize(void) const
+    {
+      return uFrameWidth * uFrameHeight * 2;
+    }
+  };
+
+  enum Result { resultError, resultBusy, resultDone };
+
+  // uWindowSize bytes of SRAM hold the compressed data, make it a multiple of the fileio
+  // chunk size so the reads go straight from the card into the window
+  AssetLoader(uint32_t uWindowSize = 4096);
+  ~AssetLoader(void);
+
+  AssetLoader(const AssetLoader&) = delete;
+  AssetLoader& operator = (const AssetLoader&) = delete;
+
+  // Open the file and check its header, the pixels go into pDest, which must hold uDestSize
+  // bytes, or into psram from PicoPlusPsram when pDest is nullptr
+  bool Begin(const char *pPath, void *pDest = nullptr, size_t uDestSize = 0)
+  {
+    return Open(pPath) && Start(pDest, uDestSize);
+  }
+
+  // Begin() in two parts, to see the header before choosing where the pixels go
+  bool Open(const char *pPath);
+  bool Start(void *pDest = nullptr, size_t uDestSize = 0);
+
+  // Decompress up to uMaxBytes more of the pixels
+  Result Step(uint32_t uMaxBytes = UINT32_MAX);
+
+  // Begin() and Step() until done, returns the pixels or nullptr on an error. Psram
+  // allocated for the pixels is then the caller's to free with PicoPlusPsram::Free()
+  void *Load(const char *pPath, void *pDest = nullptr, size_t uDestSize = 0);
+
+  // Stop loading and free any psram allocated for the pixels and not released
+  void Cancel(void);
+
+  bool IsBusy(void) const
+  {
+    return m_pFile != nullptr;
+  }
+
+  const Header &GetHeader(void) const
+  {
+    return m_header;
+  }
+
+  void *GetData(void) const
+  {
+    return m_pData;
+  }
+
+  // Pixel bytes decompressed so far
+  size_t GetLoadedSize(void) const
+  {
+    return m_pData ? m_source.decomp.dest - (uint8_t *)m_pData : 0;
+  }
+
+  // Compressed bytes read from the file so far
+  size_t GetCompressedSize(void) const
+  {
+    return m_uCompressedSize;
+  }
+
+  // Take the pixels, psram allocated for them is then the caller's to free
+  void *Release(void)
+  {
+    m_bOwnsData = false;
+    return m_pData;
+  }
+
+private:
+  // uzlib's state, with a way back to the loader for the read callback
+  struct Source
+  {
+    TINF_DATA   decomp;
+    AssetLoader *pLoader;
+  };
+
+  static int ReadSource(TINF_DATA *pDecomp);
+  void Finish(void);
+
+  uint32_t m_uWindowSize;
+  uint8_t  *m_pWindow;
+  void     *m_pFile = nullptr;
+  size_t   m_uHeaderRead = 0;   // bytes in the window when the header was read
+  Source   m_source;
+  Header   m_header = {};
+  void     *m_pData = nullptr;
+  bool     m_bOwnsData = false;
+  size_t   m_uCompressedSize = 0;
+};
@@ -0,0 +1,163 @@
+// ******************************************************************************
+// This host tool packs images into the compressed RGB565 assets AssetLoader
+// streams from the SD card into PSRAM.
+//
+// The input is a binary PPM (P6) image, as written by PRESTO_HOST_DUMP or most
+// image editors. The pixels are converted to RGB565 in the byte order
+// PicoGraphics_PenRGB565 uses, rearranged a frame at a time for a sprite sheet,
+// and compressed as a zlib stream after an AssetLoader::Header.
+//
+// Usage:
+//   AssetPack [-s <frame width>x<frame height>] input.ppm output.rgz
+//
+// Without -s the whole image is one frame.
+// ******************************************************************************
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <zlib.h>
+
+#include "AssetLoader.h"
+
+// Next number in a PPM header, skipping white space and comments
+static bool ReadPpmValue(FILE *pFile, unsigned &uValue)
+{
+  int c = fgetc(pFile);
+  while(c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+  {
+    if(c == '#')
+    {
+      while(c != '\n' && c != EOF)
+        c = fgetc(pFile);
+    }
+    c = fgetc(pFile);
+  }
+
+  if(c < '0' || c > '9')
+    return false;
+
+  uValue = 0;
+  while(c >= '0' && c <= '9')
+  {
+    uValue = uValue * 10 + (c - '0');
+    c = fgetc(pFile);
+  }
+  // c is the single white space before the pixels, or after a value in the header
+  return true;
+}
+
+static bool ReadPpm(const char *pPath, unsigned &uWidth, unsigned &uHeight, std::vector<uint8_t> &rgb)
+{
+  FILE *pFile = fopen(pPath, "rb");
+  if(!pFile)
+    return false;
+
+  char magic[2];
+  unsigned uMax;
+  bool bOk = fread(magic, 1, 2, pFile) == 2 && magic[0] == 'P' && magic[1] == '6' &&
+             ReadPpmValue(pFile, uWidth) && ReadPpmValue(pFile, uHeight) && ReadPpmValue(pFile, uMax) &&
+             uMax == 255 && uWidth && uHeight && uWidth <= 0xffff && uHeight <= 0xffff;
+
+  if(bOk)
+  {
+    rgb.resize(uWidth * uHeight * 3);
+    bOk = fread(rgb.data(), 1, rgb.size(), pFile) == rgb.size();
+  }
+
+  fclose(pFile);
+  return bOk;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned uFrameWidth = 0, uFrameHeight = 0;
+  int iArg = 1;
+
+  if(argc > 2 && strcmp(argv[1], "-s") == 0)
+  {
+    if(sscanf(argv[2], "%ux%u", &uFrameWidth, &uFrameHeight) != 2 || !uFrameWidth || !uFrameHeight)
+    {
+      fprintf(stderr, "bad frame size %s\n", argv[2]);
+      return 1;
+    }
+    iArg = 3;
+  }
+
+  if(argc - iArg != 2)
+  {
+    fprintf(stderr, "usage: AssetPack [-s <frame width>x<frame height>] input.ppm output.rgz\n");
+    return 1;
+  }
+
+  unsigned uWidth, uHeight;
+  std::vector<uint8_t> rgb;
+  if(!ReadPpm(argv[iArg], uWidth, uHeight, rgb))
+  {
+    fprintf(stderr, "cannot read %s, it must be a binary PPM with 8 bits per channel\n", argv[iArg]);
+    return 1;
+  }
+
+  if(!uFrameWidth)
+  {
+    uFrameWidth = uWidth;
+    uFrameHeight = uHeight;
+  }
+
+  if(uWidth % uFrameWidth || uHeight % uFrameHeight)
+  {
+    fprintf(stderr, "%ux%u is not a whole number of %ux%u frames\n", uWidth, uHeight, uFrameWidth, uFrameHeight);
+    return 1;
+  }
+
+  // RGB565 with the high byte first, a frame at a time
+  std::vector<uint8_t> pixels;
+  pixels.reserve(uWidth * uHeight * 2);
+  for(unsigned uFrameY = 0; uFrameY < uHeight; uFrameY += uFrameHeight)
+  {
+    for(unsigned uFrameX = 0; uFrameX < uWidth; uFrameX += uFrameWidth)
+    {
+      for(unsigned y = uFrameY; y < uFrameY + uFrameHeight; y++)
+      {
+        for(unsigned x = uFrameX; x < uFrameX + uFrameWidth; x++)
+        {
+          const uint8_t *pRgb = &rgb[(y * uWidth + x) * 3];
+          uint16_t uPixel = ((pRgb[0] & 0xf8) << 8) | ((pRgb[1] & 0xfc) << 3) | (pRgb[2] >> 3);
+          pixels.push_back(uPixel >> 8);
+          pixels.push_back(uPixel & 0xff);
+        }
+      }
+    }
+  }
+
+  uLongf uCompressedSize = compressBound(pixels.size());
+  std::vector<uint8_t> compressed(uCompressedSize);
+  if(compress2(compressed.data(), &uCompressedSize, pixels.data(), pixels.size(), Z_BEST_COMPRESSION) != Z_OK)
+  {
+    fprintf(stderr, "cannot compress %s\n", argv[iArg]);
+    return 1;
+  }
+
+  AssetLoader::Header header = {};
+  header.uMagic = AssetLoader::c_uMagic;
+  header.uWidth = uWidth;
+  header.uHeight = uHeight;
+  header.uFrameWidth = uFrameWidth;
+  header.uFrameHeight = uFrameHeight;
+  header.uDataSize = pixels.size();
+
+  FILE *pFile = fopen(argv[iArg + 1], "wb");
+  if(!pFile || fwrite(&header, sizeof(header), 1, pFile) != 1 ||
+     fwrite(compressed.data(), 1, uCompressedSize, pFile) != uCompressedSize)
+  {
+    fprintf(stderr, "cannot write %s\n", argv[iArg + 1]);
+    return 1;
+  }
+  fclose(pFile);
+
+  printf("%s: %ux%u, %u frames of %ux%u, %zu bytes packed to %lu\n", argv[iArg + 1], uWidth, uHeight,
+         header.GetFrameCount(), uFrameWidth, uFrameHeight, pixels.size(), (unsigned long)(sizeof(header) + uCompressedSize));
+  return 0;
+}
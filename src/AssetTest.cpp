@@ -0,0 +1,225 @@
+// ******************************************************************************
+// This host tool checks the asset path end to end: AssetPack packs a PPM this
+// tool writes, then AssetLoader and TextureCache load the result back.
+//
+//   AssetTest write test.ppm   - write the test image
+//   AssetTest check test.rgz   - load it and compare every pixel
+//
+// The check loads the asset into psram, into a buffer of exactly the right size
+// with guard bytes after it, and a step at a time, then through TextureCache.
+// It also writes two broken copies that must not load: one whose header is
+// short of the stream, which must not write past the buffer, and one with a
+// zero size image.
+//
+// Each failed check is printed, and the process exits with 1 if any failed.
+// ******************************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "TextureCache.h"
+#include "PicoPlusPsram.h"
+
+#define TEST_WIDTH  160
+#define TEST_HEIGHT 96
+#define GUARD_BYTES 64
+#define GUARD_VALUE 0xa5
+
+static uint32_t uFailures = 0;
+
+static void Check(bool bOk, const char *pWhat)
+{
+  if(bOk)
+    return;
+
+  printf("FAIL %s\n", pWhat);
+  uFailures++;
+}
+
+// Colour of each pixel of the test image, every channel changes across it
+static void Pattern(unsigned x, unsigned y, uint8_t *pRgb)
+{
+  pRgb[0] = x * 5;
+  pRgb[1] = y * 8;
+  pRgb[2] = (x ^ y) * 4 + 3;
+}
+
+static bool WritePpm(const char *pPath)
+{
+  FILE *pFile = fopen(pPath, "wb");
+  if(!pFile)
+    return false;
+
+  fprintf(pFile, "P6\n%u %u\n255\n", TEST_WIDTH, TEST_HEIGHT);
+  for(unsigned y = 0; y < TEST_HEIGHT; y++)
+  {
+    for(unsigned x = 0; x < TEST_WIDTH; x++)
+    {
+      uint8_t rgb[3];
+      Pattern(x, y, rgb);
+      fwrite(rgb, 1, 3, pFile);
+    }
+  }
+  return fclose(pFile) == 0;
+}
+
+// The bytes AssetPack should have packed, RGB565 high byte first a frame at a time
+static std::vector<uint8_t> Expected(const AssetLoader::Header &header)
+{
+  std::vector<uint8_t> pixels;
+  for(unsigned uFrameY = 0; uFrameY < header.uHeight; uFrameY += header.uFrameHeight)
+  {
+    for(unsigned uFrameX = 0; uFrameX < header.uWidth; uFrameX += header.uFrameWidth)
+    {
+      for(unsigned y = uFrameY; y < uFrameY + header.uFrameHeight; y++)
+      {
+        for(unsigned x = uFrameX; x < uFrameX + header.uFrameWidth; x++)
+        {
+          uint8_t rgb[3];
+          Pattern(x, y, rgb);
+          uint16_t uPixel = ((rgb[0] & 0xf8) << 8) | ((rgb[1] & 0xfc) << 3) | (rgb[2] >> 3);
+          pixels.push_back(uPixel >> 8);
+          pixels.push_back(uPixel & 0xff);
+        }
+      }
+    }
+  }
+  return pixels;
+}
+
+static bool ReadFile(const char *pPath, std::vector<uint8_t> &data)
+{
+  FILE *pFile = fopen(pPath, "rb");
+  if(!pFile)
+    return false;
+
+  uint8_t buffer[4096];
+  size_t uRead;
+  while((uRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+    data.insert(data.end(), buffer, buffer + uRead);
+  fclose(pFile);
+  return true;
+}
+
+// A copy of the asset with its header changed
+static bool WriteVariant(const char *pPath, const std::vector<uint8_t> &asset, const AssetLoader::Header &header)
+{
+  FILE *pFile = fopen(pPath, "wb");
+  if(!pFile)
+    return false;
+
+  fwrite(&header, sizeof(header), 1, pFile);
+  fwrite(asset.data() + sizeof(header), 1, asset.size() - sizeof(header), pFile);
+  return fclose(pFile) == 0;
+}
+
+static bool IsGuardIntact(const uint8_t *pGuard)
+{
+  for(uint32_t i = 0; i < GUARD_BYTES; i++)
+  {
+    if(pGuard[i] != GUARD_VALUE)
+      return false;
+  }
+  return true;
+}
+
+static void CheckAsset(const char *pPath)
+{
+  AssetLoader loader;
+  if(!loader.Open(pPath))
+  {
+    Check(false, "Open");
+    return;
+  }
+  AssetLoader::Header header = loader.GetHeader();
+  loader.Cancel();
+
+  std::vector<uint8_t> expected = Expected(header);
+  Check(header.uDataSize == expected.size(), "header size");
+
+  // into psram
+  void *pPixels = loader.Load(pPath);
+  Check(pPixels && memcmp(pPixels, expected.data(), expected.size()) == 0, "Load into psram");
+  PicoPlusPsram::getInstance().Free(pPixels);
+
+  // into a buffer of exactly the right size
+  std::vector<uint8_t> dest(header.uDataSize + GUARD_BYTES, GUARD_VALUE);
+  pPixels = loader.Load(pPath, dest.data(), header.uDataSize);
+  Check(pPixels == dest.data() && memcmp(dest.data(), expected.data(), expected.size()) == 0, "Load into a buffer");
+  Check(IsGuardIntact(dest.data() + header.uDataSize), "Load into a buffer, guard bytes");
+
+  // a step at a time
+  memset(dest.data(), GUARD_VALUE, dest.size());
+  AssetLoader::Result result = loader.Begin(pPath, dest.data(), header.uDataSize) ? AssetLoader::resultBusy : AssetLoader::resultError;
+  while(result == AssetLoader::resultBusy)
+    result = loader.Step(1000);
+  Check(result == AssetLoader::resultDone && memcmp(dest.data(), expected.data(), expected.size()) == 0, "Step");
+  Check(IsGuardIntact(dest.data() + header.uDataSize), "Step, guard bytes");
+
+  // through the cache, a few milliseconds a frame
+  TextureCache cache(1024 * 1024);
+  for(uint32_t uFrame = 0; uFrame < 1000 && !cache.IsResident(pPath); uFrame++)
+  {
+    cache.Get(pPath);
+    cache.Update(2000);
+  }
+  const TextureCache::Texture &texture = cache.Get(pPath);
+  Check(cache.IsResident(pPath) && texture.uFrameCount == header.GetFrameCount() &&
+        memcmp(texture.pPixels, expected.data(), expected.size()) == 0, "TextureCache");
+
+  std::vector<uint8_t> asset;
+  if(!ReadFile(pPath, asset))
+  {
+    Check(false, "reading the asset");
+    return;
+  }
+
+  // a stream longer than its header says must fail without writing past the buffer, a row
+  // of frames short or a row short of a single image
+  AssetLoader::Header shortHeader = header;
+  if(header.uHeight > header.uFrameHeight)
+    shortHeader.uHeight -= header.uFrameHeight;
+  else
+    shortHeader.uHeight = shortHeader.uFrameHeight = header.uHeight - 1;
+  shortHeader.uDataSize = shortHeader.uWidth * shortHeader.uHeight * 2;
+  if(shortHeader.uHeight && WriteVariant("asset_test_long.rgz", asset, shortHeader))
+  {
+    memset(dest.data(), GUARD_VALUE, dest.size());
+    pPixels = loader.Load("asset_test_long.rgz", dest.data(), shortHeader.uDataSize);
+    Check(!pPixels, "stream longer than the header loaded");
+    Check(IsGuardIntact(dest.data() + shortHeader.uDataSize), "stream longer than the header, guard bytes");
+  }
+  else
+    Check(false, "writing the long stream");
+
+  // as must an image of no pixels
+  AssetLoader::Header emptyHeader = header;
+  emptyHeader.uWidth = 0;
+  emptyHeader.uDataSize = 0;
+  if(WriteVariant("asset_test_empty.rgz", asset, emptyHeader))
+    Check(!loader.Open("asset_test_empty.rgz"), "zero width image opened");
+  else
+    Check(false, "writing the empty image");
+}
+
+int main(int argc, char **argv)
+{
+  if(argc == 3 && strcmp(argv[1], "write") == 0)
+  {
+    Check(WritePpm(argv[2]), "writing the test image");
+  }
+  else if(argc == 3 && strcmp(argv[1], "check") == 0)
+  {
+    CheckAsset(argv[2]);
+  }
+  else
+  {
+    fprintf(stderr, "usage: AssetTest write test.ppm | AssetTest check test.rgz\n");
+    return 1;
+  }
+
+  printf("AssetTest %s: %u failures\n", argv[1], (unsigned)uFailures);
+  return uFailures ? 1 : 0;
+}
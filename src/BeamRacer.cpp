@@ -0,0 +1,105 @@
+#include "pico/stdlib.h"
+
+#include "BeamRacer.h"
+
+using namespace pimoroni;
+
+// Unsafe while the beam is within the margin of the command's rows, allowing for it wrapping round
+bool BeamRacer::IsSafe(const Rect &bounds, int32_t iScanline) const
+{
+  if(iScanline < 0)
+    return true;
+
+  int32_t iTotalLines = m_estimator.GetTotalLines();
+  int32_t iStart = bounds.y - m_uMarginRows;
+  int32_t iLength = bounds.h + m_uMarginRows * 2;
+
+  if(iLength >= iTotalLines)
+    return false;
+
+  int32_t iIntoRange = (iScanline - iStart) % iTotalLines;
+  if(iIntoRange < 0)
+    iIntoRange += iTotalLines;
+
+  return iIntoRange >= iLength;
+}
+
+// A command taller than the frame less the margins is never clear of the beam
+bool BeamRacer::CanBeSafe(const Rect &bounds) const
+{
+  return bounds.h + m_uMarginRows * 2 < m_estimator.GetTotalLines();
+}
+
+// Time the beam next leaves the rows of the command and its margin
+uint64_t BeamRacer::GetSafeTime(const Rect &bounds, uint64_t timeNow) const
+{
+  int32_t iTotalLines = m_estimator.GetTotalLines();
+  int32_t iEnd = (bounds.y + bounds.h + m_uMarginRows) % iTotalLines;
+  if(iEnd < 0)
+    iEnd += iTotalLines;
+
+  return m_estimator.GetRowTime(iEnd, timeNow);
+}
+
+uint32_t BeamRacer::Run(PicoGraphics &graphics)
+{
+  uint32_t uWaited = 0;
+  bool bFirstPass = true;
+  uint64_t deadline = time_us_64() + m_estimator.GetFramePeriodUs();
+
+  m_uForced = 0;
+  while(!m_pending.empty())
+  {
+    bool bForce = time_us_64() >= deadline;
+    uint64_t safeTime = deadline;
+
+    m_deferred.clear();
+    for(const Queued &queued : m_pending)
+    {
+      Rect bounds = queued.command.Bounds();
+
+      // keep the order of overlapping commands
+      bool bBlocked = false;
+      for(const Queued &deferred : m_deferred)
+      {
+        if(deferred.command.Bounds().intersects(bounds))
+        {
+          bBlocked = true;
+          break;
+        }
+      }
+
+      if(bBlocked)
+        m_deferred.push_back(queued);
+      else if(IsSafe(bounds, m_estimator.GetScanline(time_us_64())))
+        queued.command.Execute(graphics, queued.pText);
+      else if(bForce || !CanBeSafe(bounds))
+      {
+        queued.command.Execute(graphics, queued.pText);
+        m_uForced++;
+      }
+      else
+      {
+        // the next pass runs when the first of these is clear
+        uint64_t commandSafeTime = GetSafeTime(bounds, time_us_64());
+        if(commandSafeTime < safeTime)
+          safeTime = commandSafeTime;
+        m_deferred.push_back(queued);
+      }
+    }
+
+    if(bFirstPass)
+    {
+      uWaited = m_deferred.size();
+      bFirstPass = false;
+    }
+
+    m_pending.swap(m_deferred);
+
+    // wait for the beam to clear the nearest blocked rows
+    while(!m_pending.empty() && time_us_64() <= safeTime)
+      tight_loop_contents();
+  }
+
+  return uWaited;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <vector>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "DrawCommand.h"
+#include "DisplayList.h"
+
+// ScanlineEstimator
+//  Estimates the row ST7701Cached is currently sending to the panel.
+//
+//  ST7701Cached streams the back buffer continuously and does not expose its row
+//  counter, so the position is worked out from the time since the last vsync and
+//  the measured frame period. Call OnVsync() as soon as wait_for_vsync() returns.
+//
+//  The period is seeded from the median of the first few intervals, so a missed vsync or
+//  a late timestamp among them doesn't throw it out. After that an interval that spans
+//  several vsyncs is divided by the whole number of frames nearest to it, so vsyncs
+//  that are not consecutive still refine the period. If the period stops matching the
+//  intervals it is seeded again.
+class ScanlineEstimator
+{
+public:
+  // uBlankLines is the vertical blanking time in rows, it only needs to be approximate
+  ScanlineEstimator(uint16_t uHeight, uint16_t uBlankLines = 16) : m_uTotalLines(uHeight + uBlankLines)
+  {
+  }
+
+  void OnVsync(uint64_t vsyncTime)
+  {
+    if(m_lastVsyncTime)
+    {
+      uint32_t uInterval = (uint32_t)(vsyncTime - m_lastVsyncTime);
+
+      if(m_uSeedCount < c_uSeedIntervals)
+        Seed(uInterval);
+      else
+      {
+        // average the period per frame, ignoring intervals that are not close to a whole number of frames
+        uint32_t uFrames = m_uPeriodUs ? (uInterval + m_uPeriodUs / 2) / m_uPeriodUs : 0;
+        uint32_t uFrameUs = uFrames ? uInterval / uFrames : 0;
+
+        if(uFrames && uFrames <= c_uMaxFramesPerInterval &&
+           uFrameUs < m_uPeriodUs + m_uPeriodUs / 8 && uFrameUs > m_uPeriodUs - m_uPeriodUs / 8)
+        {
+          m_uPeriodUs = (m_uPeriodUs * 7 + uFrameUs) / 8;
+          m_uRejectCount = 0;
+        }
+        else if(++m_uRejectCount >= c_uSeedIntervals)
+        {
+          m_uSeedCount = 0;
+          Seed(uInterval);
+        }
+      }
+    }
+
+    m_lastVsyncTime = vsyncTime;
+  }
+
+  // The period has been seeded, before this it is the median of the intervals seen so far
+  bool IsCalibrated(void) const
+  {
+    return m_uSeedCount >= c_uSeedIntervals;
+  }
+
+
+  uint32_t GetFramePeriodUs(void) const
+  {
+    return m_uPeriodUs;
+  }
+
+  // Rows per frame including vertical blanking
+  uint16_t GetTotalLines(void) const
+  {
+    return m_uTotalLines;
+  }
+
+  uint64_t GetLastVsyncTime(void) const
+  {
+    return m_lastVsyncTime;
+  }
+
+  // Row being sent, height or more while in vertical blanking, -1 before calibration
+  int32_t GetScanline(uint64_t timeNow) const
+  {
+    if(!m_uPeriodUs)
+      return -1;
+
+    uint32_t uIntoFrame = (uint32_t)((timeNow - m_lastVsyncTime) % m_uPeriodUs);
+    return (int32_t)(((uint64_t)uIntoFrame * m_uTotalLines) / m_uPeriodUs);
+  }
+
+  // Time the given row will next start being sent
+  uint64_t GetRowTime(uint16_t y, uint64_t timeNow) const
+  {
+    if(!m_uPeriodUs)
+      return timeNow;
+
+    uint64_t frameStart = m_lastVsyncTime + ((timeNow - m_lastVsyncTime) / m_uPeriodUs) * m_uPeriodUs;
+    uint64_t rowTime = frameStart + ((uint64_t)y * m_uPeriodUs) / m_uTotalLines;
+    return rowTime >= timeNow ? rowTime : rowTime + m_uPeriodUs;
+  }
+
+private:
+  // Intervals the period is seeded from, and how many in a row that don't fit it before it is seeded again
+  static const uint8_t  c_uSeedIntervals = 5;
+  static const uint32_t c_uMaxFramesPerInterval = 8;
+
+  // Keep the seed intervals sorted and take the middle one as the period
+  void Seed(uint32_t uInterval)
+  {
+    uint8_t i = m_uSeedCount++;
+    for(; i > 0 && m_seedIntervals[i - 1] > uInterval; i--)
+      m_seedIntervals[i] = m_seedIntervals[i - 1];
+    m_seedIntervals[i] = uInterval;
+
+    m_uPeriodUs = m_seedIntervals[(m_uSeedCount - 1) / 2];
+    m_uRejectCount = 0;
+  }
+
+  uint16_t m_uTotalLines;
+  uint8_t  m_uSeedCount = 0;
+  uint8_t  m_uRejectCount = 0;
+  uint32_t m_seedIntervals[c_uSeedIntervals];
+  uint32_t m_uPeriodUs = 0;
+  uint64_t m_lastVsyncTime = 0;
+};
+
+// BeamRacer
+//  Queues draw calls for a single back buffer that is being scanned out, and only
+//  runs each one once the rows it touches are safe: either the beam has already
+//  passed them this frame, or it is far enough away that the draw will finish first.
+//
+//  Commands are deferred and reordered around the beam, but a command is never run
+//  ahead of an earlier queued command it overlaps so drawing order is kept. Between
+//  passes Run() only waits until the beam has left the rows of the first deferred
+//  command, rather than rescanning the list.
+//
+//  Each frame:
+//    set_pen(), rectangle(), circle(), pixel_span() - queue drawing
+//    Add(list)                                      - queue a recorded DisplayList
+//    Run(graphics)                                  - draw it racing the beam
+class BeamRacer
+{
+public:
+  // uMarginRows is how far the beam may move while one command is drawn
+  BeamRacer(const ScanlineEstimator &estimator, uint16_t uMarginRows = 16) : m_estimator(estimator), m_uMarginRows(uMarginRows)
+  {
+  }
+
+  void set_pen(uint c)
+  {
+    m_uPen = c;
+  }
+
+  void rectangle(const pimoroni::Rect &r)
+  {
+    m_pending.push_back({DrawCommand::Rectangle(m_uPen, r), nullptr});
+  }
+
+  void circle(const pimoroni::Point &p, int32_t radius)
+  {
+    m_pending.push_back({DrawCommand::Circle(m_uPen, p, radius), nullptr});
+  }
+
+  void pixel_span(const pimoroni::Point &p, int32_t l)
+  {
+    m_pending.push_back({DrawCommand::PixelSpan(m_uPen, p, l), nullptr});
+  }
+
+  // Queue everything recorded in list, which must be kept until Run() has drawn it
+  void Add(const DisplayList &list)
+  {
+    for(const DrawCommand &command : list.GetCommands())
+      m_pending.push_back({command, list.GetText()});
+  }
+
+  // Draw everything queued, returns the number of commands that had to wait for the beam.
+  // Commands too tall to ever be clear of the beam, or still waiting after a frame period
+  // because the estimate is off, are drawn regardless and counted by GetForcedCount().
+  uint32_t Run(pimoroni::PicoGraphics &graphics);
+
+  // Commands the last Run() drew without the beam being clear of them
+  uint32_t GetForcedCount(void) const
+  {
+    return m_uForced;
+  }
+
+private:
+  // pText is the text a text command points into
+  struct Queued
+  {
+    DrawCommand command;
+    const char  *pText;
+  };
+
+  bool IsSafe(const pimoroni::Rect &bounds, int32_t iScanline) const;
+  bool CanBeSafe(const pimoroni::Rect &bounds) const;
+  uint64_t GetSafeTime(const pimoroni::Rect &bounds, uint64_t timeNow) const;
+
+  const ScanlineEstimator  &m_estimator;
+  uint16_t                 m_uMarginRows;
+  uint16_t                 m_uPen = 0;
+  uint32_t                 m_uForced = 0;
+  std::vector<Queued>      m_pending;
+  std::vector<Queued>      m_deferred;
+};
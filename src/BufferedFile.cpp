@@ -0,0 +1,161 @@
+#include <algorithm>
+
+#include "BufferedFile.h"
+#include "PicoPlusPsram.h"
+
+BufferedFile::BufferedFile(uint32_t uChunkSize, bool bPsram)
+  : m_bPsram(bPsram), m_uChunkSize((uChunkSize + c_uSectorSize - 1) / c_uSectorSize * c_uSectorSize)
+{
+  if(m_bPsram)
+  {
+    PsramTrace::Scope tag("files");
+    m_pBuffer = (uint8_t *)PicoPlusPsram::getInstance().Malloc(m_uChunkSize * 2);
+  }
+  else
+    m_pBuffer = (uint8_t *)malloc(m_uChunkSize * 2);
+
+  for(uint8_t i = 0; i < 2; i++)
+    m_chunks[i] = {0, 0, m_pBuffer + i * m_uChunkSize};
+}
+
+BufferedFile::~BufferedFile(void)
+{
+  Close();
+
+  if(m_bPsram)
+    PicoPlusPsram::getInstance().Free(m_pBuffer);
+  else
+    free(m_pBuffer);
+}
+
+bool BufferedFile::Open(const char *pPath)
+{
+  Close();
+
+  if(!m_pBuffer || f_open(&m_file, pPath, FA_READ) != FR_OK)
+    return false;
+
+  m_bOpen = true;
+  m_uSize = f_size(&m_file);
+  return true;
+}
+
+void BufferedFile::Close(void)
+{
+  if(m_bOpen)
+    f_close(&m_file);
+
+  m_bOpen = false;
+  m_uPos = 0;
+  m_uSize = 0;
+  m_uCurrent = 0;
+  for(Chunk &chunk : m_chunks)
+    chunk.uLength = 0;
+}
+
+BufferedFile::Chunk *BufferedFile::Find(size_t uPos)
+{
+  for(Chunk &chunk : m_chunks)
+  {
+    if(uPos - chunk.uStart < chunk.uLength)
+      return &chunk;
+  }
+  return nullptr;
+}
+
+bool BufferedFile::ReadAt(size_t uPos, void *pBuffer, size_t uLength, size_t &uRead)
+{
+  UINT uBytes = 0;
+  uRead = 0;
+
+  if(f_tell(&m_file) != uPos && f_lseek(&m_file, uPos) != FR_OK)
+    return false;
+
+  m_stats.uFileReads++;
+  FRESULT fr = f_read(&m_file, pBuffer, uLength, &uBytes);
+  m_stats.uBytesRead += uBytes;
+  uRead = uBytes;
+  return fr == FR_OK && uBytes != 0;
+}
+
+bool BufferedFile::Load(Chunk &chunk, size_t uPos)
+{
+  size_t uStart = uPos - uPos % c_uSectorSize;
+  size_t uLength = std::min((size_t)m_uChunkSize, m_uSize - uStart);
+  size_t uRead;
+
+  chunk.uLength = 0;
+  if(!ReadAt(uStart, chunk.pData, uLength, uRead))
+    return false;
+
+  chunk.uStart = uStart;
+  chunk.uLength = uRead;
+  return true;
+}
+
+size_t BufferedFile::Read(void *pBuffer, size_t uLength)
+{
+  if(!m_bOpen)
+    return 0;
+
+  uint8_t *pOut = (uint8_t *)pBuffer;
+  uLength = std::min(uLength, m_uSize - m_uPos);
+
+  size_t uDone = 0;
+  while(uDone < uLength)
+  {
+    size_t uLeft = uLength - uDone;
+
+    // from the buffer
+    if(Chunk *pChunk = Find(m_uPos))
+    {
+      size_t uOffset = m_uPos - pChunk->uStart;
+      size_t uCopy = std::min(uLeft, pChunk->uLength - uOffset);
+      memcpy(pOut + uDone, pChunk->pData + uOffset, uCopy);
+
+      m_uCurrent = pChunk - m_chunks;
+      m_uPos += uCopy;
+      uDone += uCopy;
+      m_stats.uBufferReads++;
+      continue;
+    }
+
+    // a chunk or more of whole sectors goes straight to the caller, FatFs reads them without copying
+    if(m_uPos % c_uSectorSize == 0 && uLeft >= m_uChunkSize)
+    {
+      size_t uDirect = uLeft - uLeft % c_uSectorSize;
+      size_t uRead;
+      bool bOk = ReadAt(m_uPos, pOut + uDone, uDirect, uRead);
+      m_uPos += uRead;
+      uDone += uRead;
+      if(!bOk || uRead < uDirect)
+        break;
+      continue;
+    }
+
+    // replace the chunk not being read, so the one just finished stays for short seeks back
+    Chunk &chunk = m_chunks[m_uCurrent ^ 1];
+    if(!Load(chunk, m_uPos))
+      break;
+    m_uCurrent ^= 1;
+  }
+
+  return uDone;
+}
+
+bool BufferedFile::Prefetch(void)
+{
+  if(!m_bOpen)
+    return false;
+
+  // the chunk after the one being read, or the one at the position if that is not buffered
+  const Chunk &current = m_chunks[m_uCurrent];
+  size_t uNext = m_uPos;
+  if(m_uPos - current.uStart < current.uLength)
+    uNext = current.uStart + current.uLength;
+
+  if(uNext >= m_uSize || Find(uNext))
+    return true;
+
+  return Load(m_chunks[m_uCurrent ^ 1], uNext);
+}
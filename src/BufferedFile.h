@@ -0,0 +1,120 @@
+#pragma once
+
+#include "pico/stdlib.h"
+#include "ff.h"
+
+// BufferedFile
+//  Reads a FatFs file through a read-ahead buffer. Every f_read() goes through FatFs and
+//  the SD card driver however little it asks for, so reading a byte or a few at a time is
+//  very slow. Here the file is read a chunk of whole sectors at a time, starting on a
+//  sector boundary so FatFs reads the sectors straight into the buffer with one multi-sector
+//  read, and small reads and seeks within the buffered data are served from memory.
+//
+//  The buffer holds two chunks, the one being read and either the one before it, for short
+//  seeks back, or the one after it once Prefetch() has read ahead. Prefetch() is for when
+//  there is time to spare, like while waiting for vsync, so the next read carries on without
+//  waiting on the card. FatFs has no asynchronous reads, so Prefetch() blocks in f_read()
+//  like any other read, it only moves the wait to a time the caller chooses. Reads of a
+//  chunk or more go straight into the caller's buffer.
+//
+//  Usage:
+//    Open(), Read(), Getc(), Seek(), Tell(), Close()
+//    Prefetch() - read the next chunk now rather than when the reads get there
+class BufferedFile
+{
+public:
+  static const uint32_t c_uSectorSize = 512;
+
+  struct Stats
+  {
+    uint32_t uFileReads;    // f_read() calls
+    uint32_t uBufferReads;  // Read() and Getc() calls served from the buffer
+    uint64_t uBytesRead;    // bytes read from the file
+  };
+
+  // uChunkSize is rounded up to whole sectors, bPsram puts the buffer in psram
+  BufferedFile(uint32_t uChunkSize = 4096, bool bPsram = false);
+  ~BufferedFile(void);
+
+  BufferedFile(const BufferedFile&) = delete;
+  BufferedFile& operator = (const BufferedFile&) = delete;
+
+  bool Open(const char *pPath);
+  void Close(void);
+
+  bool IsOpen(void) const
+  {
+    return m_bOpen;
+  }
+
+  // Returns the number of bytes read, short at the end of the file or on an error
+  size_t Read(void *pBuffer, size_t uLength);
+
+  // Next byte, or -1 at the end of the file
+  int Getc(void)
+  {
+    const Chunk &chunk = m_chunks[m_uCurrent];
+    if(m_uPos - chunk.uStart < chunk.uLength)
+    {
+      m_stats.uBufferReads++;
+      return chunk.pData[m_uPos++ - chunk.uStart];
+    }
+
+    uint8_t uByte;
+    return Read(&uByte, 1) == 1 ? uByte : -1;
+  }
+
+  size_t Tell(void) const
+  {
+    return m_uPos;
+  }
+
+  // Nothing is read until the next Read(), returns the new position which is at most the size
+  size_t Seek(size_t uPos)
+  {
+    m_uPos = uPos < m_uSize ? uPos : m_uSize;
+    return m_uPos;
+  }
+
+  size_t GetSize(void) const
+  {
+    return m_uSize;
+  }
+
+  // Read the chunk after the one being read if it is not already buffered, false on an error.
+  // Blocks until the chunk is read.
+  bool Prefetch(void);
+
+  const Stats &GetStats(void) const
+  {
+    return m_stats;
+  }
+
+  void ResetStats(void)
+  {
+    m_stats = {};
+  }
+
+private:
+  struct Chunk
+  {
+    size_t   uStart;    // file position of pData[0], on a sector boundary
+    uint32_t uLength;   // bytes buffered, 0 for none
+    uint8_t  *pData;
+  };
+
+  Chunk *Find(size_t uPos);
+  bool   Load(Chunk &chunk, size_t uPos);
+  bool   ReadAt(size_t uPos, void *pBuffer, size_t uLength, size_t &uRead);
+
+  FIL      m_file;
+  bool     m_bOpen = false;
+  bool     m_bPsram;
+  uint32_t m_uChunkSize;
+  uint8_t  *m_pBuffer;
+  Chunk    m_chunks[2];
+  uint8_t  m_uCurrent = 0;  // the chunk last read from
+  size_t   m_uPos = 0;
+  size_t   m_uSize = 0;
+  Stats    m_stats = {};
+};
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <string.h>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "PsramDma.h"
+
+// DamageTracker
+//  Records the rectangles drawn into a buffer as a short sorted list of disjoint spans per
+//  row. Spans that overlap or touch are merged, so scattered boxes keep their own spans and
+//  clearing them costs about as much as drawing them. Only when a row runs out of spans is
+//  it merged into one span covering all of its damage.
+class DamageTracker
+{
+public:
+  struct Span
+  {
+    int16_t x1; // first damaged pixel
+    int16_t x2; // one past the last damaged pixel
+  };
+
+  // Disjoint spans kept per row before the row is merged into one
+  static const uint8_t c_uMaxSpans = 8;
+
+  DamageTracker(uint16_t uWidth, uint16_t uHeight) : m_uWidth(uWidth), m_uHeight(uHeight), m_yMin(uHeight)
+  {
+    m_pRows = new Row[uHeight];
+    for(uint16_t y = 0; y < m_uHeight; y++)
+      m_pRows[y].uCount = 0;
+  }
+
+  ~DamageTracker(void)
+  {
+    delete[] m_pRows;
+  }
+
+  DamageTracker(const DamageTracker&) = delete;
+  DamageTracker& operator = (const DamageTracker&) = delete;
+
+  // Forget all damage
+  void Reset(void)
+  {
+    for(uint16_t y = m_yMin; y < m_yMax; y++)
+      m_pRows[y].uCount = 0;
+
+    m_yMin = m_uHeight;
+    m_yMax = 0;
+  }
+
+  // Add a damaged rectangle, it is clipped to the buffer
+  void Add(const pimoroni::Rect &r)
+  {
+    int32_t x1 = r.x < 0 ? 0 : r.x;
+    int32_t y1 = r.y < 0 ? 0 : r.y;
+    int32_t x2 = r.x + r.w > m_uWidth ? m_uWidth : r.x + r.w;
+    int32_t y2 = r.y + r.h > m_uHeight ? m_uHeight : r.y + r.h;
+
+    if(x1 >= x2 || y1 >= y2)
+      return;
+
+    for(int32_t y = y1; y < y2; y++)
+      AddSpan(m_pRows[y], x1, x2);
+
+    if(y1 < m_yMin)
+      m_yMin = y1;
+    if(y2 > m_yMax)
+      m_yMax = y2;
+  }
+
+  // Add all the damage recorded in other, which must be the same size
+  void Add(const DamageTracker &other)
+  {
+    other.ForEachSpan([&](uint16_t y, uint16_t x, uint16_t w)
+    {
+      AddSpan(m_pRows[y], x, x + w);
+    });
+
+    if(other.m_yMin < m_yMin)
+      m_yMin = other.m_yMin;
+    if(other.m_yMax > m_yMax)
+      m_yMax = other.m_yMax;
+  }
+
+  bool IsEmpty(void) const
+  {
+    return m_yMin >= m_yMax;
+  }
+
+  bool IsRowDamaged(uint16_t y) const
+  {
+    return m_pRows[y].uCount != 0;
+  }
+
+  // Calls fn(y, x, w) for every damaged span
+  template<typename F>
+  void ForEachSpan(F fn) const
+  {
+    for(uint16_t y = m_yMin; y < m_yMax; y++)
+      ForEachSpan(y, fn);
+  }
+
+  // Calls fn(y, x, w) for the damaged spans of row y
+  template<typename F>
+  void ForEachSpan(uint16_t y, F fn) const
+  {
+    const Row &row = m_pRows[y];
+    for(uint8_t i = 0; i < row.uCount; i++)
+      fn(y, row.spans[i].x1, row.spans[i].x2 - row.spans[i].x1);
+  }
+
+  // Calls fn(x, y, w, h) for each span of runs of damaged rows that share the same spans
+  template<typename F>
+  void ForEachRect(F fn) const
+  {
+    uint16_t y = m_yMin;
+    while(y < m_yMax)
+    {
+      const Row &row = m_pRows[y];
+      uint16_t h = 1;
+
+      while(y + h < m_yMax && m_pRows[y + h].uCount == row.uCount &&
+            memcmp(m_pRows[y + h].spans, row.spans, row.uCount * sizeof(Span)) == 0)
+        h++;
+
+      for(uint8_t i = 0; i < row.uCount; i++)
+        fn(row.spans[i].x1, y, row.spans[i].x2 - row.spans[i].x1, h);
+      y += h;
+    }
+  }
+
+  // Fill the damaged spans of a buffer with uColour, returns the number of bytes written
+  size_t Clear(uint16_t *pBuffer, uint16_t uColour) const
+  {
+    size_t uBytes = 0;
+    ForEachSpan([&](uint16_t y, uint16_t x, uint16_t w)
+    {
+      uint16_t *pDst = pBuffer + y * m_uWidth + x;
+      if(uColour == 0)
+        memset(pDst, 0, w * 2);
+      else
+      {
+        for(uint16_t i = 0; i < w; i++)
+          pDst[i] = uColour;
+      }
+      uBytes += w * 2;
+    });
+    return uBytes;
+  }
+
+  // Clear() for a P8 buffer
+  size_t Clear(uint8_t *pBuffer, uint8_t uColour) const
+  {
+    size_t uBytes = 0;
+    ForEachSpan([&](uint16_t y, uint16_t x, uint16_t w)
+    {
+      memset(pBuffer + y * m_uWidth + x, uColour, w);
+      uBytes += w;
+    });
+    return uBytes;
+  }
+
+  // As Clear() but the spans are queued on a PsramDma, returns the fence of the last fill
+  PsramDma::Fence ClearAsync(PsramDma &dma, uint16_t *pBuffer, uint16_t uColour) const
+  {
+    ForEachRect([&](uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+    {
+      dma.Fill(pBuffer + y * m_uWidth + x, uColour, w, h, m_uWidth);
+    });
+    return dma.GetLastFence();
+  }
+
+private:
+  struct Row
+  {
+    uint8_t uCount;
+    Span    spans[c_uMaxSpans]; // sorted by x1
+  };
+
+  // Merge [x1, x2) into the spans it overlaps or touches
+  static void AddSpan(Row &row, int16_t x1, int16_t x2)
+  {
+    uint8_t uFirst = 0;
+    while(uFirst < row.uCount && row.spans[uFirst].x2 < x1)
+      uFirst++;
+
+    uint8_t uLast = uFirst;
+    while(uLast < row.uCount && row.spans[uLast].x1 <= x2)
+    {
+      if(row.spans[uLast].x1 < x1)
+        x1 = row.spans[uLast].x1;
+      if(row.spans[uLast].x2 > x2)
+        x2 = row.spans[uLast].x2;
+      uLast++;
+    }
+
+    if(uLast > uFirst)
+    {
+      // replaces the spans it merged with
+      row.spans[uFirst] = {x1, x2};
+      memmove(&row.spans[uFirst + 1], &row.spans[uLast], (row.uCount - uLast) * sizeof(Span));
+      row.uCount -= uLast - uFirst - 1;
+    }
+    else if(row.uCount < c_uMaxSpans)
+    {
+      memmove(&row.spans[uFirst + 1], &row.spans[uFirst], (row.uCount - uFirst) * sizeof(Span));
+      row.spans[uFirst] = {x1, x2};
+      row.uCount++;
+    }
+    else
+    {
+      // out of spans, one span covers the whole row's damage
+      row.spans[0].x1 = x1 < row.spans[0].x1 ? x1 : row.spans[0].x1;
+      row.spans[0].x2 = x2 > row.spans[row.uCount - 1].x2 ? x2 : row.spans[row.uCount - 1].x2;
+      row.uCount = 1;
+    }
+  }
+
+  uint16_t m_uWidth;
+  uint16_t m_uHeight;
+  uint16_t m_yMin;
+  uint16_t m_yMax = 0;
+  Row      *m_pRows;
+};
+
+// DamageDoubleBuffer
+//  Keeps two RGB565 back buffers in step by only touching the rows that have been drawn to.
+//
+//  modeClear       : before drawing, the back buffer has whatever was drawn into it two frames
+//                    ago cleared to the clear colour. Use when the whole scene is redrawn every frame.
+//  modeCopyForward : before drawing, whatever was drawn into the front buffer last frame is copied
+//                    into the back buffer. Use when drawing accumulates over frames.
+//
+//  Each frame:
+//    Repair()       - clear or copy the damaged spans into the back buffer, or RepairAsync() with DMA
+//    AddDamage()    - for everything drawn into the back buffer
+//    Swap()         - then display GetFrontBuffer() and draw into GetBackBuffer()
+class DamageDoubleBuffer
+{
+public:
+  typedef enum
+  {
+    modeClear,
+    modeCopyForward,
+  } Mode;
+
+  DamageDoubleBuffer(uint16_t uWidth, uint16_t uHeight, uint16_t *pBuffer0, uint16_t *pBuffer1, Mode mode = modeClear, uint16_t uClearColour = 0)
+    : m_uWidth(uWidth), m_mode(mode), m_uClearColour(uClearColour), m_trackers{{uWidth, uHeight}, {uWidth, uHeight}}
+  {
+    m_pBuffers[0] = pBuffer0;
+    m_pBuffers[1] = pBuffer1;
+  }
+
+  uint16_t *GetBackBuffer(void) const
+  {
+    return m_pBuffers[m_uBack];
+  }
+
+  uint16_t *GetFrontBuffer(void) const
+  {
+    return m_pBuffers[!m_uBack];
+  }
+
+  // Record a rectangle drawn into the back buffer
+  void AddDamage(const pimoroni::Rect &r)
+  {
+    m_trackers[m_uBack].Add(r);
+  }
+
+  // Bring the back buffer up to date before drawing, returns the number of bytes written
+  size_t Repair(void)
+  {
+    size_t uBytes = 0;
+    uint16_t *pBack = m_pBuffers[m_uBack];
+
+    if(m_mode == modeClear)
+      uBytes = m_trackers[m_uBack].Clear(pBack, m_uClearColour);
+    else
+    {
+      uint16_t *pFront = m_pBuffers[!m_uBack];
+      m_trackers[!m_uBack].ForEachSpan([&](uint16_t y, uint16_t x, uint16_t w)
+      {
+        uint32_t uOffset = y * m_uWidth + x;
+        memcpy(pBack + uOffset, pFront + uOffset, w * 2);
+        uBytes += w * 2;
+      });
+    }
+
+    m_trackers[m_uBack].Reset();
+    return uBytes;
+  }
+
+  // As Repair() but the spans are queued on a PsramDma, wait on the fence returned before drawing
+  PsramDma::Fence RepairAsync(PsramDma &dma)
+  {
+    uint16_t *pBack = m_pBuffers[m_uBack];
+
+    if(m_mode == modeClear)
+      m_trackers[m_uBack].ClearAsync(dma, pBack, m_uClearColour);
+    else
+    {
+      uint16_t *pFront = m_pBuffers[!m_uBack];
+      m_trackers[!m_uBack].ForEachRect([&](uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+      {
+        uint32_t uOffset = y * m_uWidth + x;
+        dma.Copy(pBack + uOffset, pFront + uOffset, w, h, m_uWidth, m_uWidth);
+      });
+    }
+
+    m_trackers[m_uBack].Reset();
+    return dma.GetLastFence();
+  }
+
+  // Swap front and back buffers
+  void Swap(void)
+  {
+    m_uBack = !m_uBack;
+  }
+
+private:
+  uint16_t      m_uWidth;
+  Mode          m_mode;
+  uint16_t      m_uClearColour;
+  uint16_t      *m_pBuffers[2];
+  uint8_t       m_uBack = 1;
+  DamageTracker m_trackers[2];
+};
@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#include "DisplayList.h"
+
+using namespace pimoroni;
+
+DisplayList::DisplayList(uint16_t uHeight, uint16_t uBandHeight)
+  : m_uHeight(uHeight), m_uBandHeight(uBandHeight), m_uBandCount((uHeight + uBandHeight - 1) / uBandHeight)
+{
+  m_binStarts.resize(m_uBandCount + 1);
+}
+
+void DisplayList::text(PicoGraphics &graphics, const std::string &t, const Point &p, int32_t wrap, uint8_t scale)
+{
+  // count the lines the same way PicoGraphics wraps, each word carries the space before it
+  int32_t iLines = 1;
+  int32_t iLineWidth = 0;
+  size_t i = 0;
+  while(i < t.length())
+  {
+    if(t[i] == '\n')
+    {
+      iLines++;
+      iLineWidth = 0;
+      i++;
+      continue;
+    }
+
+    size_t next = t.find_first_of(" \n", i + 1);
+    if(next == std::string::npos)
+      next = t.length();
+
+    int32_t iWordWidth = graphics.measure_text(t.substr(i, next - i), scale);
+    if(iLineWidth != 0 && iLineWidth + iWordWidth > wrap)
+    {
+      iLines++;
+      iLineWidth = 0;
+    }
+    iLineWidth += iWordWidth;
+    i = next;
+  }
+
+  uint16_t uOffset = m_text.size();
+  m_text.insert(m_text.end(), t.begin(), t.end());
+  m_text.push_back('\0');
+
+  // the bitmap fonts leave a row between lines
+  int32_t iLineHeight = (graphics.bitmap_font->height + 1) * scale;
+  Add(DrawCommand::Text(m_uPen, p, wrap, scale, iLines * iLineHeight, uOffset));
+}
+
+void DisplayList::Clear(void)
+{
+  m_commands.clear();
+  m_text.clear();
+  m_bSorted = false;
+}
+
+void DisplayList::Sort(void)
+{
+  if(m_bSorted)
+    return;
+
+  // bin the commands by band with a counting sort, keeping draw order within each band
+  std::fill(m_binStarts.begin(), m_binStarts.end(), 0);
+  for(const DrawCommand &command : m_commands)
+  {
+    Rect bounds = command.Bounds();
+    int32_t y1 = std::max(bounds.y, (int32_t)0);
+    int32_t y2 = std::min(bounds.y + bounds.h, (int32_t)m_uHeight);
+    for(int32_t iBand = y1 / m_uBandHeight; iBand * m_uBandHeight < y2; iBand++)
+      m_binStarts[iBand + 1]++;
+  }
+
+  for(uint16_t uBand = 0; uBand < m_uBandCount; uBand++)
+    m_binStarts[uBand + 1] += m_binStarts[uBand];
+
+  m_binEntries.resize(m_binStarts[m_uBandCount]);
+  for(uint32_t uIndex = 0; uIndex < m_commands.size(); uIndex++)
+  {
+    Rect bounds = m_commands[uIndex].Bounds();
+    int32_t y1 = std::max(bounds.y, (int32_t)0);
+    int32_t y2 = std::min(bounds.y + bounds.h, (int32_t)m_uHeight);
+    for(int32_t iBand = y1 / m_uBandHeight; iBand * m_uBandHeight < y2; iBand++)
+      m_binEntries[m_binStarts[iBand]++] = uIndex;
+  }
+
+  // filling moved each start on to the next band's start
+  for(uint16_t uBand = m_uBandCount; uBand > 0; uBand--)
+    m_binStarts[uBand] = m_binStarts[uBand - 1];
+  m_binStarts[0] = 0;
+
+  m_bSorted = true;
+}
+
+void DisplayList::ReplayBand(uint16_t uBand, PicoGraphics &graphics, int16_t iOriginY) const
+{
+  for(uint32_t uEntry = m_binStarts[uBand]; uEntry < m_binStarts[uBand + 1]; uEntry++)
+    m_commands[m_binEntries[uEntry]].Execute(graphics, m_text.data(), iOriginY);
+}
+
+void DisplayList::Replay(PicoGraphics &graphics)
+{
+  Sort();
+
+  Rect clip = graphics.clip;
+  for(uint16_t uBand = 0; uBand < m_uBandCount; uBand++)
+  {
+    if(m_binStarts[uBand] == m_binStarts[uBand + 1])
+      continue;
+
+    Rect band = clip.intersection(Rect(0, uBand * m_uBandHeight, graphics.bounds.w, m_uBandHeight));
+    if(band.empty())
+      continue;
+
+    graphics.set_clip(band);
+    ReplayBand(uBand, graphics);
+  }
+  graphics.set_clip(clip);
+}
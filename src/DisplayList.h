@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "DrawCommand.h"
+
+// DisplayList
+//  Records PicoGraphics calls as DrawCommands and replays them in scan order. The frame is
+//  cut into bands of rows and each command is binned into the bands it touches, Replay()
+//  then draws one band at a time, clipped to the band, so the writes to psram sweep down
+//  the frame rather than jumping around it in object order.
+//
+//  The binning is only redone after the list changes, so a list that stays the same, like
+//  some help text, is recorded once and replayed as often as needed for the cost of the
+//  draws alone.
+//
+//  Usage:
+//    set_pen(), rectangle(), circle(), pixel_span(), text() - record
+//    Replay(graphics)                                      - draw it, as often as needed
+//    Clear()                                               - to record something else
+class DisplayList
+{
+public:
+  DisplayList(uint16_t uHeight, uint16_t uBandHeight = 16);
+
+  void set_pen(uint c)
+  {
+    m_uPen = c;
+  }
+
+  void rectangle(const pimoroni::Rect &r)
+  {
+    Add(DrawCommand::Rectangle(m_uPen, r));
+  }
+
+  void circle(const pimoroni::Point &p, int32_t radius)
+  {
+    Add(DrawCommand::Circle(m_uPen, p, radius));
+  }
+
+  void pixel_span(const pimoroni::Point &p, int32_t l)
+  {
+    Add(DrawCommand::PixelSpan(m_uPen, p, l));
+  }
+
+  // Record a command built elsewhere
+  void Add(const DrawCommand &command)
+  {
+    m_commands.push_back(command);
+    m_bSorted = false;
+  }
+
+  // As PicoGraphics::text() with graphics' bitmap font, the wrapping is worked out with
+  // graphics.measure_text() and the font's height when it is recorded to find the rows it
+  // covers, so set the font first
+  void text(pimoroni::PicoGraphics &graphics, const std::string &t, const pimoroni::Point &p, int32_t wrap, uint8_t scale = 2);
+
+  // Forget everything recorded
+  void Clear(void);
+
+  bool IsEmpty(void) const
+  {
+    return m_commands.empty();
+  }
+
+  size_t GetCount(void) const
+  {
+    return m_commands.size();
+  }
+
+  const std::vector<DrawCommand> &GetCommands(void) const
+  {
+    return m_commands;
+  }
+
+  // Strings the text commands point into
+  const char *GetText(void) const
+  {
+    return m_text.data();
+  }
+
+  uint16_t GetBandHeight(void) const
+  {
+    return m_uBandHeight;
+  }
+
+  uint16_t GetBandCount(void) const
+  {
+    return m_uBandCount;
+  }
+
+  // Bin the commands by band if they have changed, Replay() and ReplayBand() do this as needed
+  void Sort(void);
+
+  // Draw the whole list a band at a time, within the graphics' current clip
+  void Replay(pimoroni::PicoGraphics &graphics);
+
+  // Draw the commands touching one band in the order they were recorded, the caller clips.
+  // Row iOriginY of the frame is drawn at row 0 of graphics. Sort() must have been called
+  // since the list last changed.
+  void ReplayBand(uint16_t uBand, pimoroni::PicoGraphics &graphics, int16_t iOriginY = 0) const;
+
+private:
+  uint16_t                 m_uHeight;
+  uint16_t                 m_uBandHeight;
+  uint16_t                 m_uBandCount;
+  uint16_t                 m_uPen = 0;
+  bool                     m_bSorted = true;
+
+  std::vector<DrawCommand> m_commands;
+  std::vector<char>        m_text;          // text commands' strings, nul terminated
+  std::vector<uint32_t>    m_binStarts;     // per band, first entry in m_binEntries
+  std::vector<uint32_t>    m_binEntries;    // command indices, in draw order per band
+};
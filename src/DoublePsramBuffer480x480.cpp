@@ -20,18 +20,36 @@
 // This means you need to keep these back buffers in sync, the psram is pretty
 // slow on the presto, so clearing or copying a buffer every frame or can be quite costly.
 //
-// This example bounces some boxes around, there are different clear stratagies that
-// you can set using the define CLEAR_TYPE to see the speed differences.
+// This example bounces some boxes around, DamageDoubleBuffer remembers which rows
+// were drawn into each back buffer and only clears those spans before the next draw.
 //
-// Note: Timings and fps data are logged to the USB UART, if you attach a 
-//       serial monitor to see them then you may get some slight glitching
-//       with the display.
+// There are different ways of drawing that you can set using the define DRAW_MODE
+// to see the speed differences.
+//
+// FrameScheduler waits for the vsync on core 1, so the blocks for the next frame
+// are updated while the last frame waits to be shown and V in the log is only
+// what is left of the wait once the update is done. MOVED_BLOCK_COUNT blocks
+// are moved each frame, 5000 by default, and the first BLOCK_COUNT drawn, so U=
+// in the log is the update time at that scale.
+//
+// Note: A summary of the phase timings and fps is logged to the USB UART every
+//       128 frames by FrameProfiler, the frames themselves are only timed. The
+//       PsramArena line after it shows the bytes the rectangles drawn each frame
+//       took from the arena, and the most any frame took.
 // ******************************************************************************
 
 #include "libraries/pico_graphics/pico_graphics.hpp"
 #include "drivers/st7701/st7701Cached.hpp"
 
 #include "PicoPlusPsram.h"
+#include "PsramArena.h"
+#include "DamageDoubleBuffer.h"
+#include "StripRenderer.h"
+#include "SplitRenderer.h"
+#include "DisplayList.h"
+#include "PsramDma.h"
+#include "ParticleSystem.h"
+#include "FrameScheduler.h"
 #include "Elapsed.h"
 #include "FT6236.h"
 
@@ -47,32 +65,43 @@ static const uint LCD_DAT = 27;
 static const uint LCD_DC = -1;
 static const uint LCD_D0 = 1;
 
-struct pt
-{
-  float x;
-  float y;
-  float xVeryOld;
-  float yVeryOld;
-  float xOld;
-  float yOld;
-  float dx;
-  float dy;
-  uint16_t use_pen;
-};
-
-std::vector<pt> pixels;
-
 #define PIX_WH 16
 #define BLOCK_COUNT 100
 
-// CLEAR_TYPE 0 = no clear, 1 = partial clear, 2 = memset clear, 3 = picographics clear
-#define CLEAR_TYPE 1
+// Blocks moved each frame, only the first BLOCK_COUNT are drawn, so U= shows the update
+// of 5000 blocks while the drawing stays the same
+#define MOVED_BLOCK_COUNT 5000
+
+// DRAW_MODE 0 = draw straight into psram, 1 = rasterise in SRAM strips and write them to psram,
+//           2 = draw straight into psram on both cores, each drawing alternate bands of rows,
+//           3 = record into a display list and replay it into psram in row order
+#define DRAW_MODE 0
+
+// USE_DMA 0 = clear with the CPU, 1 = clear with DMA while the blocks are updated (DRAW_MODE 0, 2 and 3)
+#define USE_DMA 1
+
+// Phases timed each frame, the names match the log
+enum { phaseUpdate, phaseClear, phaseDraw, phaseVsync, phaseCount };
+static const char * const phaseNames[phaseCount] = {"U", "C", "D", "V"};
 
 FT6236 touchDisplay;
 
 uint16_t                *back_buffers[2]; // Two back buffers to use
+DamageDoubleBuffer      *buffers;         // Keeps the back buffers in sync
 ST7701Cached            *presto;          // Sends data to the display
+FrameScheduler          *scheduler;       // Waits for vsync while the next frame is updated
+ParticleSystem          *blocks;          // The boxes, moved in fixed point
 PicoGraphics_PenRGB565  *graphics;        // We draw with this
+#if DRAW_MODE == 1
+StripRenderer           *strips;          // Or this
+#elif DRAW_MODE == 2
+SplitRenderer           *split;           // Or this on both cores
+#elif DRAW_MODE == 3
+DisplayList             *list;            // Or this in row order
+#endif
+#if USE_DMA
+PsramDma                *dma;             // Clears the back buffers
+#endif
 
 int main()
 {
@@ -91,8 +120,14 @@ int main()
   gpio_set_dir(LCD_CS, 1);
 
   // allocate 480x480 back buffers in psram, use uncached address
-  back_buffers[0] = (uint16_t *)ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2) + 0x02000000;
-  back_buffers[1] = (uint16_t *)ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2) + 0x02000000;
+  {
+    PsramTrace::Scope tag("framebuffers");
+    back_buffers[0] = (uint16_t *)ps.GetUncachedAddress(ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2, PicoPlusPsram::heapFrame));
+    back_buffers[1] = (uint16_t *)ps.GetUncachedAddress(ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2, PicoPlusPsram::heapFrame));
+  }
+
+  // take the region for per frame allocations now, rather than part way through the first frame
+  PsramArena &arena = PsramArena::getInstance();
 
   // Use the ST7701Cached presto object, this works by providing the back_buffer it whould use to send to the display
   presto = new ST7701Cached(FRAME_WIDTH, FRAME_HEIGHT, ROTATE_0, SPIPins{spi1, LCD_CS, LCD_CLK, LCD_DAT, PIN_UNUSED, LCD_DC, BACKLIGHT}, (uint16_t *)back_buffers[0]);
@@ -100,117 +135,125 @@ int main()
   // We use the other back_buffer for picographics.
   graphics = new PicoGraphics_PenRGB565(FRAME_WIDTH, FRAME_HEIGHT, (uint16_t *)back_buffers[1]);
 
-  // set displayBuffer to the buffer currently being displayed
-  uint8_t displayBuffer = 0;
+  // back_buffers[0] is displayed first, only the damaged spans are cleared each frame
+  buffers = new DamageDoubleBuffer(FRAME_WIDTH, FRAME_HEIGHT, back_buffers[0], back_buffers[1]);
+
+#if DRAW_MODE == 1
+  strips = new StripRenderer(FRAME_WIDTH, FRAME_HEIGHT);
+#elif DRAW_MODE == 2
+  split = new SplitRenderer(FRAME_WIDTH, FRAME_HEIGHT, back_buffers[1]);
+#elif DRAW_MODE == 3
+  list = new DisplayList(FRAME_HEIGHT);
+#endif
+#if USE_DMA
+  dma = new PsramDma();
+#endif
+
+  // wait for vsync on core 1, unless it is drawing
+  scheduler = new FrameScheduler(*presto, FRAME_HEIGHT, DRAW_MODE != 2);
 
   // Init the ST7701 display and clear back buffers
   presto->init();
   memset(back_buffers[0], 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
   memset(back_buffers[1], 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
   
-  // inititalise pixels
-  pixels.clear();
-  for (int i = 0; i < BLOCK_COUNT; i++)
+  // inititalise blocks, kept in SRAM as fixed point
+  blocks = new ParticleSystem(MOVED_BLOCK_COUNT, graphics->bounds.w - PIX_WH, graphics->bounds.h - PIX_WH);
+  for (int i = 0; i < MOVED_BLOCK_COUNT; i++)
   {
-    pt pixel;
-    pixel.x = rand() % (graphics->bounds.w - PIX_WH);
-    pixel.y = rand() % (graphics->bounds.h - PIX_WH);
-    pixel.xOld = pixel.x;
-    pixel.yOld = pixel.y;
-    pixel.xVeryOld = pixel.x;
-    pixel.yVeryOld = pixel.y;
-    
-    pixel.dx = float(rand() % 255) / 64.0f;
-    pixel.dy = float(rand() % 255) / 64.0f;
-    pixel.use_pen = graphics->create_pen(rand() % 255, rand() % 255, rand() % 255);
-    pixels.push_back(pixel);
+    float x = rand() % (graphics->bounds.w - PIX_WH);
+    float y = rand() % (graphics->bounds.h - PIX_WH);
+
+    float dx = float(rand() % 255) / 64.0f;
+    float dy = float(rand() % 255) / 64.0f;
+    uint16_t use_pen = graphics->create_pen(rand() % 255, rand() % 255, rand() % 255);
+    blocks->Add(x, y, dx, dy, use_pen);
   }
 
 
+  // Used for timings
+  FrameProfiler<phaseCount> profiler(phaseNames, 0);
+  uint32_t frame_count = 0;
+
   while (true)
   {
-    float vsyncMs  = 0;
-    float clearMs  = 0;
-    float drawMs   = 0;
-    float totalMs  = 0;
-    float updateMs = 0;
-    
-    // Used for timings
-    Elapsed elapsed;
-
-    // update pixels
-    for (auto &pixel : pixels)
-    {
-      pixel.xVeryOld = pixel.xOld;
-      pixel.yVeryOld = pixel.yOld;
-      pixel.xOld = pixel.x;
-      pixel.yOld = pixel.y;
-
-      pixel.x += pixel.dx;
-      pixel.y += pixel.dy;
-      if (pixel.x < 0) 
-      {
-        pixel.x = 0 - pixel.x;
-        pixel.dx *= -1;
-      } else if (pixel.x >= graphics->bounds.w - PIX_WH) 
-      {
-        pixel.x = graphics->bounds.w - (graphics->bounds.w-(graphics->bounds.w - PIX_WH));
-        pixel.dx *= -1;
-      }
+    profiler.BeginFrame();
 
-      if (pixel.y < 0)
-      {
-        pixel.y = 0 - pixel.y;
-        pixel.dy *= -1;
-      } else if (pixel.y >= graphics->bounds.h - PIX_WH)
-      {
-        pixel.y = graphics->bounds.h - (graphics->bounds.h-(graphics->bounds.h - PIX_WH));
-        pixel.dy *= -1;
-      }
-    }
-    updateMs = elapsed.elapsedMs();
+    // update blocks, the last frame can still be waiting for its vsync
+    blocks->Update();
+    profiler.Lap(phaseUpdate);
 
-    // clear old pixels
-    // CLEAR_TYPE 0 = no clear, 1 = partial clear, 2 = memset clear, 3 = picographics clear
+    // wait for the last frame to be shown, its back buffer is free to draw into from here
+    scheduler->WaitForSwap();
+    profiler.Lap(phaseVsync);
 
-#if CLEAR_TYPE == 1    
-    graphics->set_pen(0);
-    for(auto &pixel : pixels) {
-      graphics->rectangle({(int32_t)pixel.xVeryOld, (int32_t)pixel.yVeryOld, PIX_WH, PIX_WH});
-    }
-#elif CLEAR_TYPE == 2
-    memset(back_buffers[!displayBuffer], 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
-#elif CLEAR_TYPE == 3
-    graphics->set_pen(0);
-    graphics->clear();
+#if DRAW_MODE != 1 && USE_DMA
+    // start clearing the spans drawn into this back buffer two frames ago
+    PsramDma::Fence clearFence = buffers->RepairAsync(*dma);
 #endif
-    clearMs = elapsed.elapsedMs();
-
-    // draw pixels
-    for(auto &pixel : pixels) {
-      graphics->set_pen(pixel.use_pen);
-      graphics->rectangle({(int32_t)pixel.x, (int32_t)pixel.y, PIX_WH, PIX_WH});
-    }
-    drawMs = elapsed.elapsedMs();
 
-    // swap back buffers
-    displayBuffer = !displayBuffer;
-    graphics->set_framebuffer(back_buffers[!displayBuffer]);
-    presto->set_backbuffer(back_buffers[displayBuffer]);
+#if DRAW_MODE == 1
+    // nothing to clear, strips are cleared in SRAM and cover what was drawn last time
+#elif USE_DMA
+    // wait for the clear to finish
+    dma->Wait(clearFence);
+#else
+    // clear the spans drawn into this back buffer two frames ago
+    buffers->Repair();
+#endif
+    profiler.Lap(phaseClear);
 
-    // wait for vsync, buffers are swapped here
-    presto->wait_for_vsync();
-    vsyncMs = elapsed.elapsedMs();
+    // draw blocks, their rectangles are gathered first in memory that only lives for this frame
+    {
+      std::vector<Rect, PsramArena::Allocator<Rect>> rects;
+      rects.reserve(BLOCK_COUNT);
+      for(uint32_t i = 0; i < BLOCK_COUNT; i++)
+        rects.push_back(Rect(blocks->GetX(i), blocks->GetY(i), PIX_WH, PIX_WH));
+
+      for(uint32_t i = 0; i < rects.size(); i++) {
+#if DRAW_MODE == 1
+        strips->set_pen(blocks->GetPen(i));
+        strips->rectangle(rects[i]);
+#elif DRAW_MODE == 2
+        split->set_pen(blocks->GetPen(i));
+        split->rectangle(rects[i]);
+#elif DRAW_MODE == 3
+        list->set_pen(blocks->GetPen(i));
+        list->rectangle(rects[i]);
+#else
+        graphics->set_pen(blocks->GetPen(i));
+        graphics->rectangle(rects[i]);
+#endif
+#if DRAW_MODE != 1
+        buffers->AddDamage(rects[i]);
+#endif
+      }
+    }
+#if DRAW_MODE == 1
+    strips->Render(buffers->GetBackBuffer());
+#elif DRAW_MODE == 2
+    split->Render(buffers->GetBackBuffer());
+#elif DRAW_MODE == 3
+    list->Replay(*graphics);
+    list->Clear();
+#endif
+    profiler.Lap(phaseDraw);
 
+    // swap back buffers, memory allocated for this frame is released
+    buffers->Swap();
+    arena.Reset();
+    graphics->set_framebuffer(buffers->GetBackBuffer());
 
-    totalMs = updateMs + clearMs + drawMs + vsyncMs;
-    float fps = 1000.0f / totalMs;
+    // show it from the next vsync, the wait is on core 1
+    scheduler->Present(buffers->GetFrontBuffer());
 
-    printf("U=%.2f ", updateMs);
-    printf("C=%.2f ", clearMs);
-    printf("D=%.2f ", drawMs);
-    printf("V=%.2f ", vsyncMs);
-    printf("A=%.2f ", totalMs);
-    printf("F=%.2f\n", fps);
+    profiler.EndFrame();
+    if ((++frame_count & 127) == 0)
+    {
+      profiler.Report();
+      PsramArena::Stats arenaStats = arena.GetStats();
+      printf("arena last=%u high=%u of %u overflows=%u\n", (unsigned)arenaStats.uLastFrameBytes,
+             (unsigned)arenaStats.uHighWater, (unsigned)arenaStats.uArenaBytes, (unsigned)arenaStats.uOverflowCount);
+    }
   }
 }
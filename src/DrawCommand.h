@@ -0,0 +1,82 @@
+#pragma once
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+// DrawCommand
+//  A recorded PicoGraphics call, small enough to queue lots of them per frame.
+//  Bounds() gives the pixels it can touch so commands can be binned by row.
+//  Text is kept by whoever recorded it, the command holds its offset.
+struct DrawCommand
+{
+  typedef enum : uint8_t
+  {
+    typeRectangle,  // x, y, w, h
+    typeCircle,     // x, y, r
+    typePixelSpan,  // x, y, w
+    typeText,       // x, y, wrap in w, height in h, text offset in data, scale
+  } Type;
+
+  Type     type;
+  uint8_t  scale;
+  uint16_t pen;
+  int16_t  x;
+  int16_t  y;
+  int16_t  w;
+  int16_t  h;
+  uint16_t data;
+
+  static DrawCommand Rectangle(uint16_t pen, const pimoroni::Rect &r)
+  {
+    return {typeRectangle, 0, pen, (int16_t)r.x, (int16_t)r.y, (int16_t)r.w, (int16_t)r.h, 0};
+  }
+
+  static DrawCommand Circle(uint16_t pen, const pimoroni::Point &p, int32_t radius)
+  {
+    return {typeCircle, 0, pen, (int16_t)p.x, (int16_t)p.y, (int16_t)radius, 0, 0};
+  }
+
+  static DrawCommand PixelSpan(uint16_t pen, const pimoroni::Point &p, int32_t l)
+  {
+    return {typePixelSpan, 0, pen, (int16_t)p.x, (int16_t)p.y, (int16_t)l, 1, 0};
+  }
+
+  // height is the height of the wrapped text, offset where the recorder keeps the text
+  static DrawCommand Text(uint16_t pen, const pimoroni::Point &p, int32_t wrap, uint8_t scale, int32_t height, uint16_t offset)
+  {
+    return {typeText, scale, pen, (int16_t)p.x, (int16_t)p.y, (int16_t)wrap, (int16_t)height, offset};
+  }
+
+  pimoroni::Rect Bounds(void) const
+  {
+    if(type == typeCircle)
+      return pimoroni::Rect(x - w, y - w, w * 2 + 1, w * 2 + 1);
+    return pimoroni::Rect(x, y, w, h);
+  }
+
+  // pText is the recorder's text, only needed for text commands. Row iOriginY is drawn at
+  // row 0 of graphics, for drawing into a buffer that holds part of the frame.
+  void Execute(pimoroni::PicoGraphics &graphics, const char *pText = nullptr, int16_t iOriginY = 0) const
+  {
+    int32_t iY = y - iOriginY;
+
+    graphics.set_pen(pen);
+    switch(type)
+    {
+      case typeRectangle:
+        graphics.rectangle({x, iY, w, h});
+        break;
+
+      case typeCircle:
+        graphics.circle({x, iY}, w);
+        break;
+
+      case typePixelSpan:
+        graphics.pixel_span({x, iY}, w);
+        break;
+
+      case typeText:
+        graphics.text(pText + data, {x, iY}, w, scale);
+        break;
+    }
+  }
+};
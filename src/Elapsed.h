@@ -1,5 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
 class Elapsed
 {
 public:
@@ -24,3 +28,142 @@ public:
 private:
   uint64_t last_time;
 };
+
+// FrameProfiler
+//  Records the time spent in each named phase of a frame into a ring buffer of
+//  the last FRAMES frames and prints min/mean/p50/p99/max per phase every
+//  uReportFrames frames, or when Report() is called.
+//
+//  Recording a phase is a timer read and an add, all printing and sorting is
+//  left to the report so frame timings are not disturbed in between.
+//
+//  Each frame:
+//    BeginFrame()
+//    Lap(phase)          - time since the last lap or BeginFrame() is added to phase
+//    auto s = Measure()  - or time a scope, it ends when s is destroyed
+//    EndFrame()
+template<uint8_t PHASES, uint16_t FRAMES = 128>
+class FrameProfiler
+{
+public:
+  struct Stats
+  {
+    uint32_t uMin;
+    uint32_t uMean;
+    uint32_t uP50;
+    uint32_t uP99;
+    uint32_t uMax;
+  };
+
+  // Adds the time the scope was alive to a phase
+  class Scope
+  {
+  public:
+    Scope(FrameProfiler &profiler, uint8_t uPhase) : m_profiler(profiler), m_uPhase(uPhase)
+    {
+      m_startTime = time_us_64();
+    }
+
+    Scope(const Scope&) = delete;
+
+    ~Scope(void)
+    {
+      uint64_t time_now = time_us_64();
+      m_profiler.m_samples[m_profiler.m_uHead][m_uPhase] += (uint32_t)(time_now - m_startTime);
+      m_profiler.m_lastTime = time_now;
+    }
+
+  private:
+    FrameProfiler &m_profiler;
+    uint8_t       m_uPhase;
+    uint64_t      m_startTime;
+  };
+
+  // pNames are the short names printed for each phase, uReportFrames of 0 only reports on demand
+  FrameProfiler(const char * const (&pNames)[PHASES], uint16_t uReportFrames = FRAMES) : m_pNames(pNames), m_uReportFrames(uReportFrames)
+  {
+    memset(m_samples, 0, sizeof(m_samples));
+    m_lastTime = m_frameStartTime = time_us_64();
+  }
+
+  void BeginFrame(void)
+  {
+    memset(m_samples[m_uHead], 0, sizeof(m_samples[m_uHead]));
+    m_lastTime = m_frameStartTime = time_us_64();
+  }
+
+  void Lap(uint8_t uPhase)
+  {
+    uint64_t time_now = time_us_64();
+    m_samples[m_uHead][uPhase] += (uint32_t)(time_now - m_lastTime);
+    m_lastTime = time_now;
+  }
+
+  Scope Measure(uint8_t uPhase)
+  {
+    return Scope(*this, uPhase);
+  }
+
+  void EndFrame(void)
+  {
+    m_samples[m_uHead][PHASES] = (uint32_t)(time_us_64() - m_frameStartTime);
+
+    m_uHead = (m_uHead + 1) % FRAMES;
+    if(m_uCount < FRAMES)
+      m_uCount++;
+
+    if(m_uReportFrames && ++m_uFramesSinceReport >= m_uReportFrames)
+      Report();
+  }
+
+  // Stats in us over the recorded frames, uPhase of PHASES gives the whole frame
+  Stats GetStats(uint8_t uPhase) const
+  {
+    Stats stats = {};
+    uint32_t sorted[FRAMES];
+    uint64_t uTotal = 0;
+
+    if(!m_uCount)
+      return stats;
+
+    for(uint16_t i = 0; i < m_uCount; i++)
+    {
+      sorted[i] = m_samples[(m_uHead + FRAMES - m_uCount + i) % FRAMES][uPhase];
+      uTotal += sorted[i];
+    }
+    std::sort(sorted, sorted + m_uCount);
+
+    stats.uMin  = sorted[0];
+    stats.uMean = (uint32_t)(uTotal / m_uCount);
+    stats.uP50  = sorted[(m_uCount - 1) / 2];
+    stats.uP99  = sorted[((m_uCount - 1) * 99) / 100];
+    stats.uMax  = sorted[m_uCount - 1];
+    return stats;
+  }
+
+  // Print one line of min/mean/p50/p99/max in ms per phase, A is the whole frame and F the mean fps
+  void Report(void)
+  {
+    for(uint8_t uPhase = 0; uPhase <= PHASES; uPhase++)
+    {
+      Stats stats = GetStats(uPhase);
+      printf("%s=%.2f/%.2f/%.2f/%.2f/%.2f ", uPhase < PHASES ? m_pNames[uPhase] : "A",
+             stats.uMin / 1000.0f, stats.uMean / 1000.0f, stats.uP50 / 1000.0f, stats.uP99 / 1000.0f, stats.uMax / 1000.0f);
+
+      if(uPhase == PHASES)
+        printf("F=%.2f\n", stats.uMean ? 1000000.0f / stats.uMean : 0.0f);
+    }
+
+    m_uFramesSinceReport = 0;
+  }
+
+private:
+  const char * const (&m_pNames)[PHASES];
+  uint16_t m_uReportFrames;
+  uint16_t m_uFramesSinceReport = 0;
+  uint16_t m_uHead = 0;
+  uint16_t m_uCount = 0;
+  uint64_t m_lastTime;
+  uint64_t m_frameStartTime;
+  uint32_t m_samples[FRAMES][PHASES + 1]; // the last entry is the whole frame
+};
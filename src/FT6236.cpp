@@ -0,0 +1,224 @@
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#if !PRESTO_HOST
+#include "hardware/irq.h"
+#endif
+
+#include "FT6236.h"
+
+// The FT6236 being read by the interrupts
+static FT6236 *pInterruptTouch = nullptr;
+
+void FT6236::EnableInterrupt(void)
+{
+  if(m_bInterrupt)
+    return;
+
+  // pulse TOUCH_INT for each new report rather than holding it while touched
+  WriteReg(regIntMode, 1);
+
+  pInterruptTouch = this;
+  m_bInterrupt = true;
+
+  gpio_init(TOUCH_INT);
+  gpio_set_dir(TOUCH_INT, GPIO_IN);
+  gpio_pull_up(TOUCH_INT);
+
+#if !PRESTO_HOST
+  irq_add_shared_handler(I2C1_IRQ, I2cIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(I2C1_IRQ, true);
+#endif
+
+  gpio_add_raw_irq_handler(TOUCH_INT, TouchIrqHandler);
+  gpio_set_irq_enabled(TOUCH_INT, GPIO_IRQ_EDGE_FALL, true);
+#if !PRESTO_HOST
+  irq_set_enabled(IO_IRQ_BANK0, true);
+#endif
+}
+
+void FT6236::DisableInterrupt(void)
+{
+  if(!m_bInterrupt)
+    return;
+
+  gpio_set_irq_enabled(TOUCH_INT, GPIO_IRQ_EDGE_FALL, false);
+  gpio_remove_raw_irq_handler(TOUCH_INT, TouchIrqHandler);
+
+  while(m_bReading)
+    tight_loop_contents();
+
+#if !PRESTO_HOST
+  i2c_get_hw(i2c1)->intr_mask = 0;
+  irq_remove_handler(I2C1_IRQ, I2cIrqHandler);
+#endif
+
+  m_bInterrupt = false;
+  pInterruptTouch = nullptr;
+}
+
+// TOUCH_INT fell, a new report is ready
+void __not_in_flash_func(FT6236::TouchIrqHandler)(void)
+{
+  if(!(gpio_get_irq_event_mask(TOUCH_INT) & GPIO_IRQ_EDGE_FALL))
+    return;
+  gpio_acknowledge_irq(TOUCH_INT, GPIO_IRQ_EDGE_FALL);
+
+  FT6236 *pTouch = pInterruptTouch;
+  if(!pTouch)
+    return;
+
+  // a report signalled while the last is still being read is read straight after it
+  if(pTouch->m_bReading)
+  {
+    pTouch->m_bPending = true;
+    return;
+  }
+
+  pTouch->m_signalTime = time_us_64();
+  pTouch->StartRead();
+}
+
+#if PRESTO_HOST
+
+// The host has no i2c interrupt, the report is read straight away
+void FT6236::StartRead(void)
+{
+  uint8_t report[c_uReportSize];
+  uint8_t reg = 0;
+
+  i2c_write_blocking(i2c1, TOUCH_ADDR, &reg, 1, true);
+  i2c_read_blocking(i2c1, TOUCH_ADDR, report, c_uReportSize, false);
+  QueueReport(report, m_signalTime);
+}
+
+void FT6236::I2cIrqHandler(void)
+{
+}
+
+#else
+
+// Queue the register address write and the reads, the i2c interrupt fires once the whole report is in the RX FIFO
+void __not_in_flash_func(FT6236::StartRead)(void)
+{
+  i2c_hw_t *hw = i2c_get_hw(i2c1);
+
+  m_bReading = true;
+  m_bPending = false;
+
+  hw->enable = 0;
+  hw->tar = TOUCH_ADDR;
+  hw->enable = 1;
+
+  hw->rx_tl = c_uReportSize - 1;
+  hw->intr_mask = I2C_IC_INTR_MASK_M_RX_FULL_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+  hw->data_cmd = 0;
+  for(uint8_t i = 0; i < c_uReportSize; i++)
+  {
+    hw->data_cmd = I2C_IC_DATA_CMD_CMD_BITS |
+                   (i == 0 ? I2C_IC_DATA_CMD_RESTART_BITS : 0) |
+                   (i == c_uReportSize - 1 ? I2C_IC_DATA_CMD_STOP_BITS : 0);
+  }
+}
+
+void __not_in_flash_func(FT6236::I2cIrqHandler)(void)
+{
+  i2c_hw_t *hw = i2c_get_hw(i2c1);
+  FT6236 *pTouch = pInterruptTouch;
+
+  if(!pTouch || !pTouch->m_bReading || !(hw->intr_stat & (I2C_IC_INTR_STAT_R_RX_FULL_BITS | I2C_IC_INTR_STAT_R_TX_ABRT_BITS)))
+    return;
+
+  if(hw->intr_stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+  {
+    // not acknowledged, drop the report and anything read of it
+    hw->clr_tx_abrt;
+    while(hw->rxflr)
+      hw->data_cmd;
+  }
+  else
+  {
+    uint8_t report[c_uReportSize];
+    for(uint8_t i = 0; i < c_uReportSize; i++)
+      report[i] = (uint8_t)hw->data_cmd;
+
+    pTouch->QueueReport(report, pTouch->m_signalTime);
+  }
+
+  hw->intr_mask = 0;
+  pTouch->m_bReading = false;
+
+  if(pTouch->m_bPending)
+  {
+    pTouch->m_signalTime = time_us_64();
+    pTouch->StartRead();
+  }
+}
+
+#endif
+
+// Turn a register dump into events, touches no longer reported are released
+void __not_in_flash_func(FT6236::QueueReport)(const uint8_t *pReport, uint64_t time)
+{
+  uint8_t uCount = pReport[2] & 0x0f;
+  bool bSeen[c_uMaxTouches] = {};      // down in this report
+  bool bReported[c_uMaxTouches] = {};  // any event in this report
+
+  for(uint8_t i = 0; i < c_uMaxTouches && i < uCount; i++)
+  {
+    const uint8_t *pPoint = pReport + 0x03 + i * 6;
+    uint8_t uId = pPoint[2] >> 4;
+    if(uId >= c_uMaxTouches)
+      continue;
+
+    Event event;
+    event.time = time;
+    event.id = uId;
+    event.state = pPoint[0] >> 6;
+    event.x = ((pPoint[0] & 0x0f) << 8) | pPoint[1];
+    event.y = ((pPoint[2] & 0x0f) << 8) | pPoint[3];
+
+    if(event.state == STATE_NONE)
+      continue;
+
+    bSeen[uId] = event.state != STATE_UP;
+    bReported[uId] = true;
+    if(!m_events.Push(event))
+      m_uDropped = m_uDropped + 1;
+  }
+
+  for(uint8_t uId = 0; uId < c_uMaxTouches; uId++)
+  {
+    if(m_bActive[uId] && !bReported[uId])
+    {
+      Event event = {time, uId, STATE_UP, 0, 0};
+      if(!m_events.Push(event))
+        m_uDropped = m_uDropped + 1;
+    }
+    m_bActive[uId] = bSeen[uId];
+  }
+}
+
+bool FT6236::PopEvent(Event &event)
+{
+  if(!m_events.Pop(event))
+    return false;
+
+  Touch &touch = touches[event.id];
+  if(event.state == STATE_UP)
+  {
+    touch.active = false;
+    touch.dx = 0;
+    touch.dy = 0;
+  }
+  else
+  {
+    touch.dx = event.x - touch.x;
+    touch.dy = event.y - touch.y;
+    touch.x = event.x;
+    touch.y = event.y;
+    touch.active = true;
+  }
+  return true;
+}
@@ -2,6 +2,9 @@
 
 #include "hardware/i2c.h"
 #include "hardware/gpio.h"
+#include "common/pimoroni_common.hpp"
+
+#include "SpscQueue.h"
 
 #define TOUCH_INT   (32)
 #define TOUCH_I2C   (1)
@@ -15,10 +18,19 @@
 #define STATE_NONE    (0b11)
 
 // FT6236U
+//
+//  ReadTouch() polls the controller over i2c, blocking for the transfer. Alternatively
+//  EnableInterrupt() has the controller signal new reports on TOUCH_INT, each report is
+//  then read in the background by the i2c interrupt and queued as timestamped events.
+//  Update() applies the queued events so GetTouch() is current, or PopEvent() takes
+//  them one at a time. Frames with no touch activity then cost nothing.
 
 class FT6236
 {
 public:
+  // The controller tracks two touches, with ids 0 and 1
+  static const uint8_t c_uMaxTouches = 2;
+
   struct Touch
   {
     int16_t   id;
@@ -43,8 +55,19 @@ public:
     regThreshold  = 0x80,
     regFilter     = 0x85,
     regChipId     = 0xA3,
+    regIntMode    = 0xA4,
   } Reg;
 
+  // A touch point from one report, queued by the interrupt
+  struct Event
+  {
+    uint64_t  time;   // time_us_64() when the controller signalled
+    uint8_t   id;
+    uint8_t   state;  // STATE_DOWN, STATE_CONTACT or STATE_UP
+    int16_t   x;      // not used for STATE_UP
+    int16_t   y;
+  };
+
   FT6236(void)
   {
     i2c_init(i2c1, pimoroni::I2C_DEFAULT_BAUDRATE);
@@ -58,6 +81,7 @@ public:
 
   ~FT6236(void)
   {
+    DisableInterrupt();
     i2c_deinit(i2c1);
     
     gpio_set_function(TOUCH_SDA, GPIO_FUNC_NULL);
@@ -94,16 +118,16 @@ public:
     i2c_read_blocking(i2c1, TOUCH_ADDR, buffer, 16, false);
 
     int touchCount = buffer[2];
-    touches[0].active = false;
-    touches[1].active = false;
+    for (uint8_t i = 0; i < c_uMaxTouches; i++)
+      touches[i].active = false;
 
     if(touchCount)
     {
-      for (uint8_t i = 0; i < 2; i++)
+      for (uint8_t i = 0; i < c_uMaxTouches; i++)
       {
         int16_t uId = buffer[0x05 + i * 6] >> 4;
 
-        if(uId < 3)
+        if(uId < c_uMaxTouches)
         {
           int16_t x = ((buffer[0x03 + i * 6] & 0x0F) << 8) | buffer[0x04 + i * 6];
           int16_t y =  ((buffer[0x05 + i * 6] & 0x0F) << 8) | buffer[0x06 + i * 6];
@@ -120,13 +144,81 @@ public:
 
   const Touch &GetTouch(uint8_t id) const
   {
-    if(id < 3)
+    if(id < c_uMaxTouches)
       return touches[id];
     else
       return nullTouch;
   }
 
+  // Read reports in the background whenever the controller signals on TOUCH_INT,
+  // the blocking calls above must not be used while this is enabled
+  void EnableInterrupt(void);
+  void DisableInterrupt(void);
+
+  // Take the next queued event and apply it to the touch state, false if there are none
+  bool PopEvent(Event &event);
+
+  // Apply all the queued events, dx and dy are the movement over all of them.
+  // Returns the number of events applied.
+  uint32_t Update(void)
+  {
+    return Update([](const Event &event) {});
+  }
+
+  // As Update() but also passes each event to fnEvent(event), to see every sample
+  // since the last frame rather than just where each touch ended up
+  template<typename F>
+  uint32_t Update(F fnEvent)
+  {
+    int16_t x[c_uMaxTouches], y[c_uMaxTouches];
+    for(uint8_t i = 0; i < c_uMaxTouches; i++)
+    {
+      x[i] = touches[i].x;
+      y[i] = touches[i].y;
+    }
+
+    uint32_t uCount = 0;
+    Event event;
+    while(PopEvent(event))
+    {
+      fnEvent(event);
+      uCount++;
+    }
+
+    for(uint8_t i = 0; i < c_uMaxTouches; i++)
+    {
+      if(touches[i].active)
+      {
+        touches[i].dx = touches[i].x - x[i];
+        touches[i].dy = touches[i].y - y[i];
+      }
+    }
+    return uCount;
+  }
+
+  // Events lost because the queue was full
+  uint32_t GetDroppedCount(void) const
+  {
+    return m_uDropped;
+  }
+
 private:
-   Touch touches[2];
+  static const uint8_t c_uReportSize = 13;  // registers 0x00 to 0x0c cover both touch points
+
+  static void TouchIrqHandler(void);
+  static void I2cIrqHandler(void);
+
+  void StartRead(void);
+  void QueueReport(const uint8_t *pReport, uint64_t time);
+
+   Touch touches[c_uMaxTouches];
    Touch nullTouch;
+
+   SpscQueue<Event, 32> m_events;
+   bool                 m_bInterrupt = false;
+   bool                 m_bActive[c_uMaxTouches] = {};  // as last queued, interrupt only
+   volatile bool        m_bReading = false;
+   volatile bool        m_bPending = false;
+   volatile uint64_t    m_signalTime = 0;
+   volatile uint32_t    m_uDropped = 0;
 };
\ No newline at end of file
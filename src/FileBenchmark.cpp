@@ -0,0 +1,257 @@
+// ******************************************************************************
+// This benchmark compares reading a file on the SD card straight through FatFs
+// against the buffered fileio_* functions used by the vector fonts, which read
+// ahead through BufferedFile.
+//
+// A FILE_SIZE test file is written first if it is not already on the card. It
+// is then read a byte at a time, in small blocks and in large blocks both ways,
+// in short hops forward and back, and in small blocks with Prefetch() called
+// between them. The throughput and the number of f_read() calls are reported
+// with a checksum of the data. Each fileio_* run must sum to the same as the
+// FatFs run that reads the same bytes, a mismatch is printed as a FAIL line and
+// the host build exits with 1.
+//
+// If ASSET_NAME, made with AssetPack, is on the card it is also loaded into
+// PSRAM with AssetLoader, to compare with the raw read throughput, and through
+// TextureCache a few milliseconds a frame, to see how many frames it takes.
+//
+// Results are logged to the USB UART every 5 seconds.
+// ******************************************************************************
+
+#include "pico/stdlib.h"
+#include "ff.h"
+#include "af-file-io.h"
+
+#include "BufferedFile.h"
+#include "AssetLoader.h"
+#include "TextureCache.h"
+#include "PicoPlusPsram.h"
+
+#define FILE_NAME  "fileio.bin"
+#define FILE_SIZE  (256 * 1024)
+#define BYTE_COUNT (32 * 1024)   // byte at a time straight from FatFs is slow, only read this much
+#define ASSET_NAME "background.rgz"
+#define LOAD_US_PER_FRAME 2000
+
+static uint8_t block[16384];
+
+// Write the test file if it is not there already
+static bool CreateTestFile(void)
+{
+  FIL file;
+  if(f_open(&file, FILE_NAME, FA_READ) == FR_OK)
+  {
+    bool bOk = f_size(&file) == FILE_SIZE;
+    f_close(&file);
+    if(bOk)
+      return true;
+  }
+
+  if(f_open(&file, FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+    return false;
+
+  uint32_t uState = 0x12345678;
+  for(uint32_t uWritten = 0; uWritten < FILE_SIZE; uWritten += sizeof(block))
+  {
+    for(uint32_t i = 0; i < sizeof(block); i++)
+    {
+      uState = uState * 1664525 + 1013904223;
+      block[i] = uState >> 24;
+    }
+
+    UINT uBytes;
+    if(f_write(&file, block, sizeof(block), &uBytes) != FR_OK || uBytes != sizeof(block))
+    {
+      f_close(&file);
+      return false;
+    }
+  }
+  f_close(&file);
+  return true;
+}
+
+static void Report(const char *pName, uint32_t uBytes, uint64_t elapsedUs, uint32_t uFileReads, uint32_t uSum)
+{
+  printf("%-22s %8.1f KB/s  f_read=%-6u sum=%08x\n", pName,
+         elapsedUs ? (uBytes * 1000000.0f / 1024.0f) / elapsedUs : 0.0f, (unsigned)uFileReads, (unsigned)uSum);
+}
+
+static uint32_t uFailures = 0;
+
+// The fileio_* run should have read the same bytes as the FatFs one
+static void CheckSum(const char *pName, uint32_t uSum, uint32_t uExpected)
+{
+  if(uSum == uExpected)
+    return;
+
+  printf("FAIL %s sum=%08x, fatfs read sum=%08x\n", pName, (unsigned)uSum, (unsigned)uExpected);
+  uFailures++;
+}
+
+// Straight through FatFs, uBlockSize bytes per f_read(), returns the sum of the bytes read
+static uint32_t RunFatFs(const char *pName, uint32_t uBlockSize, uint32_t uTotal)
+{
+  FIL file;
+  if(f_open(&file, FILE_NAME, FA_READ) != FR_OK)
+  {
+    printf("FAIL %s cannot open %s\n", pName, FILE_NAME);
+    uFailures++;
+    return 0;
+  }
+
+  uint32_t uSum = 0;
+  uint32_t uReads = 0;
+  uint64_t startTime = time_us_64();
+  for(uint32_t uDone = 0; uDone < uTotal; uDone += uBlockSize)
+  {
+    UINT uBytes;
+    f_read(&file, block, uBlockSize, &uBytes);
+    uReads++;
+    for(UINT i = 0; i < uBytes; i++)
+      uSum += block[i];
+  }
+  uint64_t elapsedUs = time_us_64() - startTime;
+  f_close(&file);
+
+  Report(pName, uTotal, elapsedUs, uReads, uSum);
+  return uSum;
+}
+
+// Through fileio_*, a block size of 1 uses fileio_getc(), returns the sum of the bytes read
+static uint32_t RunFileIo(const char *pName, uint32_t uBlockSize, uint32_t uTotal, bool bPrefetch)
+{
+  void *pFile = fileio_open(FILE_NAME);
+  if(!pFile)
+  {
+    printf("FAIL %s cannot open %s\n", pName, FILE_NAME);
+    uFailures++;
+    return 0;
+  }
+
+  BufferedFile *pBuffered = (BufferedFile *)pFile;
+
+  uint32_t uSum = 0;
+  uint64_t startTime = time_us_64();
+  for(uint32_t uDone = 0; uDone < uTotal; uDone += uBlockSize)
+  {
+    if(uBlockSize == 1)
+      uSum += fileio_getc(pFile);
+    else
+    {
+      size_t uBytes = fileio_read(pFile, block, uBlockSize);
+      for(size_t i = 0; i < uBytes; i++)
+        uSum += block[i];
+    }
+
+    // a caller with time to spare reads ahead
+    if(bPrefetch)
+      pBuffered->Prefetch();
+  }
+  uint64_t elapsedUs = time_us_64() - startTime;
+
+  Report(pName, uTotal, elapsedUs, pBuffered->GetStats().uFileReads, uSum);
+  fileio_close(pFile);
+  return uSum;
+}
+
+// Short hops forward and back through the file, 16 bytes at a time, as when parsing tables
+static void RunSeeks(void)
+{
+  void *pFile = fileio_open(FILE_NAME);
+  if(!pFile)
+    return;
+
+  uint32_t uSum = 0;
+  uint32_t uBytes = 0;
+  size_t uPos = 0;
+  uint64_t startTime = time_us_64();
+  while(uPos + 1024 + 16 <= FILE_SIZE)
+  {
+    fileio_seek(pFile, uPos + 1024);
+    uBytes += fileio_read(pFile, block, 16);
+    fileio_seek(pFile, uPos);
+    uBytes += fileio_read(pFile, block + 16, 16);
+    for(uint32_t i = 0; i < 32; i++)
+      uSum += block[i];
+    uPos += 64;
+  }
+  uint64_t elapsedUs = time_us_64() - startTime;
+
+  Report("fileio seek+16", uBytes, elapsedUs, ((BufferedFile *)pFile)->GetStats().uFileReads, uSum);
+  fileio_close(pFile);
+}
+
+// Load ASSET_NAME into psram, the throughput is of the compressed data read
+static void RunAsset(void)
+{
+  AssetLoader loader;
+
+  uint64_t startTime = time_us_64();
+  void *pPixels = loader.Load(ASSET_NAME);
+  uint64_t elapsedUs = time_us_64() - startTime;
+  if(!pPixels)
+    return;
+
+  uint32_t uSum = 0;
+  for(uint32_t i = 0; i < loader.GetHeader().uDataSize; i++)
+    uSum += ((uint8_t *)pPixels)[i];
+
+  printf("%-22s %8.1f KB/s  %u pixel bytes from %u in %.1f ms sum=%08x\n", "asset load",
+         elapsedUs ? (loader.GetCompressedSize() * 1000000.0f / 1024.0f) / elapsedUs : 0.0f,
+         (unsigned)loader.GetHeader().uDataSize, (unsigned)loader.GetCompressedSize(), elapsedUs / 1000.0f, (unsigned)uSum);
+  PicoPlusPsram::getInstance().Free(pPixels);
+}
+
+// Ask TextureCache for ASSET_NAME each frame until it is loaded, loading for LOAD_US_PER_FRAME a frame
+static void RunTextureCache(void)
+{
+  TextureCache cache(1024 * 1024);
+
+  uint32_t uFrames = 0;
+  uint64_t startTime = time_us_64();
+  while(!cache.IsResident(ASSET_NAME) && !cache.GetStats().uLoadFailures)
+  {
+    cache.Get(ASSET_NAME);
+    cache.Update(LOAD_US_PER_FRAME);
+    uFrames++;
+  }
+  uint64_t elapsedUs = time_us_64() - startTime;
+
+  if(cache.IsResident(ASSET_NAME))
+    printf("%-22s %u frames loading for %u us, %.1f ms\n", "texture cache", (unsigned)uFrames, LOAD_US_PER_FRAME, elapsedUs / 1000.0f);
+}
+
+int main()
+{
+  // run as 266mhz, twice the speed of the Psram
+  set_sys_clock_khz(266000, true);
+  stdio_init_all();
+
+  FATFS fs;
+  if(f_mount(&fs, "", 1) != FR_OK || !CreateTestFile())
+  {
+    printf("Cannot mount the SD card or write %s\n", FILE_NAME);
+    return 1;
+  }
+
+  while(true)
+  {
+    uint32_t uSum = RunFatFs("fatfs 1 byte", 1, BYTE_COUNT);
+    CheckSum("fileio getc", RunFileIo("fileio getc", 1, BYTE_COUNT, false), uSum);
+    uSum = RunFatFs("fatfs 64 bytes", 64, FILE_SIZE);
+    CheckSum("fileio 64 bytes", RunFileIo("fileio 64 bytes", 64, FILE_SIZE, false), uSum);
+    CheckSum("fileio 64 prefetched", RunFileIo("fileio 64 prefetched", 64, FILE_SIZE, true), uSum);
+    uSum = RunFatFs("fatfs 16KB", sizeof(block), FILE_SIZE);
+    CheckSum("fileio 16KB", RunFileIo("fileio 16KB", sizeof(block), FILE_SIZE, false), uSum);
+    RunSeeks();
+    RunAsset();
+    RunTextureCache();
+    printf("\n");
+
+#if PRESTO_HOST
+    printf("%u failures\n", (unsigned)uFailures);
+    return uFailures ? 1 : 0;
+#endif
+    sleep_ms(5000);
+  }
+}
@@ -0,0 +1,100 @@
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "FrameScheduler.h"
+
+using namespace pimoroni;
+
+// FIFO word from the renderer, a buffer is in m_pPresented
+#define FRAME_PRESENT (0x50524553)
+
+// The scheduler core 1 is serving
+static FrameScheduler *pCore1Scheduler = nullptr;
+
+FrameScheduler::FrameScheduler(ST7701Cached &display, uint16_t uHeight, bool bUseCore1)
+  : m_display(display), m_bUseCore1(bUseCore1), m_estimator(uHeight)
+{
+  if(m_bUseCore1)
+  {
+    pCore1Scheduler = this;
+    multicore_launch_core1(Core1Entry);
+  }
+}
+
+void FrameScheduler::Core1Entry(void)
+{
+  while(true)
+  {
+    if(multicore_fifo_pop_blocking() != FRAME_PRESENT)
+      continue;
+
+    __dmb();
+    pCore1Scheduler->Swap();
+  }
+}
+
+void FrameScheduler::Present(uint16_t *pBuffer)
+{
+  m_pPresented = pBuffer;
+  m_uPresentCount++;
+
+  if(m_bUseCore1)
+  {
+    // publish the buffer, then wake core 1
+    __dmb();
+    multicore_fifo_push_blocking(FRAME_PRESENT);
+  }
+}
+
+void FrameScheduler::WaitForSwap(void)
+{
+  if(!m_bUseCore1 && !IsSwapComplete())
+    Swap();
+
+  while(!IsSwapComplete())
+    tight_loop_contents();
+}
+
+// Show the presented buffer from the next vsync and wait for it
+void FrameScheduler::Swap(void)
+{
+  m_display.set_backbuffer(m_pPresented);
+  m_display.wait_for_vsync();
+  uint64_t vsyncTime = time_us_64();
+  OnVsync(vsyncTime);
+
+  // the renderer can carry on while the callback runs
+  m_uSwapCount.fetch_add(1, std::memory_order_release);
+
+  if(m_fnCallback)
+    m_fnCallback(vsyncTime, m_pCallbackContext);
+
+  // swaps can be several vsyncs apart, so the period is seeded from the vsyncs straight after one
+  while(!m_estimator.IsCalibrated())
+  {
+    m_display.wait_for_vsync();
+    OnVsync(time_us_64());
+  }
+}
+
+// Publish a vsync to readers of the estimator on the other core
+void FrameScheduler::OnVsync(uint64_t vsyncTime)
+{
+  m_uSequence.fetch_add(1, std::memory_order_acq_rel);
+  m_estimator.OnVsync(vsyncTime);
+  m_uSequence.fetch_add(1, std::memory_order_release);
+}
+
+ScanlineEstimator FrameScheduler::GetEstimator(void) const
+{
+  while(true)
+  {
+    uint32_t uSequence = m_uSequence.load(std::memory_order_acquire);
+    ScanlineEstimator estimator = m_estimator;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if(!(uSequence & 1) && m_uSequence.load(std::memory_order_relaxed) == uSequence)
+      return estimator;
+  }
+}
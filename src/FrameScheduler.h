@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+
+#include "drivers/st7701/st7701Cached.hpp"
+
+#include "BeamRacer.h"
+
+// FrameScheduler
+//  Takes the wait for vsync out of the render loop, so the next frame can be updated
+//  while the last one waits to be shown.
+//
+//  Present() hands the finished back buffer to core 1 and returns straight away. Core 1
+//  passes it to set_backbuffer() and waits for the vsync it is shown from, as the render
+//  loop used to. Meanwhile the renderer updates anything that doesn't touch the back
+//  buffer, and only calls WaitForSwap() before it clears or draws, by which time the
+//  vsync has often passed.
+//
+//  Each swap is timestamped as wait_for_vsync() returns and fed to a ScanlineEstimator,
+//  so the time of the last vsync, the frame period and the next vsync are known for
+//  pacing. Below the refresh rate swaps are several vsyncs apart, so until the estimator
+//  is calibrated the swapping core also waits for and times the vsyncs that follow a
+//  swap, seeding the period from consecutive vsyncs. After that the estimator divides
+//  the time between swaps by the whole number of frames it spans. A callback can be run
+//  on core 1 at each swap.
+//
+//  Core 1 is launched by the constructor and must not be used for anything else. With
+//  bUseCore1 false, for when core 1 is busy, WaitForSwap() waits for the vsync itself.
+//
+//  Renderer (core 0), each frame:
+//    update             - the last frame may still be waiting for its vsync
+//    WaitForSwap()      - the last frame is on screen, the back buffer is free
+//    clear and draw
+//    Present()          - show the finished buffer from the next vsync
+class FrameScheduler
+{
+public:
+  // Called at each swap with the time wait_for_vsync() returned
+  typedef void (*SwapCallback)(uint64_t vsyncTime, void *pContext);
+
+  FrameScheduler(pimoroni::ST7701Cached &display, uint16_t uHeight, bool bUseCore1 = true);
+
+  FrameScheduler(const FrameScheduler&) = delete;
+  FrameScheduler& operator = (const FrameScheduler&) = delete;
+
+  // Set before the first Present(), fnCallback runs on the core waiting for the vsync as the
+  // renderer carries on, so it must not touch the back buffers
+  void SetSwapCallback(SwapCallback fnCallback, void *pContext = nullptr)
+  {
+    m_fnCallback = fnCallback;
+    m_pCallbackContext = pContext;
+  }
+
+  // Renderer: show pBuffer from the next vsync, call WaitForSwap() first if a frame is already presented
+  void Present(uint16_t *pBuffer);
+
+  // Renderer: the last presented frame is on screen and the buffer it replaced can be drawn into
+  bool IsSwapComplete(void) const
+  {
+    return m_uSwapCount.load(std::memory_order_acquire) == m_uPresentCount;
+  }
+
+  // Renderer: wait until IsSwapComplete()
+  void WaitForSwap(void);
+
+  // Swaps so far, safe from either core
+  uint32_t GetSwapCount(void) const
+  {
+    return m_uSwapCount.load(std::memory_order_acquire);
+  }
+
+  // Timing as of the last swap, safe from either core
+  ScanlineEstimator GetEstimator(void) const;
+
+  // Time the next vsync is expected after timeNow, timeNow before the period is known
+  uint64_t GetNextVsyncTime(uint64_t timeNow) const
+  {
+    return GetEstimator().GetRowTime(0, timeNow);
+  }
+
+private:
+  void Swap(void);
+  void OnVsync(uint64_t vsyncTime);
+
+  static void Core1Entry(void);
+
+  pimoroni::ST7701Cached &m_display;
+  bool                   m_bUseCore1;
+  SwapCallback           m_fnCallback = nullptr;
+  void                   *m_pCallbackContext = nullptr;
+
+  uint16_t               *m_pPresented = nullptr;  // published by the FIFO word
+  uint32_t               m_uPresentCount = 0;      // renderer only
+  std::atomic<uint32_t>  m_uSwapCount{0};
+
+  // m_estimator is written by the swapping core between two increments of m_uSequence,
+  // so a reader that sees the same even sequence before and after copying it got all of it
+  ScanlineEstimator      m_estimator;
+  std::atomic<uint32_t>  m_uSequence{0};
+};
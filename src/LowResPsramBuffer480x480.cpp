@@ -0,0 +1,200 @@
+// ******************************************************************************
+// This example renders at a lower resolution than the panel, 240x240 by
+// default, into three back buffers stored in PSRAM with the Presto running at
+// 480x480 and using the ST7701Cached class.
+//
+// At a scale of 2 each back buffer is a quarter of the size, so clearing and
+// drawing touch a quarter of the pixels and move a quarter of the bytes over
+// the psram bus. ST7701Cached is given a single 480x480 scan-out buffer. Core 1
+// waits for each vsync, latches the newest finished frame from TripleBuffer and
+// Upscaler scales it into the scan-out buffer from the top down. Each source
+// row is read into SRAM with DMA, widened there with the interpolator and
+// written out with DMA once the beam has left those rows, so the frame is shown
+// whole from the next vsync.
+//
+// Touch the screen to change how many boxes there are, near the top for fewer
+// and near the bottom for more.
+//
+// Note: A summary of the phase timings and fps is logged to the USB UART every
+//       128 frames by FrameProfiler, with the time the last upscale took and
+//       the rows in it the beam got to first.
+// ******************************************************************************
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "drivers/st7701/st7701Cached.hpp"
+#include "pico/multicore.h"
+
+#include "PicoPlusPsram.h"
+#include "TripleBuffer.h"
+#include "Upscaler.h"
+#include "PsramDma.h"
+#include "ParticleSystem.h"
+#include "Elapsed.h"
+#include "FT6236.h"
+
+using namespace pimoroni;
+
+#define FRAME_WIDTH 480
+#define FRAME_HEIGHT 480
+
+// The frames are drawn this many times smaller than the panel in each direction
+#define SCALE 2
+#define RENDER_WIDTH (FRAME_WIDTH / SCALE)
+#define RENDER_HEIGHT (FRAME_HEIGHT / SCALE)
+
+static const uint BACKLIGHT = 45;
+static const uint LCD_CLK = 26;
+static const uint LCD_CS = 28;
+static const uint LCD_DAT = 27;
+static const uint LCD_DC = -1;
+static const uint LCD_D0 = 1;
+
+#define PIX_WH (16 / SCALE)
+#define BLOCK_COUNT 100
+#define MAX_BLOCK_COUNT 2000
+
+// Phases timed each frame, the names match the log
+enum { phaseAcquire, phaseUpdate, phaseClear, phaseDraw, phaseCount };
+static const char * const phaseNames[phaseCount] = {"Q", "U", "C", "D"};
+
+FT6236 touchDisplay;
+
+uint16_t                *back_buffers[3]; // Three low resolution back buffers to use
+uint16_t                *scanout_buffer;  // Full resolution buffer the display reads
+TripleBuffer            *buffers;         // Passes them between the cores
+Upscaler                *upscaler;        // Scales them into the scan-out buffer
+PsramDma                *dma;             // Reads the source rows in and writes the scaled rows out
+ScanlineEstimator       *estimator;       // Where the beam is, for the upscaler
+ST7701Cached            *presto;          // Sends data to the display
+ParticleSystem          *blocks;          // The boxes, moved in fixed point
+PicoGraphics_PenRGB565  *graphics;        // We draw with this
+
+// Core 1 scales the newest finished frame each frame
+void core1_present()
+{
+  bool upscaled = false;
+  while (true)
+  {
+    // an upscale ends as the beam leaves the last row, so if the beam is back in the top
+    // half it ran on past the vsync, carry on in this frame rather than wait for the next
+    if (!upscaled || !estimator->IsCalibrated() || estimator->GetScanline(time_us_64()) >= FRAME_HEIGHT / 2)
+    {
+      presto->wait_for_vsync();
+      estimator->OnVsync(time_us_64());
+    }
+    upscaled = upscaler->Upscale(buffers->Latch());
+  }
+}
+
+int main()
+{
+  // run as 266mhz, twice the speed of the Psram
+  set_sys_clock_khz(266000, true);
+  stdio_init_all();
+
+  // Display available Psram
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  size_t uMemorySize = ps.GetMemorySize();
+  printf("PSRAM = %x\n", uMemorySize);
+
+  // Set up the chip select
+  gpio_init(LCD_CS);
+  gpio_put(LCD_CS, 1);
+  gpio_set_dir(LCD_CS, 1);
+
+  // allocate the back buffers and the 480x480 scan-out buffer in psram, use uncached address
+  {
+    PsramTrace::Scope tag("framebuffers");
+    for (int i = 0; i < 3; i++)
+      back_buffers[i] = (uint16_t *)ps.GetUncachedAddress(ps.Malloc(RENDER_WIDTH * RENDER_HEIGHT * 2, PicoPlusPsram::heapFrame));
+    scanout_buffer = (uint16_t *)ps.GetUncachedAddress(ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2, PicoPlusPsram::heapFrame));
+  }
+
+  // Use the ST7701Cached presto object, it only ever sends the scan-out buffer to the display
+  presto = new ST7701Cached(FRAME_WIDTH, FRAME_HEIGHT, ROTATE_0, SPIPins{spi1, LCD_CS, LCD_CLK, LCD_DAT, PIN_UNUSED, LCD_DC, BACKLIGHT}, scanout_buffer);
+
+  // back_buffers[0] is displayed first, the other two are free to draw into
+  buffers = new TripleBuffer(RENDER_WIDTH, RENDER_HEIGHT, back_buffers[0], back_buffers[1], back_buffers[2]);
+
+  // rows are moved between psram and SRAM with DMA while core 1 widens the next, and
+  // written out behind the beam
+  estimator = new ScanlineEstimator(FRAME_HEIGHT);
+  dma = new PsramDma();
+  upscaler = new Upscaler(RENDER_WIDTH, RENDER_HEIGHT, SCALE, scanout_buffer, dma, estimator);
+
+  // picographics draws into whichever buffer is acquired each frame
+  graphics = new PicoGraphics_PenRGB565(RENDER_WIDTH, RENDER_HEIGHT, back_buffers[1]);
+
+  // Init the ST7701 display and clear the buffers
+  presto->init();
+  memset(scanout_buffer, 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
+  for (int i = 0; i < 3; i++)
+    memset(back_buffers[i], 0, RENDER_WIDTH * RENDER_HEIGHT * 2);
+
+  // inititalise blocks, kept in SRAM as fixed point
+  blocks = new ParticleSystem(MAX_BLOCK_COUNT, graphics->bounds.w - PIX_WH, graphics->bounds.h - PIX_WH);
+  for (int i = 0; i < MAX_BLOCK_COUNT; i++)
+  {
+    float x = rand() % (graphics->bounds.w - PIX_WH);
+    float y = rand() % (graphics->bounds.h - PIX_WH);
+
+    float dx = float(rand() % 255) / (64.0f * SCALE);
+    float dy = float(rand() % 255) / (64.0f * SCALE);
+    uint16_t use_pen = graphics->create_pen(rand() % 255, rand() % 255, rand() % 255);
+    blocks->Add(x, y, dx, dy, use_pen);
+  }
+  size_t block_count = BLOCK_COUNT;
+
+  // read touches in the background when the controller signals
+  touchDisplay.EnableInterrupt();
+
+  // hand vsyncs over to core 1
+  multicore_launch_core1(core1_present);
+
+  // Used for timings
+  FrameProfiler<phaseCount> profiler(phaseNames, 0);
+  uint32_t frame_count = 0;
+
+  while (true)
+  {
+    profiler.BeginFrame();
+
+    // take a free back buffer, this only waits when all three are in use
+    graphics->set_framebuffer(buffers->Acquire());
+    profiler.Lap(phaseAcquire);
+
+    // touch sets the number of boxes, touches are in panel pixels
+    touchDisplay.Update();
+    const FT6236::Touch &touch0 = touchDisplay.GetTouch(0);
+    if (touch0.active)
+      block_count = 1 + (MAX_BLOCK_COUNT - 1) * touch0.y / (FRAME_HEIGHT - 1);
+
+    // update the blocks shown
+    blocks->Update(block_count);
+    profiler.Lap(phaseUpdate);
+
+    // clear the spans drawn into this back buffer the last time it was used
+    buffers->Repair();
+    profiler.Lap(phaseClear);
+
+    // draw blocks
+    for (size_t i = 0; i < block_count; i++)
+    {
+      Rect r(blocks->GetX(i), blocks->GetY(i), PIX_WH, PIX_WH);
+      graphics->set_pen(blocks->GetPen(i));
+      graphics->rectangle(r);
+      buffers->AddDamage(r);
+    }
+    profiler.Lap(phaseDraw);
+
+    // queue it for core 1 to display
+    buffers->Present();
+
+    profiler.EndFrame();
+    if ((++frame_count & 127) == 0)
+    {
+      profiler.Report();
+      printf("upscale=%.2fms late=%u\n", upscaler->GetUpscaleUs() / 1000.0f, upscaler->GetLateRows());
+    }
+  }
+}
@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "PaletteExpander.h"
+
+using namespace pimoroni;
+
+PaletteExpander::PaletteExpander(uint16_t uWidth, uint16_t uHeight, uint16_t *pScanout, PsramDma *pDma,
+                                 const ScanlineEstimator *pEstimator)
+  : m_uWidth(uWidth), m_uHeight(uHeight), m_pScanout(pScanout), m_pDma(pDma), m_pEstimator(pEstimator)
+{
+  m_pLines[0] = new uint16_t[uWidth];
+  m_pLines[1] = new uint16_t[uWidth];
+}
+
+PaletteExpander::~PaletteExpander(void)
+{
+  delete[] m_pLines[0];
+  delete[] m_pLines[1];
+}
+
+bool PaletteExpander::SetPalette(const RGB *pColours, uint16_t uCount)
+{
+  // the display hasn't copied the last palette yet
+  if(m_bPaletteQueued.load(std::memory_order_acquire))
+    return false;
+
+  for(uint16_t i = 0; i < uCount && i < c_uPaletteSize; i++)
+    m_pending[i] = pColours[i].to_rgb565();
+
+  m_bPaletteQueued.store(true, std::memory_order_release);
+  return true;
+}
+
+bool PaletteExpander::Expand(const uint8_t *pFrame)
+{
+  bool bNewPalette = m_bPaletteQueued.load(std::memory_order_acquire);
+  if(bNewPalette)
+  {
+    memcpy(m_palette, m_pending, sizeof(m_palette));
+    m_bPaletteQueued.store(false, std::memory_order_release);
+  }
+
+  if(pFrame == m_pLastFrame && !bNewPalette)
+    return false;
+
+  uint64_t startTime = time_us_64();
+
+  // rows are timed from the start of the frame being sent now, before calibration they are not held back
+  bool bBehindBeam = m_pEstimator && m_pEstimator->IsCalibrated();
+  uint32_t uPeriodUs = bBehindBeam ? m_pEstimator->GetFramePeriodUs() : 0;
+  uint32_t uTotalLines = bBehindBeam ? m_pEstimator->GetTotalLines() : 1;
+  uint64_t frameStart = 0;
+  if(bBehindBeam)
+  {
+    uint64_t lastVsyncTime = m_pEstimator->GetLastVsyncTime();
+    frameStart = lastVsyncTime + ((startTime - lastVsyncTime) / uPeriodUs) * uPeriodUs;
+  }
+  uint32_t uLateRows = 0;
+
+  for(uint16_t y = 0; y < m_uHeight; y++)
+  {
+    uint16_t *pLine = m_pLines[y & 1];
+
+    // the line was last written out two rows ago
+    if(m_pDma)
+      m_pDma->Wait(m_lineFences[y & 1]);
+    ExpandRow(m_palette, pFrame + y * m_uWidth, pLine, m_uWidth);
+
+    if(bBehindBeam)
+    {
+      // wait for the beam to start the next row, late if it has come back round to this one
+      uint64_t rowTime = frameStart + ((uint64_t)(y + 1) * uPeriodUs) / uTotalLines;
+      uint64_t timeNow;
+      while((timeNow = time_us_64()) < rowTime)
+        tight_loop_contents();
+      if(timeNow >= rowTime + uPeriodUs - uPeriodUs / uTotalLines)
+        uLateRows++;
+    }
+
+    if(m_pDma)
+      m_lineFences[y & 1] = m_pDma->Copy(m_pScanout + y * m_uWidth, pLine, m_uWidth);
+    else
+      memcpy(m_pScanout + y * m_uWidth, pLine, m_uWidth * 2);
+  }
+
+  if(m_pDma)
+    m_pDma->Wait(m_pDma->GetLastFence());
+
+  m_pLastFrame = pFrame;
+  m_uExpandUs = (uint32_t)(time_us_64() - startTime);
+  m_uLateRows = uLateRows;
+  return true;
+}
+
+// Four indices are read from psram a word at a time and two pixels written to SRAM per word
+void PaletteExpander::ExpandRow(const uint16_t *pPalette, const uint8_t *pSrc, uint16_t *pDst, uint32_t uCount)
+{
+  const uint32_t *pSrcWords = (const uint32_t *)pSrc;
+  uint32_t *pDstWords = (uint32_t *)pDst;
+
+  for(uint32_t i = 0; i < uCount / 4; i++)
+  {
+    uint32_t uIndices = pSrcWords[i];
+    pDstWords[i * 2] = pPalette[uIndices & 0xff] | ((uint32_t)pPalette[(uIndices >> 8) & 0xff] << 16);
+    pDstWords[i * 2 + 1] = pPalette[(uIndices >> 16) & 0xff] | ((uint32_t)pPalette[uIndices >> 24] << 16);
+  }
+
+  for(uint32_t i = uCount & ~3u; i < uCount; i++)
+    pDst[i] = pPalette[pSrc[i]];
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "PsramDma.h"
+#include "BeamRacer.h"
+
+// PaletteExpander
+//  Shows 8 bit paletted back buffers, drawn with PicoGraphics_PenP8, on ST7701Cached by
+//  expanding each new frame into the one RGB565 buffer the display scans out.
+//
+//  This saves psram space, not psram bandwidth. A P8 back buffer is half the size of an
+//  RGB565 one, so three of them with the scan-out buffer take less psram than three RGB565
+//  back buffers, and clearing and drawing write a byte per pixel rather than two. But the
+//  panel still scans out RGB565, and each expansion reads the whole P8 frame and writes the
+//  whole scan-out buffer, 3 bytes per pixel or 675KB at 480x480 on top of the scan-out.
+//  The byte saved per pixel cleared or drawn only pays for that when a frame clears and
+//  draws more than three screens of pixels. A frame that is shown again with the same
+//  palette is not expanded again, but a new palette expands it again even if nothing moved.
+//
+//  Each row is expanded through a palette held in SRAM into an SRAM line, which is written
+//  out with pDma, if one is given, while the next row is expanded. Given a calibrated
+//  ScanlineEstimator, a row is only written once the beam has left it in the frame being
+//  sent when Expand() is called, so the new frame is shown whole from the next vsync and
+//  its writes are spread over the frame. Expand() returns as the beam leaves the last row,
+//  only call it again after the next vsync. A row the beam comes back round to before it
+//  is written would tear and is counted by GetLateRows(). Without an estimator the frame
+//  is expanded as fast as it can be from the top down, racing ahead of the beam, and
+//  tears wherever the panel catches up with it.
+//
+//  SetPalette() queues a new palette that is used from the first frame expanded after
+//  the next vsync, so a palette swap never tears. Only one palette is queued at a time,
+//  so SetPalette() returns false rather than waiting when the last one hasn't been taken,
+//  try again next frame. The width must be a multiple of 4.
+//
+//  Renderer (core 0):
+//    SetPalette()   - colours for the frames from the next vsync
+//
+//  Display (core 1), each frame:
+//    OnVsync()      - on the estimator, as soon as wait_for_vsync() returns
+//    Expand()       - with the P8 frame to show, any time before the next vsync
+class PaletteExpander
+{
+public:
+  static const uint16_t c_uPaletteSize = 256;
+
+  // Rows are written out to pScanout with pDma if one is given, while the next row is expanded,
+  // and behind the beam pEstimator is following if one is given
+  PaletteExpander(uint16_t uWidth, uint16_t uHeight, uint16_t *pScanout, PsramDma *pDma = nullptr,
+                  const ScanlineEstimator *pEstimator = nullptr);
+  ~PaletteExpander(void);
+
+  PaletteExpander(const PaletteExpander&) = delete;
+  PaletteExpander& operator = (const PaletteExpander&) = delete;
+
+  // Renderer: use these colours from the next vsync, false if the last palette has not been taken yet
+  bool SetPalette(const pimoroni::RGB *pColours, uint16_t uCount = c_uPaletteSize);
+
+  // Display: expand pFrame into the scan-out buffer if it or the palette changed, returns true if it was
+  bool Expand(const uint8_t *pFrame);
+
+  // Time the last expansion took, including waiting for the beam
+  uint32_t GetExpandUs(void) const
+  {
+    return m_uExpandUs;
+  }
+
+  // Rows the last expansion wrote after the beam had come back round to them
+  uint32_t GetLateRows(void) const
+  {
+    return m_uLateRows;
+  }
+
+  // Expand uCount indices to byte swapped RGB565, pSrc and pDst must be word aligned
+  static void ExpandRow(const uint16_t *pPalette, const uint8_t *pSrc, uint16_t *pDst, uint32_t uCount);
+
+private:
+  uint16_t          m_uWidth;
+  uint16_t          m_uHeight;
+  uint16_t          *m_pScanout;
+  PsramDma          *m_pDma;
+  const ScanlineEstimator *m_pEstimator;
+  uint16_t          *m_pLines[2];                     // SRAM, expanded rows on their way to psram
+  PsramDma::Fence   m_lineFences[2] = {};
+
+  uint16_t          m_palette[c_uPaletteSize] = {};   // display only
+  uint16_t          m_pending[c_uPaletteSize] = {};   // renderer only while not queued
+  std::atomic<bool> m_bPaletteQueued{false};
+
+  const uint8_t     *m_pLastFrame = nullptr;          // display only
+  volatile uint32_t m_uExpandUs = 0;
+  volatile uint32_t m_uLateRows = 0;
+};
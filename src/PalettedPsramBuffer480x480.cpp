@@ -0,0 +1,245 @@
+// ******************************************************************************
+// This example shows three 8 bit paletted back buffers stored in PSRAM with
+// the Presto running at 480x480 and using the ST7701Cached class.
+//
+// The boxes are drawn with PicoGraphics_PenP8, a byte per pixel, so each back
+// buffer is 225KB rather than 450KB and clearing and drawing write half the
+// bytes of the RGB565 examples.
+//
+// ST7701Cached scans out RGB565, so it is given a single RGB565 scan-out
+// buffer. Core 1 waits for each vsync, latches the newest finished frame from
+// TripleBufferP8 and PaletteExpander expands it into the scan-out buffer with
+// DMA, each row once the beam has left it so the frame is shown whole from the
+// next vsync. Expanding reads 225KB and writes 450KB of psram, more than the
+// boxes save unless there are over 1300 of them, so this is a saving in
+// psram space rather than bandwidth. The palette is colour cycled, each new
+// palette is handed over at a vsync so it never tears, and expands the frame
+// again whether or not a new one was drawn.
+//
+// Touch the screen to change how many boxes there are, near the top for fewer
+// and near the bottom for more.
+//
+// Note: A summary of the phase timings and fps is logged to the USB UART every
+//       128 frames by FrameProfiler, with the time the last expansion took and
+//       the rows in it the beam got to first.
+// ******************************************************************************
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "drivers/st7701/st7701Cached.hpp"
+#include "pico/multicore.h"
+
+#include "PicoPlusPsram.h"
+#include "TripleBuffer.h"
+#include "PaletteExpander.h"
+#include "PsramDma.h"
+#include "ParticleSystem.h"
+#include "Elapsed.h"
+#include "FT6236.h"
+
+using namespace pimoroni;
+
+#define FRAME_WIDTH 480
+#define FRAME_HEIGHT 480
+
+static const uint BACKLIGHT = 45;
+static const uint LCD_CLK = 26;
+static const uint LCD_CS = 28;
+static const uint LCD_DAT = 27;
+static const uint LCD_DC = -1;
+static const uint LCD_D0 = 1;
+
+#define PIX_WH 16
+#define BLOCK_COUNT 100
+#define MAX_BLOCK_COUNT 2000
+
+// Palette entries 1 to 255 move one step along the colour wheel every this many frames, 0 is the background.
+// Each step expands the frame again, so this is also the most frames an unchanged frame is left as it was
+#define CYCLE_FRAMES 4
+
+// Phases timed each frame, the names match the log
+enum { phaseAcquire, phaseUpdate, phaseClear, phaseDraw, phaseCount };
+static const char * const phaseNames[phaseCount] = {"Q", "U", "C", "D"};
+
+FT6236 touchDisplay;
+
+uint8_t                 *back_buffers[3]; // Three P8 back buffers to use
+uint16_t                *scanout_buffer;  // RGB565 buffer the display reads
+TripleBufferP8          *buffers;         // Passes them between the cores
+PaletteExpander         *expander;        // Expands them into the scan-out buffer
+ScanlineEstimator       *estimator;       // Where the beam is, for the expander
+PsramDma                *dma;             // Writes the expanded rows out
+ST7701Cached            *presto;          // Sends data to the display
+ParticleSystem          *blocks;          // The boxes, moved in fixed point
+PicoGraphics_PenP8      *graphics;        // We draw with this
+
+RGB                     wheel[255];       // Colours the palette cycles through
+RGB                     palette[PaletteExpander::c_uPaletteSize];
+
+// Fully saturated colour uStep of 255 around the colour wheel
+static RGB WheelColour(uint32_t uStep)
+{
+  uint32_t uPosition = uStep * 6 * 256 / 255;
+  int16_t t = uPosition & 0xff;
+
+  switch(uPosition >> 8)
+  {
+    case 0:  return RGB(255, t, 0);
+    case 1:  return RGB(255 - t, 255, 0);
+    case 2:  return RGB(0, 255, t);
+    case 3:  return RGB(0, 255 - t, 255);
+    case 4:  return RGB(t, 0, 255);
+    default: return RGB(255, 0, 255 - t);
+  }
+}
+
+// Palette with the wheel turned uOffset steps
+static void MakePalette(uint32_t uOffset)
+{
+  palette[0] = RGB(0, 0, 0);
+  for(uint32_t i = 1; i < PaletteExpander::c_uPaletteSize; i++)
+    palette[i] = wheel[(i - 1 + uOffset) % 255];
+}
+
+// Core 1 expands the newest finished frame each frame
+void core1_present()
+{
+  bool expanded = false;
+  while (true)
+  {
+    // an expansion ends as the beam leaves the last row, so if the beam is back in the top
+    // half it ran on past the vsync, carry on in this frame rather than wait for the next
+    if (!expanded || !estimator->IsCalibrated() || estimator->GetScanline(time_us_64()) >= FRAME_HEIGHT / 2)
+    {
+      presto->wait_for_vsync();
+      estimator->OnVsync(time_us_64());
+    }
+    expanded = expander->Expand(buffers->Latch());
+  }
+}
+
+int main()
+{
+  // run as 266mhz, twice the speed of the Psram
+  set_sys_clock_khz(266000, true);
+  stdio_init_all();
+
+  // Display available Psram
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  size_t uMemorySize = ps.GetMemorySize();
+  printf("PSRAM = %x\n", uMemorySize);
+
+  // Set up the chip select
+  gpio_init(LCD_CS);
+  gpio_put(LCD_CS, 1);
+  gpio_set_dir(LCD_CS, 1);
+
+  // allocate 480x480 back buffers and the scan-out buffer in psram, use uncached address
+  {
+    PsramTrace::Scope tag("framebuffers");
+    for (int i = 0; i < 3; i++)
+      back_buffers[i] = (uint8_t *)ps.GetUncachedAddress(ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT, PicoPlusPsram::heapFrame));
+    scanout_buffer = (uint16_t *)ps.GetUncachedAddress(ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2, PicoPlusPsram::heapFrame));
+  }
+
+  // Use the ST7701Cached presto object, it only ever sends the scan-out buffer to the display
+  presto = new ST7701Cached(FRAME_WIDTH, FRAME_HEIGHT, ROTATE_0, SPIPins{spi1, LCD_CS, LCD_CLK, LCD_DAT, PIN_UNUSED, LCD_DC, BACKLIGHT}, scanout_buffer);
+
+  // back_buffers[0] is displayed first, the other two are free to draw into
+  buffers = new TripleBufferP8(FRAME_WIDTH, FRAME_HEIGHT, back_buffers[0], back_buffers[1], back_buffers[2]);
+
+  // rows are expanded behind the beam on core 1 and written out with DMA while the next is expanded
+  estimator = new ScanlineEstimator(FRAME_HEIGHT);
+  dma = new PsramDma();
+  expander = new PaletteExpander(FRAME_WIDTH, FRAME_HEIGHT, scanout_buffer, dma, estimator);
+
+  // picographics draws palette indices into whichever buffer is acquired each frame
+  graphics = new PicoGraphics_PenP8(FRAME_WIDTH, FRAME_HEIGHT, back_buffers[1]);
+
+  // Init the ST7701 display and clear the buffers
+  presto->init();
+  memset(scanout_buffer, 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
+  for (int i = 0; i < 3; i++)
+    memset(back_buffers[i], 0, FRAME_WIDTH * FRAME_HEIGHT);
+
+  // the palette for the first frame, taken by core 1 at its first vsync
+  for (uint32_t i = 0; i < 255; i++)
+    wheel[i] = WheelColour(i);
+  uint32_t palette_offset = 0;
+  MakePalette(palette_offset);
+  expander->SetPalette(palette);
+
+  // inititalise blocks, kept in SRAM as fixed point, each with a palette entry other than the background
+  blocks = new ParticleSystem(MAX_BLOCK_COUNT, graphics->bounds.w - PIX_WH, graphics->bounds.h - PIX_WH);
+  for (int i = 0; i < MAX_BLOCK_COUNT; i++)
+  {
+    float x = rand() % (graphics->bounds.w - PIX_WH);
+    float y = rand() % (graphics->bounds.h - PIX_WH);
+
+    float dx = float(rand() % 255) / 64.0f;
+    float dy = float(rand() % 255) / 64.0f;
+    blocks->Add(x, y, dx, dy, 1 + rand() % 255);
+  }
+  size_t block_count = BLOCK_COUNT;
+
+  // read touches in the background when the controller signals
+  touchDisplay.EnableInterrupt();
+
+  // hand vsyncs over to core 1
+  multicore_launch_core1(core1_present);
+
+  // Used for timings
+  FrameProfiler<phaseCount> profiler(phaseNames, 0);
+  uint32_t frame_count = 0;
+
+  while (true)
+  {
+    profiler.BeginFrame();
+
+    // take a free back buffer, this only waits when all three are in use
+    graphics->set_framebuffer(buffers->Acquire());
+    profiler.Lap(phaseAcquire);
+
+    // touch sets the number of boxes
+    touchDisplay.Update();
+    const FT6236::Touch &touch0 = touchDisplay.GetTouch(0);
+    if (touch0.active)
+      block_count = 1 + (MAX_BLOCK_COUNT - 1) * touch0.y / (FRAME_HEIGHT - 1);
+
+    // update the blocks shown
+    blocks->Update(block_count);
+
+    // turn the colour wheel, if core 1 hasn't taken the last palette yet try again next frame
+    uint32_t offset = (frame_count / CYCLE_FRAMES) % 255;
+    if (offset != palette_offset)
+    {
+      MakePalette(offset);
+      if (expander->SetPalette(palette))
+        palette_offset = offset;
+    }
+    profiler.Lap(phaseUpdate);
+
+    // clear the spans drawn into this back buffer the last time it was used
+    buffers->Repair();
+    profiler.Lap(phaseClear);
+
+    // draw blocks
+    for (size_t i = 0; i < block_count; i++)
+    {
+      Rect r(blocks->GetX(i), blocks->GetY(i), PIX_WH, PIX_WH);
+      graphics->set_pen(blocks->GetPen(i));
+      graphics->rectangle(r);
+      buffers->AddDamage(r);
+    }
+    profiler.Lap(phaseDraw);
+
+    // queue it for core 1 to display
+    buffers->Present();
+
+    profiler.EndFrame();
+    if ((++frame_count & 127) == 0)
+    {
+      profiler.Report();
+      printf("expand=%.2fms late=%u\n", expander->GetExpandUs() / 1000.0f, expander->GetLateRows());
+    }
+  }
+}
@@ -0,0 +1,126 @@
+#include "ParticleSystem.h"
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <arm_acle.h>
+#define PARTICLE_SIMD 1
+#else
+#define PARTICLE_SIMD 0
+#endif
+
+ParticleSystem::ParticleSystem(uint32_t uCapacity, uint16_t uMaxX, uint16_t uMaxY) : m_uCapacity(uCapacity)
+{
+  m_uMax = Pack(uMaxX << c_uFracBits, uMaxY << c_uFracBits);
+
+  m_pPos = new uint32_t[uCapacity];
+  m_pVel = new uint32_t[uCapacity];
+  m_pPrev = new uint32_t[uCapacity];
+  m_pPens = new uint16_t[uCapacity];
+}
+
+ParticleSystem::~ParticleSystem(void)
+{
+  delete[] m_pPos;
+  delete[] m_pVel;
+  delete[] m_pPrev;
+  delete[] m_pPens;
+}
+
+bool ParticleSystem::Add(float x, float y, float dx, float dy, uint16_t uPen)
+{
+  if(m_uCount >= m_uCapacity)
+    return false;
+
+  const float fScale = (float)(1 << c_uFracBits);
+  m_pPos[m_uCount] = Pack((int32_t)(x * fScale), (int32_t)(y * fScale));
+  m_pVel[m_uCount] = Pack((int32_t)(dx * fScale), (int32_t)(dy * fScale));
+  m_pPrev[m_uCount] = m_pPos[m_uCount];
+  m_pPens[m_uCount] = uPen;
+  m_uCount++;
+  return true;
+}
+
+#if PARTICLE_SIMD
+
+// 0xffff in each lane that is negative
+static inline uint32_t NegativeLanes(uint32_t uLanes)
+{
+  return ((uLanes >> 15) & 0x00010001) * 0xffff;
+}
+
+// Both lanes at once: below zero reflects, at or above the limit clamps, and either flips the velocity
+void __not_in_flash_func(ParticleSystem::Update)(uint32_t uCount)
+{
+  const uint32_t uMax = m_uMax;
+  const uint32_t uMaxLess = __ssub16(uMax, 0x00010001);
+
+  if(uCount > m_uCount)
+    uCount = m_uCount;
+
+  for(uint32_t i = 0; i < uCount; i++)
+  {
+    uint32_t uPos = m_pPos[i];
+    uint32_t uVel = m_pVel[i];
+    m_pPrev[i] = uPos;
+
+    uPos = __qadd16(uPos, uVel);
+
+    uint32_t uMask = NegativeLanes(uPos);
+    uPos = (uPos & ~uMask) | (__ssub16(0, uPos) & uMask);
+    uVel = (uVel & ~uMask) | (__ssub16(0, uVel) & uMask);
+
+    uMask = NegativeLanes(__ssub16(uMaxLess, uPos));
+    uPos = (uPos & ~uMask) | (uMax & uMask);
+    uVel = (uVel & ~uMask) | (__ssub16(0, uVel) & uMask);
+
+    m_pPos[i] = uPos;
+    m_pVel[i] = uVel;
+  }
+}
+
+#else
+
+// One lane of the SIMD update
+static inline void UpdateLane(int16_t &iPos, int16_t &iVel, int16_t iMax)
+{
+  int32_t iNext = iPos + iVel;
+  iNext = iNext > INT16_MAX ? INT16_MAX : (iNext < INT16_MIN ? INT16_MIN : iNext);
+
+  if(iNext < 0)
+  {
+    iNext = -iNext;
+    iVel = -iVel;
+  }
+  else if(iNext >= iMax)
+  {
+    iNext = iMax;
+    iVel = -iVel;
+  }
+
+  iPos = (int16_t)iNext;
+}
+
+void __not_in_flash_func(ParticleSystem::Update)(uint32_t uCount)
+{
+  const int16_t iMaxX = (int16_t)m_uMax;
+  const int16_t iMaxY = (int16_t)(m_uMax >> 16);
+
+  if(uCount > m_uCount)
+    uCount = m_uCount;
+
+  for(uint32_t i = 0; i < uCount; i++)
+  {
+    uint32_t uPos = m_pPos[i];
+    uint32_t uVel = m_pVel[i];
+    m_pPrev[i] = uPos;
+
+    int16_t x = (int16_t)uPos, y = (int16_t)(uPos >> 16);
+    int16_t dx = (int16_t)uVel, dy = (int16_t)(uVel >> 16);
+    UpdateLane(x, dx, iMaxX);
+    UpdateLane(y, dy, iMaxY);
+
+    m_pPos[i] = Pack(x, y);
+    m_pVel[i] = Pack(dx, dy);
+  }
+}
+
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// ParticleSystem
+//  Moves lots of points around a rectangle, bouncing them off its edges, for sprites,
+//  blocks or particles. The state is kept as separate arrays in SRAM, so the update
+//  streams through memory, and in fixed point with 6 fractional bits, 1/64th of a pixel.
+//
+//  Each position and velocity is a pair of 16 bit lanes, x in the low half and y in the
+//  high half of a 32 bit word, so on the Cortex-M33 the DSP SIMD instructions update
+//  both axes at once. Other targets use a portable version giving the same results.
+//  Positions must stay within +/-511 pixels.
+//
+//  Usage:
+//    Add()          - add a particle, up to the capacity
+//    Update()       - move every particle one step, or the first uCount, the old positions are kept
+//    GetX(), GetY() - current position in whole pixels, GetPreviousX/Y() the one before
+class ParticleSystem
+{
+public:
+  static const uint8_t c_uFracBits = 6;
+
+  // Particles are kept with 0 <= x <= uMaxX and 0 <= y <= uMaxY, in pixels
+  ParticleSystem(uint32_t uCapacity, uint16_t uMaxX, uint16_t uMaxY);
+  ~ParticleSystem(void);
+
+  ParticleSystem(const ParticleSystem&) = delete;
+  ParticleSystem& operator = (const ParticleSystem&) = delete;
+
+  // Returns false when full, positions and velocities are in pixels
+  bool Add(float x, float y, float dx, float dy, uint16_t uPen);
+
+  void Clear(void)
+  {
+    m_uCount = 0;
+  }
+
+  uint32_t GetCount(void) const
+  {
+    return m_uCount;
+  }
+
+  uint32_t GetCapacity(void) const
+  {
+    return m_uCapacity;
+  }
+
+  // Move the first uCount particles by their velocity, reflecting off the edges, the rest stay put
+  void Update(uint32_t uCount);
+
+  // Move every particle
+  void Update(void)
+  {
+    Update(m_uCount);
+  }
+
+  int16_t GetX(uint32_t i) const
+  {
+    return (int16_t)m_pPos[i] >> c_uFracBits;
+  }
+
+  int16_t GetY(uint32_t i) const
+  {
+    return (int16_t)(m_pPos[i] >> 16) >> c_uFracBits;
+  }
+
+  int16_t GetPreviousX(uint32_t i) const
+  {
+    return (int16_t)m_pPrev[i] >> c_uFracBits;
+  }
+
+  int16_t GetPreviousY(uint32_t i) const
+  {
+    return (int16_t)(m_pPrev[i] >> 16) >> c_uFracBits;
+  }
+
+  uint16_t GetPen(uint32_t i) const
+  {
+    return m_pPens[i];
+  }
+
+private:
+  static uint32_t Pack(int32_t x, int32_t y)
+  {
+    return ((uint32_t)(uint16_t)y << 16) | (uint16_t)x;
+  }
+
+  uint32_t m_uCapacity;
+  uint32_t m_uCount = 0;
+  uint32_t m_uMax;      // packed limits in fixed point
+
+  uint32_t *m_pPos;     // packed x, y
+  uint32_t *m_pVel;     // packed dx, dy
+  uint32_t *m_pPrev;    // packed x, y before the last update
+  uint16_t *m_pPens;
+};
@@ -3,6 +3,7 @@
 #include "hardware/structs/ioqspi.h"
 #include "hardware/structs/qmi.h"
 #include "hardware/structs/xip_ctrl.h"
+#include "hardware/xip_cache.h"
 #include "hardware/clocks.h"
 #include "hardware/sync.h"
 
@@ -10,6 +11,19 @@
 
 #define PSRAM_LOCATION _u(0x11000000)
 
+// Bytes at the start of psram each timing is tested on
+static const uint32_t c_uTestBytes = 64 * 1024;
+
+// Times the best timing for each divisor is tested before it is trusted
+static const uint8_t c_uStableRepeats = 8;
+
+// The XIP cache works in 8 byte lines, cleans of at least the size of the 16KB cache are done by set/way
+static const uint32_t c_uCacheLineSize = 8;
+static const uint32_t c_uCacheSize = 16 * 1024;
+
+// Set by SetSavedTiming()
+static PsramTiming savedTiming = {};
+
 // Private constructor
 PicoPlusPsram::PicoPlusPsram(void)
 {
@@ -18,16 +32,192 @@ PicoPlusPsram::PicoPlusPsram(void)
 
   if(m_uMemorySize)
   {
-    static lwmem_region_t regions[] = 
+    // use a saved timing if it still works, otherwise calibrate if asked to
+    uint32_t uReadUs;
+    if(savedTiming.IsValidFor(clock_get_hz(clk_sys)) && TestTiming(savedTiming, uReadUs, c_uStableRepeats))
+    {
+      ApplyTiming(savedTiming);
+      m_bCalibrated = true;
+    }
+#if PSRAM_CALIBRATE
+    else
+      Calibrate(PSRAM_CALIBRATE_MAX_HZ);
+#endif
+
+    AssignHeaps((uint8_t *)PSRAM_LOCATION, PSRAM_FRAME_HEAP_SIZE);
+  }
+}
+
+void PicoPlusPsram::SetSavedTiming(const PsramTiming &timing)
+{
+  savedTiming = timing;
+}
+
+// Value for the QMI M1 timing register
+static uint32_t TimingRegister(const PsramTiming &timing)
+{
+  return 1 << QMI_M1_TIMING_COOLDOWN_LSB |
+         QMI_M1_TIMING_PAGEBREAK_VALUE_1024 << QMI_M1_TIMING_PAGEBREAK_LSB |
+         timing.uMaxSelect << QMI_M1_TIMING_MAX_SELECT_LSB |
+         timing.uMinDeselect << QMI_M1_TIMING_MIN_DESELECT_LSB |
+         timing.uRxDelay << QMI_M1_TIMING_RXDELAY_LSB |
+         timing.uClkDiv << QMI_M1_TIMING_CLKDIV_LSB;
+}
+
+void __no_inline_not_in_flash_func(PicoPlusPsram::ApplyTiming)(const PsramTiming &timing)
+{
+  uint32_t intr_stash = save_and_disable_interrupts();
+  m_timing = timing;
+  qmi_hw->m[1].timing = TimingRegister(timing);
+  restore_interrupts(intr_stash);
+}
+
+// Data written to test word i with each pattern
+static inline uint32_t TestPattern(uint8_t uPattern, uint32_t i)
+{
+  switch(uPattern)
+  {
+    case 0:  return i * 0x9e3779b9;
+    case 1:  return ~(i * 0x9e3779b9);
+    case 2:  return (i & 1) ? 0xaaaaaaaa : 0x55555555;
+    default: return 1u << (i & 31);
+  }
+}
+
+// Write and read back patterns through the uncached alias, then time reading it all
+bool __no_inline_not_in_flash_func(PicoPlusPsram::TestTiming)(const PsramTiming &timing, uint32_t &uReadUs, uint8_t uRepeats)
+{
+  volatile uint32_t *pWords = (volatile uint32_t *)GetUncachedAddress((void *)PSRAM_LOCATION);
+  volatile uint16_t *pHalves = (volatile uint16_t *)pWords;
+  const uint32_t uWords = c_uTestBytes / 4;
+  PsramTiming previous = m_timing;
+  bool bPass = true;
+
+  ApplyTiming(timing);
+
+  for(uint8_t uRepeat = 0; uRepeat < uRepeats && bPass; uRepeat++)
+  {
+    for(uint8_t uPattern = 0; uPattern < 4 && bPass; uPattern++)
+    {
+      for(uint32_t i = 0; i < uWords; i++)
+        pWords[i] = TestPattern(uPattern, i + uRepeat);
+
+      for(uint32_t i = 0; i < uWords && bPass; i++)
+        bPass = pWords[i] == TestPattern(uPattern, i + uRepeat);
+    }
+
+    // 16 bit writes, as to a framebuffer, must leave the other half alone
+    for(uint32_t i = 0; i < uWords && bPass; i++)
+      pHalves[i * 2] = (uint16_t)~i;
+
+    for(uint32_t i = 0; i < uWords && bPass; i++)
+      bPass = pWords[i] == ((TestPattern(3, i + uRepeat) & 0xffff0000) | (uint16_t)~i);
+  }
+
+  uint64_t startTime = time_us_64();
+  for(uint32_t i = 0; i < uWords; i++)
+    (void)pWords[i];
+  uReadUs = (uint32_t)(time_us_64() - startTime);
+
+  ApplyTiming(previous);
+  return bPass;
+}
+
+// Try each divisor from 1 up to the default one, the psram clock up to uMaxPsramHz, and every
+// rx delay. For each divisor the rx delay in the middle of those that pass is tested again
+// a few times, and the one of those that reads fastest is kept. With uMaxPsramHz at the
+// 133MHz rating the default divisor is the only one in range, see PSRAM_CALIBRATE_MAX_HZ.
+void PicoPlusPsram::Calibrate(uint32_t uMaxPsramHz)
+{
+  uint32_t uClockHz = clock_get_hz(clk_sys);
+  PsramTiming best = m_timing;
+  uint32_t uBestUs;
+
+  if(!TestTiming(best, uBestUs, c_uStableRepeats))
+    uBestUs = UINT32_MAX;
+
+  for(uint8_t uClkDiv = 1; uClkDiv <= m_timing.uClkDiv; uClkDiv++)
+  {
+    if(uClockHz / uClkDiv > uMaxPsramHz)
+      continue;
+
+    uint8_t uPassMask = 0;
+    for(uint8_t uRxDelay = 0; uRxDelay <= PsramTiming::c_uMaxRxDelay; uRxDelay++)
     {
-        {(void *)PSRAM_LOCATION, m_uMemorySize}, 
-        {nullptr, 0}
-    };
+      uint32_t uReadUs;
+      if(TestTiming(PsramTiming::Make(uClockHz, uClkDiv, uRxDelay), uReadUs))
+        uPassMask |= 1 << uRxDelay;
+    }
+
+    int8_t iRxDelay = PsramTiming::PickRxDelay(uPassMask);
+    if(iRxDelay < 0)
+      continue;
 
-    lwmem_assignmem(regions);
+    PsramTiming timing = PsramTiming::Make(uClockHz, uClkDiv, iRxDelay);
+    uint32_t uReadUs;
+    if(TestTiming(timing, uReadUs, c_uStableRepeats) && uReadUs < uBestUs)
+    {
+      best = timing;
+      uBestUs = uReadUs;
+    }
   }
+
+  ApplyTiming(best);
+  m_bCalibrated = true;
 }
 
+// The uncached alias sits at the same offset from the cached one as for flash
+void *PicoPlusPsram::GetUncachedAddress(void *pMem)
+{
+  return (void *)((uintptr_t)pMem + (XIP_NOCACHE_NOALLOC_BASE - XIP_BASE));
+}
+
+// Offset into the XIP address space the cache maintenance works on, the same for both views
+static inline uintptr_t CacheOffset(const void *pMem)
+{
+  return ((uintptr_t)pMem - XIP_BASE) & ((XIP_NOCACHE_NOALLOC_BASE - XIP_BASE) - 1);
+}
+
+void *PicoPlusPsram::GetCachedAddress(const void *pMem)
+{
+  return (void *)(XIP_BASE + CacheOffset(pMem));
+}
+
+void PicoPlusPsram::CleanCache(const void *pMem, size_t uSize)
+{
+  if(!uSize)
+    return;
+
+  if(uSize >= c_uCacheSize)
+  {
+    xip_cache_clean_all();
+    return;
+  }
+
+  uintptr_t uStart = CacheOffset(pMem) & ~(c_uCacheLineSize - 1);
+  uintptr_t uEnd = (CacheOffset(pMem) + uSize + c_uCacheLineSize - 1) & ~(c_uCacheLineSize - 1);
+  xip_cache_clean_range(uStart, uEnd - uStart);
+}
+
+void PicoPlusPsram::InvalidateCache(const void *pMem, size_t uSize)
+{
+  if(!uSize)
+    return;
+
+  // by range however large, invalidating by set/way would drop dirty lines outside the range
+  // and cleaning them all first would write back the range too
+  uintptr_t uFirst = CacheOffset(pMem);
+  uintptr_t uLast = uFirst + uSize;
+  uintptr_t uStart = uFirst & ~(c_uCacheLineSize - 1);
+  uintptr_t uEnd = (uLast + c_uCacheLineSize - 1) & ~(c_uCacheLineSize - 1);
+
+  if(uStart != uFirst)
+    xip_cache_clean_range(uStart, c_uCacheLineSize);
+  if(uEnd != uLast)
+    xip_cache_clean_range(uEnd - c_uCacheLineSize, c_uCacheLineSize);
+
+  xip_cache_invalidate_range(uStart, uEnd - uStart);
+}
 
 size_t __no_inline_not_in_flash_func(PicoPlusPsram::Detect)(void) 
 {
@@ -108,9 +298,6 @@ size_t __no_inline_not_in_flash_func(PicoPlusPsram::Init)(uint cs_pin)
 {
     uint32_t intr_stash = save_and_disable_interrupts();
 
-
-    volatile const int clock_hz1 = clock_get_hz(clk_sys);
-
     gpio_set_function(cs_pin, GPIO_FUNC_XIP_CS1);
 
 
@@ -136,38 +323,9 @@ size_t __no_inline_not_in_flash_func(PicoPlusPsram::Init)(uint cs_pin)
         ;
     }
 
-    // Set PSRAM timing for APS6404
-    //
-    // Using an rxdelay equal to the divisor isn't enough when running the APS6404 close to 133MHz.
-    // So: don't allow running at divisor 1 above 100MHz (because delay of 2 would be too late),
-    // and add an extra 1 to the rxdelay if the divided clock is > 100MHz (i.e. sys clock > 200MHz).
-    const int max_psram_freq = 133000000;
-    const int clock_hz = clock_get_hz(clk_sys);
-    int divisor = (clock_hz + max_psram_freq - 1) / max_psram_freq;
-    if (divisor == 1 && clock_hz > 100000000) {
-        divisor = 2;
-    }
-    int rxdelay = divisor;
-    if (clock_hz / divisor > 100000000) {
-        rxdelay += 1;
-    }
-
-    // - Max select must be <= 8us.  The value is given in multiples of 64 system clocks.
-    // - Min deselect must be >= 18ns.  The value is given in system clock cycles - ceil(divisor / 2).
-    const int clock_period_fs = 1000000000000000ll / clock_hz1;
-    int max_select = (125 * 1000000) / clock_period_fs;  // 125 = 8000ns / 64
-    int min_deselect = (18 * 1000000 + (clock_period_fs - 1)) / clock_period_fs - (divisor + 1) / 2;
-
-
-    // max_select = 0;
-    // min_deselect = 0;
-
-    qmi_hw->m[1].timing = 1 << QMI_M1_TIMING_COOLDOWN_LSB |
-        QMI_M1_TIMING_PAGEBREAK_VALUE_1024 << QMI_M1_TIMING_PAGEBREAK_LSB |
-        max_select << QMI_M1_TIMING_MAX_SELECT_LSB |
-        min_deselect << QMI_M1_TIMING_MIN_DESELECT_LSB |
-        rxdelay << QMI_M1_TIMING_RXDELAY_LSB |
-        divisor << QMI_M1_TIMING_CLKDIV_LSB;
+    // Set PSRAM timing for APS6404, the formula is in PsramTiming::Default()
+    m_timing = PsramTiming::Default(clock_get_hz(clk_sys));
+    qmi_hw->m[1].timing = TimingRegister(m_timing);
 
     // Set PSRAM commands and formats
     qmi_hw->m[1].rfmt =
@@ -1,10 +1,69 @@
 #pragma once
 
+#include <string.h>
+
 #include "lwmem/lwmem.h"
 
+#include "PsramTiming.h"
+#include "PsramTrace.h"
+
+// PSRAM_CALIBRATE 0 = use the default psram timing, 1 = find the fastest timing that works at startup
+#ifndef PSRAM_CALIBRATE
+#define PSRAM_CALIBRATE 0
+#endif
+
+// Calibration does not try psram clocks above this. Default() already picks the smallest
+// divisor within the APS6404's 133MHz rating, so with this left at 133MHz calibration only
+// tries the default divisor and varies the rx delay, at 266MHz divisor 2. Divisor 1 is only
+// tried with a system clock between 100MHz and this, or with this raised above 133MHz to run
+// the psram past its rating. Max select and min deselect are not swept, Make() works them
+// out from the datasheet limits for each divisor.
+#ifndef PSRAM_CALIBRATE_MAX_HZ
+#define PSRAM_CALIBRATE_MAX_HZ 133000000
+#endif
+
+// Bytes at the start of psram kept for the framebuffer heap, 0 = everything in the general heap
+#ifndef PSRAM_FRAME_HEAP_SIZE
+#define PSRAM_FRAME_HEAP_SIZE (2 * 1024 * 1024)
+#endif
+
+// Framebuffer heap allocations start on this boundary, the APS6404 page size
+#ifndef PSRAM_FRAME_HEAP_ALIGN
+#define PSRAM_FRAME_HEAP_ALIGN 1024
+#endif
+
 class PicoPlusPsram
 {
   public:
+    // Heap
+    //  Psram is split into lwmem heaps managed separately, so the few large long lived
+    //  framebuffers don't end up among thousands of small objects where fragmentation
+    //  can leave no room to allocate them again.
+    enum Heap
+    {
+      heapGeneral,  // objects, textures and buffers, BaseClass and Allocator use it
+      heapFrame,    // framebuffers, aligned to PSRAM_FRAME_HEAP_ALIGN
+      heapCount
+    };
+
+    struct HeapStats
+    {
+      const char *pName;
+      size_t     uSize;               // bytes given to the heap
+      size_t     uAvailable;          // bytes free now
+      size_t     uMinimumAvailable;   // fewest bytes ever free
+      size_t     uLargestFree;        // biggest free block, the most that can be allocated at once
+      uint32_t   uFreeBlocks;         // free blocks the free bytes are split between
+      uint32_t   uAllocations;
+      uint32_t   uFrees;
+
+      // 0 when the free bytes are in one block, towards 1 as they are split into smaller ones
+      float GetFragmentation(void) const
+      {
+        return uAvailable ? 1.0f - (float)uLargestFree / uAvailable : 0.0f;
+      }
+    };
+
     // BaseClass
     //  Inherit from this to allocate dynamic objects in psram
     class BaseClass
@@ -15,13 +74,12 @@ class PicoPlusPsram
 
       void *operator new(size_t size)
       {
-        void * p = lwmem_malloc(size);
-        return p;
+        return getInstance().Malloc(size);
       }
 
       void operator delete(void *ptr)
       {
-        lwmem_free(ptr);
+        getInstance().Free(ptr);
       }
     };
 
@@ -39,20 +97,90 @@ class PicoPlusPsram
     
         [[nodiscard]] T* allocate(std::size_t n)
         {
-            if (auto p = static_cast<T*>(lwmem_malloc(n * sizeof(T))))
-              return p;
-            else
-              return nullptr;
+            return static_cast<T*>(getInstance().Malloc(n * sizeof(T)));
         }
     
         void deallocate(T* p, std::size_t n) noexcept
         {
-            lwmem_free(p);
+            getInstance().Free(p);
         }
         bool operator==(const Allocator <T>&) { return true;}
         bool operator!=(const Allocator <T>&) { return false;}
     };
-  
+
+    // Buffer
+    //  A typed psram allocation with a cached and an uncached view of the same memory.
+    //
+    //  The cached view goes through the XIP cache, so read-modify-write and repeated reads
+    //  are cheap, but writes sit in the cache until they are evicted or cleaned. The
+    //  uncached view goes straight to psram, as the display and DMA see it, so every
+    //  access pays the psram latency but nothing needs flushing.
+    //
+    //  Mixing the two needs the cache maintained:
+    //    Clean()      - after writing through the cached view, before the display or DMA reads it
+    //    Invalidate() - after the display side or DMA wrote it, before reading through the cached view
+    //
+    //  Buffers are plain handles, copies refer to the same memory and Free() releases it.
+    template<class T>
+    class Buffer
+    {
+    public:
+      Buffer(void) = default;
+      Buffer(T *pCached, size_t uCount) : m_pCached(pCached), m_uCount(pCached ? uCount : 0) {}
+
+      bool IsValid(void) const
+      {
+        return m_pCached != nullptr;
+      }
+
+      T *Cached(void) const
+      {
+        return m_pCached;
+      }
+
+      T *Uncached(void) const
+      {
+        return (T *)getInstance().GetUncachedAddress(m_pCached);
+      }
+
+      // Number of T in the buffer
+      size_t GetCount(void) const
+      {
+        return m_uCount;
+      }
+
+      size_t GetSizeBytes(void) const
+      {
+        return m_uCount * sizeof(T);
+      }
+
+      // Write back cached writes to elements [uFirst, uFirst + uCount)
+      void Clean(size_t uFirst, size_t uCount) const
+      {
+        getInstance().CleanCache(m_pCached + uFirst, uCount * sizeof(T));
+      }
+
+      void Clean(void) const
+      {
+        Clean(0, m_uCount);
+      }
+
+      // Drop cached copies of elements [uFirst, uFirst + uCount) so the next cached reads see psram
+      void Invalidate(size_t uFirst, size_t uCount) const
+      {
+        getInstance().InvalidateCache(m_pCached + uFirst, uCount * sizeof(T));
+      }
+
+      void Invalidate(void) const
+      {
+        Invalidate(0, m_uCount);
+      }
+
+    private:
+      T      *m_pCached = nullptr;
+      size_t m_uCount = 0;
+    };
+
     // No public access to constructor/destructor
     PicoPlusPsram(const PicoPlusPsram&) = delete;
     PicoPlusPsram& operator = (const PicoPlusPsram&) = delete;
@@ -64,6 +192,23 @@ class PicoPlusPsram
       return instance;
     }
 
+    // Use a timing saved from an earlier calibration rather than sweeping for one, call before
+    // the first getInstance(). It is tested before it is used and ignored if it fails or was
+    // calibrated at another system clock.
+    static void SetSavedTiming(const PsramTiming &timing);
+
+    // The psram timing in use, save it after calibrating to give to SetSavedTiming() next time
+    const PsramTiming &GetTiming(void) const
+    {
+      return m_timing;
+    }
+
+    // True if the timing came from calibration or a saved timing rather than the default
+    bool IsCalibrated(void) const
+    {
+      return m_bCalibrated;
+    }
+
     // Get the total psram memory size
     size_t GetMemorySize(void)
     {
@@ -71,43 +216,157 @@ class PicoPlusPsram
     }
 
     // Malloc psram memory
-    void *Malloc(size_t uSize)
+    void *Malloc(size_t uSize, Heap heap = heapGeneral)
     {
-      return lwmem_malloc_ex(nullptr, nullptr, uSize);
+      if(heap == heapFrame && m_uFrameHeapSize)
+        return FrameMalloc(uSize);
+      return GeneralMalloc(uSize);
     }
 
     // Calloc psram memory
-    void *Calloc(size_t uItems, size_t uSize) 
+    void *Calloc(size_t uItems, size_t uSize, Heap heap = heapGeneral)
+    {
+      void *pMem = Malloc(uItems * uSize, heap);
+      if(pMem)
+        memset(pMem, 0, uItems * uSize);
+      return pMem;
+    }
+
+    // Realloc psram memory in the heap it came from, returns the moved block's cached view
+    // or nullptr if there is no room, when pMem is left as it was. Either view can be given.
+    void *Realloc(void *pMem, const size_t uSize)
+    {
+      if(!pMem)
+        return Malloc(uSize);
+
+      pMem = GetCachedAddress(pMem);
+      if(IsInFrameHeap(pMem))
+        return FrameRealloc(pMem, uSize);
+      return GeneralRealloc(pMem, uSize);
+    }
+
+    // Free psram memory from either heap, either view can be given
+    void Free(void *pMem)
     {
-      return lwmem_calloc_ex(nullptr, nullptr, uItems, uSize);
+      if(!pMem)
+        return;
+
+      pMem = GetCachedAddress(pMem);
+      if(IsInFrameHeap(pMem))
+        FrameFree(pMem);
+      else
+        GeneralFree(pMem);
     }
 
-    // Realloc psram memory
-    void Realloc(void * const pMem, const size_t uSize)
+    // Allocate uCount T, an invalid buffer if there is no room
+    template<class T>
+    Buffer<T> Allocate(size_t uCount, Heap heap = heapGeneral)
     {
-      lwmem_realloc_ex(nullptr, nullptr, pMem, uSize);
+      return Buffer<T>((T *)Malloc(uCount * sizeof(T), heap), uCount);
     }
 
-    // Free psram memory
-    void Free(void * const pMem)
+    template<class T>
+    void Free(Buffer<T> &buffer)
     {
-      lwmem_free_ex(nullptr, pMem);
+      Free(buffer.Cached());
+      buffer = Buffer<T>();
     }
 
-    // Get the size of an allocated block
+    // Get the uncached alias of a psram address, accesses through it bypass the XIP cache
+    void *GetUncachedAddress(void *pMem);
+
+    // Get the cached view of a psram address, either view can be given
+    void *GetCachedAddress(const void *pMem);
+
+    // Write back any cached writes to uSize bytes at pMem, either view of the address can be given
+    void CleanCache(const void *pMem, size_t uSize);
+
+    // Drop the cached copy of uSize bytes at pMem without writing it back. Cache lines only
+    // partly in the range are cleaned first, so writes to neighbouring memory are not lost.
+    // Always done a line at a time, so a large range takes a maintenance write per 8 bytes.
+    void InvalidateCache(const void *pMem, size_t uSize);
+
+    // Get the size of an allocated block, either view can be given
     size_t GetSize(void *pMem)
     {
-      return lwmem_get_size_ex(nullptr, pMem);
+      pMem = GetCachedAddress(pMem);
+      if(IsInFrameHeap(pMem))
+        return GetFrameBlock(pMem)->uSize;
+#if PSRAM_TRACE
+      return GetGeneralBlock(pMem)->uSize;
+#else
+      return lwmem_get_size_ex(&m_lwmem[heapGeneral], pMem);
+#endif
     }
 
-#if LWMEM_CFG_ENABLE_STATS
     // Gets available bytes
-    size_t GetAvailableBytes(void)
+    size_t GetAvailableBytes(Heap heap = heapGeneral)
     {
-      lwmem_get_stats_ex(nullptr, &m_lwmemStats);
-      return m_lwmemStats.mem_available_bytes; 
+      return m_lwmem[heap].mem_available_bytes;
     }
+
+    // Walks the free list, call when the other core is not allocating
+    HeapStats GetStats(Heap heap)
+    {
+      static const char *names[heapCount] = {"general", "frame"};
+
+      HeapStats stats = {};
+      stats.pName = names[heap];
+      stats.uSize = GetHeapSize(heap);
+      stats.uAvailable = m_lwmem[heap].mem_available_bytes;
+
+      ForEachFreeBlock(heap, [&](uint8_t *pBlock, size_t uSize)
+      {
+        if(uSize > stats.uLargestFree)
+          stats.uLargestFree = uSize;
+        stats.uFreeBlocks++;
+      });
+
+#if LWMEM_CFG_ENABLE_STATS
+      if(stats.uSize)
+      {
+        lwmem_stats_t lwmemStats;
+        lwmem_get_stats_ex(&m_lwmem[heap], &lwmemStats);
+        stats.uMinimumAvailable = lwmemStats.minimum_ever_mem_available_bytes;
+        stats.uAllocations = lwmemStats.nr_alloc;
+        stats.uFrees = lwmemStats.nr_free;
+      }
 #endif
+      return stats;
+    }
+
+    // Fill pMap with uCells characters each mapping an equal slice of uSize bytes uOffset into a
+    // heap, '#' if the slice is all allocated, '.' if it is all free and '+' if it is some of each.
+    // A uSize of 0 maps the whole heap.
+    void GetHeapMap(Heap heap, char *pMap, uint32_t uCells, size_t uOffset = 0, size_t uSize = 0)
+    {
+      size_t uHeapSize = GetHeapSize(heap);
+      if(uOffset > uHeapSize)
+        uOffset = uHeapSize;
+      if(!uSize || uSize > uHeapSize - uOffset)
+        uSize = uHeapSize - uOffset;
+
+      uint8_t *pHeap = GetHeapStart(heap) + uOffset;
+      uHeapSize = uSize;
+      size_t uCellSize = (uHeapSize + uCells - 1) / uCells;
+
+      for(uint32_t uCell = 0; uCell < uCells; uCell++)
+      {
+        uint8_t *pCellStart = pHeap + uCell * uCellSize;
+        uint8_t *pCellEnd = pHeap + (uCell + 1) * uCellSize < pHeap + uHeapSize ? pHeap + (uCell + 1) * uCellSize : pHeap + uHeapSize;
+        size_t uFree = 0;
+
+        ForEachFreeBlock(heap, [&](uint8_t *pBlock, size_t uSize)
+        {
+          uint8_t *pStart = pBlock > pCellStart ? pBlock : pCellStart;
+          uint8_t *pEnd = pBlock + uSize < pCellEnd ? pBlock + uSize : pCellEnd;
+          if(pEnd > pStart)
+            uFree += pEnd - pStart;
+        });
+
+        pMap[uCell] = pCellEnd <= pCellStart || uFree == (size_t)(pCellEnd - pCellStart) ? '.' : uFree ? '+' : '#';
+      }
+    }
 
   private:
     PicoPlusPsram(void);
@@ -116,9 +375,202 @@ class PicoPlusPsram
     size_t Detect(void);
     size_t Init(uint cs_pin);
 
-    size_t m_uMemorySize = 0;
+    // Calibration, before lwmem is given the psram as the tests overwrite the start of it
+    void Calibrate(uint32_t uMaxPsramHz);
+    bool TestTiming(const PsramTiming &timing, uint32_t &uReadUs, uint8_t uRepeats = 1);
+    void ApplyTiming(const PsramTiming &timing);
 
-#if LWMEM_CFG_ENABLE_STATS
-    lwmem_stats_t m_lwmemStats;
+    // Give the first uFrameHeapSize bytes to the framebuffer heap and the rest to the general heap
+    void AssignHeaps(uint8_t *pMemory, size_t uFrameHeapSize)
+    {
+      if(uFrameHeapSize >= m_uMemorySize)
+        uFrameHeapSize = 0;
+
+      static lwmem_region_t frameRegions[] =
+      {
+          {nullptr, 0},
+          {nullptr, 0}
+      };
+      static lwmem_region_t generalRegions[] =
+      {
+          {nullptr, 0},
+          {nullptr, 0}
+      };
+
+      if(uFrameHeapSize)
+      {
+        frameRegions[0] = {pMemory, uFrameHeapSize};
+        lwmem_assignmem_ex(&m_lwmem[heapFrame], frameRegions);
+      }
+      generalRegions[0] = {pMemory + uFrameHeapSize, m_uMemorySize - uFrameHeapSize};
+      lwmem_assignmem_ex(&m_lwmem[heapGeneral], generalRegions);
+
+      m_pMemory = pMemory;
+      m_uFrameHeapSize = uFrameHeapSize;
+    }
+
+    uint8_t *GetHeapStart(Heap heap) const
+    {
+      return heap == heapFrame ? m_pMemory : m_pMemory + m_uFrameHeapSize;
+    }
+
+    size_t GetHeapSize(Heap heap) const
+    {
+      return heap == heapFrame ? m_uFrameHeapSize : m_uMemorySize - m_uFrameHeapSize;
+    }
+
+    // Calls fnBlock(pBlock, uSize) for each block on a heap's free list, in address order.
+    // The sizes include lwmem's block header.
+    template<typename F>
+    void ForEachFreeBlock(Heap heap, F fnBlock)
+    {
+      lwmem_t &lwmem = m_lwmem[heap];
+      for(lwmem_block_t *pBlock = lwmem.start_block.next; pBlock && pBlock != lwmem.end_block; pBlock = pBlock->next)
+        fnBlock((uint8_t *)pBlock, pBlock->size);
+    }
+
+#if PSRAM_TRACE
+    // General heap blocks have the size asked for and the PsramTrace tag just before them
+    struct GeneralBlock
+    {
+      uint32_t uSize;
+      uint8_t  uTag;
+      uint8_t  reserved[3];
+    };
+
+    static GeneralBlock *GetGeneralBlock(void *pMem)
+    {
+      return (GeneralBlock *)pMem - 1;
+    }
+#endif
+
+    void *GeneralMalloc(size_t uSize)
+    {
+#if PSRAM_TRACE
+      uint8_t uTag = PsramTrace::GetCurrentTag();
+      GeneralBlock *pBlock = (GeneralBlock *)lwmem_malloc_ex(&m_lwmem[heapGeneral], nullptr, sizeof(GeneralBlock) + uSize);
+      if(!pBlock)
+      {
+        PsramTrace::OnFailure(uTag);
+        return nullptr;
+      }
+
+      pBlock->uSize = uSize;
+      pBlock->uTag = uTag;
+      PsramTrace::OnAlloc(uTag, uSize);
+      return pBlock + 1;
+#else
+      return lwmem_malloc_ex(&m_lwmem[heapGeneral], nullptr, uSize);
 #endif
+    }
+
+    void *GeneralRealloc(void *pMem, size_t uSize)
+    {
+      if(!uSize)
+      {
+        GeneralFree(pMem);
+        return nullptr;
+      }
+
+#if PSRAM_TRACE
+      // the block keeps the tag it was allocated with
+      uint8_t uTag = GetGeneralBlock(pMem)->uTag;
+      size_t uOldSize = GetGeneralBlock(pMem)->uSize;
+      GeneralBlock *pBlock = (GeneralBlock *)lwmem_realloc_ex(&m_lwmem[heapGeneral], nullptr, GetGeneralBlock(pMem), sizeof(GeneralBlock) + uSize);
+      if(!pBlock)
+      {
+        PsramTrace::OnFailure(uTag);
+        return nullptr;
+      }
+
+      pBlock->uSize = uSize;
+      PsramTrace::OnFree(uTag, uOldSize);
+      PsramTrace::OnAlloc(uTag, uSize);
+      return pBlock + 1;
+#else
+      return lwmem_realloc_ex(&m_lwmem[heapGeneral], nullptr, pMem, uSize);
+#endif
+    }
+
+    void GeneralFree(void *pMem)
+    {
+#if PSRAM_TRACE
+      PsramTrace::OnFree(GetGeneralBlock(pMem)->uTag, GetGeneralBlock(pMem)->uSize);
+      pMem = GetGeneralBlock(pMem);
+#endif
+      lwmem_free_ex(&m_lwmem[heapGeneral], pMem);
+    }
+
+    // Framebuffer heap blocks have the lwmem block, the size asked for and the PsramTrace tag
+    // just before them, lwmem only aligns to LWMEM_CFG_ALIGN_NUM
+    struct FrameBlock
+    {
+      void    *pRaw;
+      size_t  uSize;
+      uint8_t uTag;
+    };
+
+    // pMem must be the cached view, the heaps are managed through it
+    bool IsInFrameHeap(const void *pMem) const
+    {
+      return (const uint8_t *)pMem >= m_pMemory && (const uint8_t *)pMem < m_pMemory + m_uFrameHeapSize;
+    }
+
+    static FrameBlock *GetFrameBlock(void *pMem)
+    {
+      return (FrameBlock *)pMem - 1;
+    }
+
+    void *FrameMalloc(size_t uSize)
+    {
+      uint8_t uTag = PsramTrace::GetCurrentTag();
+      uint8_t *pRaw = (uint8_t *)lwmem_malloc_ex(&m_lwmem[heapFrame], nullptr, uSize + sizeof(FrameBlock) + PSRAM_FRAME_HEAP_ALIGN - 1);
+      if(!pRaw)
+      {
+        PsramTrace::OnFailure(uTag);
+        return nullptr;
+      }
+
+      uintptr_t uAligned = ((uintptr_t)pRaw + sizeof(FrameBlock) + PSRAM_FRAME_HEAP_ALIGN - 1) & ~(uintptr_t)(PSRAM_FRAME_HEAP_ALIGN - 1);
+      FrameBlock *pBlock = GetFrameBlock((void *)uAligned);
+      pBlock->pRaw = pRaw;
+      pBlock->uSize = uSize;
+      pBlock->uTag = uTag;
+      PsramTrace::OnAlloc(uTag, uSize);
+      return (void *)uAligned;
+    }
+
+    // lwmem could move the block by an amount that breaks the alignment, so allocate and copy
+    void *FrameRealloc(void *pMem, size_t uSize)
+    {
+      if(!uSize)
+      {
+        FrameFree(pMem);
+        return nullptr;
+      }
+
+      void *pNew = FrameMalloc(uSize);
+      if(pNew)
+      {
+        size_t uOldSize = GetFrameBlock(pMem)->uSize;
+        memcpy(pNew, pMem, uOldSize < uSize ? uOldSize : uSize);
+        FrameFree(pMem);
+      }
+      return pNew;
+    }
+
+    void FrameFree(void *pMem)
+    {
+      FrameBlock *pBlock = GetFrameBlock(pMem);
+      PsramTrace::OnFree(pBlock->uTag, pBlock->uSize);
+      lwmem_free_ex(&m_lwmem[heapFrame], pBlock->pRaw);
+    }
+
+    size_t      m_uMemorySize = 0;
+    PsramTiming m_timing = {};
+    bool        m_bCalibrated = false;
+
+    lwmem_t     m_lwmem[heapCount] = {};
+    uint8_t     *m_pMemory = nullptr;
+    size_t      m_uFrameHeapSize = 0;
 };
@@ -0,0 +1,53 @@
+#include "pico/stdlib.h"
+
+#include "PsramArena.h"
+
+// Private constructor
+PsramArena::PsramArena(void)
+{
+  // take the arena region from lwmem, everything overflows to lwmem if it is not available
+  PsramTrace::Scope tag("arena");
+  m_pBase = (uint8_t *)PicoPlusPsram::getInstance().Malloc(c_uArenaSize);
+}
+
+// The arena is full, allocate from lwmem with a header to chain the block for Reset()
+void *PsramArena::Overflow(size_t uSize, size_t uAlign)
+{
+  PsramTrace::Scope tag("arena");
+  uint8_t *pRaw = (uint8_t *)PicoPlusPsram::getInstance().Malloc(sizeof(OverflowBlock) + uAlign - 1 + uSize);
+  if(!pRaw)
+    return nullptr;
+
+  OverflowBlock *pBlock = (OverflowBlock *)pRaw;
+  pBlock->pNext = m_pOverflow;
+  m_pOverflow = pBlock;
+
+  m_uOverflowBytes += uSize;
+  m_uOverflowCount++;
+
+  uintptr_t uAligned = ((uintptr_t)pRaw + sizeof(OverflowBlock) + uAlign - 1) & ~(uintptr_t)(uAlign - 1);
+  return (void *)uAligned;
+}
+
+void PsramArena::FreeOverflow(void)
+{
+  while(m_pOverflow)
+  {
+    OverflowBlock *pNext = m_pOverflow->pNext;
+    PicoPlusPsram::getInstance().Free(m_pOverflow);
+    m_pOverflow = pNext;
+  }
+  m_uOverflowBytes = 0;
+}
+
+PsramArena::Stats PsramArena::GetStats(void) const
+{
+  Stats stats;
+
+  stats.uArenaBytes     = m_pBase ? c_uArenaSize : 0;
+  stats.uUsedBytes      = m_uUsed + m_uOverflowBytes;
+  stats.uLastFrameBytes = m_uLastFrameBytes;
+  stats.uHighWater      = m_uHighWater;
+  stats.uOverflowCount  = m_uOverflowCount;
+  return stats;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "PicoPlusPsram.h"
+
+// Size of the psram region allocations for a frame are bumped from
+#ifndef PSRAM_ARENA_SIZE
+#define PSRAM_ARENA_SIZE (256 * 1024)
+#endif
+
+// PsramArena
+//  Linear allocator for psram memory that only lives for one frame, such as vertex
+//  lists and glyph scratch buffers, layered over PicoPlusPsram.
+//
+//  On first use PSRAM_ARENA_SIZE bytes are taken from lwmem. Allocating moves a
+//  pointer along the region and freeing does nothing, everything is released at once
+//  by Reset() at the swap point of the main loop, so there is no free list to walk
+//  and nothing left behind to fragment. Allocations that don't fit go to lwmem and
+//  are freed by the next Reset(), the stats show when the arena should be larger.
+//
+//  Not safe to use from both cores, keep it to the render loop.
+//
+//  Each frame:
+//    Malloc(), Allocator  - temporary memory for this frame
+//    Reset()              - at the swap, everything allocated this frame is released
+class PsramArena
+{
+public:
+  // Allocator
+  //  Use instead of PicoPlusPsram::Allocator for containers that are thrown away before
+  //  Reset(). Memory a container lets go of as it grows is only released by Reset(),
+  //  so reserve() what is needed up front.
+  template<class T>
+  struct Allocator
+  {
+      typedef T value_type;
+
+      Allocator() = default;
+
+      template<class U>
+      constexpr Allocator(const Allocator <U>&) noexcept {}
+
+      [[nodiscard]] T* allocate(std::size_t n)
+      {
+          return static_cast<T*>(PsramArena::getInstance().Malloc(n * sizeof(T), alignof(T)));
+      }
+
+      void deallocate(T* p, std::size_t n) noexcept
+      {
+      }
+      bool operator==(const Allocator <T>&) { return true;}
+      bool operator!=(const Allocator <T>&) { return false;}
+  };
+
+  struct Stats
+  {
+    size_t   uArenaBytes;     // size of the arena region
+    size_t   uUsedBytes;      // bytes allocated this frame, including alignment and overflow
+    size_t   uLastFrameBytes; // bytes allocated in the frame before the last Reset()
+    size_t   uHighWater;      // most bytes allocated in any frame, the arena size that would have fitted
+    uint32_t uOverflowCount;  // allocations passed to lwmem since the arena was made
+  };
+
+  // No public access to constructor/destructor
+  PsramArena(const PsramArena&) = delete;
+  PsramArena& operator = (const PsramArena&) = delete;
+
+  // Get singleton instance
+  static PsramArena& getInstance()
+  {
+    static PsramArena instance;
+    return instance;
+  }
+
+  // Allocate psram memory until the next Reset(), uAlign must be a power of two
+  void *Malloc(size_t uSize, size_t uAlign = 8)
+  {
+    uintptr_t uAddress = ((uintptr_t)m_pBase + m_uUsed + uAlign - 1) & ~(uintptr_t)(uAlign - 1);
+    size_t uEnd = uAddress - (uintptr_t)m_pBase + uSize;
+    if(m_pBase && uEnd <= c_uArenaSize)
+    {
+      m_uUsed = uEnd;
+      return (void *)uAddress;
+    }
+    return Overflow(uSize, uAlign);
+  }
+
+  // Release everything allocated since the last Reset()
+  void Reset(void)
+  {
+    size_t uFrameBytes = m_uUsed + m_uOverflowBytes;
+    if(uFrameBytes > m_uHighWater)
+      m_uHighWater = uFrameBytes;
+    m_uLastFrameBytes = uFrameBytes;
+    m_uUsed = 0;
+
+    if(m_pOverflow)
+      FreeOverflow();
+  }
+
+  Stats GetStats(void) const;
+
+private:
+  PsramArena(void);
+  ~PsramArena(void) = default;
+
+  static const size_t c_uArenaSize = PSRAM_ARENA_SIZE;
+
+  // Overflow blocks from lwmem are chained through a header so Reset() can free them
+  struct OverflowBlock
+  {
+    OverflowBlock *pNext;
+  };
+
+  void *Overflow(size_t uSize, size_t uAlign);
+  void FreeOverflow(void);
+
+  uint8_t       *m_pBase = nullptr;
+  size_t        m_uUsed = 0;
+  size_t        m_uLastFrameBytes = 0;
+  size_t        m_uHighWater = 0;
+  OverflowBlock *m_pOverflow = nullptr;
+  size_t        m_uOverflowBytes = 0;    // asked for from lwmem this frame
+  uint32_t      m_uOverflowCount = 0;
+};
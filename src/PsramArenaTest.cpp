@@ -0,0 +1,145 @@
+// ******************************************************************************
+// This host tool checks PsramArena over the PicoPlusPsram stand-in:
+//
+//   bump      - allocations follow each other along the region
+//   alignment - every power of two up to 4KB, and through Allocator
+//   overflow  - what does not fit comes from lwmem, aligned, and is counted
+//   Reset()   - the next frame starts at the same address, lwmem gets the
+//               overflow back and the frame's bytes and high water are kept
+//
+// Each failed check is printed, and the process exits with 1 if any failed.
+// ******************************************************************************
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "PsramArena.h"
+
+static uint32_t uFailures = 0;
+
+static void Check(bool bOk, const char *pWhat, size_t uValue, size_t uExpected)
+{
+  if(bOk)
+    return;
+
+  printf("FAIL %s: got %zu expected %zu\n", pWhat, uValue, uExpected);
+  uFailures++;
+}
+
+static void CheckEqual(const char *pWhat, size_t uValue, size_t uExpected)
+{
+  Check(uValue == uExpected, pWhat, uValue, uExpected);
+}
+
+static size_t LwmemAvailable(void)
+{
+  return PicoPlusPsram::getInstance().GetStats(PicoPlusPsram::heapGeneral).uAvailable;
+}
+
+static void TestBump(PsramArena &arena)
+{
+  arena.Reset();
+
+  uint8_t *p1 = (uint8_t *)arena.Malloc(10, 1);
+  uint8_t *p2 = (uint8_t *)arena.Malloc(10, 1);
+  uint8_t *p3 = (uint8_t *)arena.Malloc(3, 1);
+  Check(p1 != nullptr, "bump first allocation", 0, 1);
+  CheckEqual("bump second follows the first", p2 - p1, 10);
+  CheckEqual("bump third follows the second", p3 - p2, 10);
+  CheckEqual("bump used bytes", arena.GetStats().uUsedBytes, 23);
+
+  // neighbours keep what was written to them
+  memset(p1, 1, 10);
+  memset(p2, 2, 10);
+  memset(p3, 3, 3);
+  Check(p1[9] == 1 && p2[0] == 2 && p2[9] == 2 && p3[0] == 3, "bump neighbours intact", 0, 1);
+
+  // the default alignment is 8
+  uint8_t *p4 = (uint8_t *)arena.Malloc(1);
+  CheckEqual("bump default alignment", (uintptr_t)p4 % 8, 0);
+  Check(p4 >= p3 + 3 && p4 < p3 + 3 + 8, "bump default alignment skips at most 7 bytes", p4 - (p3 + 3), 0);
+}
+
+static void TestAlignment(PsramArena &arena)
+{
+  arena.Reset();
+
+  for(size_t uAlign = 1; uAlign <= 4096; uAlign <<= 1)
+  {
+    // start each one off an odd address
+    arena.Malloc(1, 1);
+    void *p = arena.Malloc(24, uAlign);
+    Check(p != nullptr, "alignment allocation", 0, 1);
+    CheckEqual("alignment", (uintptr_t)p % uAlign, 0);
+  }
+
+  arena.Malloc(1, 1);
+  std::vector<double, PsramArena::Allocator<double>> values;
+  values.reserve(16);
+  for(int i = 0; i < 16; i++)
+    values.push_back(i * 0.5);
+  CheckEqual("Allocator alignment", (uintptr_t)values.data() % alignof(double), 0);
+  Check(values[15] == 7.5, "Allocator values", 0, 1);
+}
+
+static void TestOverflowAndReset(PsramArena &arena)
+{
+  arena.Reset();
+  PsramArena::Stats start = arena.GetStats();
+  size_t uLwmemBefore = LwmemAvailable();
+
+  uint8_t *pFirst = (uint8_t *)arena.Malloc(16, 16);
+
+  // fill the rest of the region exactly, it still fits
+  size_t uRest = start.uArenaBytes - arena.GetStats().uUsedBytes;
+  uint8_t *pRest = (uint8_t *)arena.Malloc(uRest, 1);
+  CheckEqual("fill follows the first", pRest - pFirst, 16);
+  CheckEqual("fill did not overflow", arena.GetStats().uOverflowCount, start.uOverflowCount);
+  CheckEqual("fill used bytes", arena.GetStats().uUsedBytes, start.uArenaBytes);
+
+  // nothing more fits
+  uint8_t *pOver = (uint8_t *)arena.Malloc(100, 64);
+  Check(pOver != nullptr, "overflow allocation", 0, 1);
+  CheckEqual("overflow alignment", (uintptr_t)pOver % 64, 0);
+  Check(pOver < pFirst || pOver >= pFirst + start.uArenaBytes, "overflow is outside the region", 0, 1);
+  CheckEqual("overflow count", arena.GetStats().uOverflowCount, start.uOverflowCount + 1);
+  CheckEqual("overflow used bytes", arena.GetStats().uUsedBytes, start.uArenaBytes + 100);
+  Check(LwmemAvailable() < uLwmemBefore, "overflow taken from lwmem", LwmemAvailable(), uLwmemBefore);
+  memset(pOver, 0x5a, 100);
+
+  // larger than the whole region
+  uint8_t *pLarge = (uint8_t *)arena.Malloc(start.uArenaBytes * 2, 8);
+  Check(pLarge != nullptr, "overflow larger than the arena", 0, 1);
+  CheckEqual("overflow count after the large one", arena.GetStats().uOverflowCount, start.uOverflowCount + 2);
+
+  size_t uFrameBytes = arena.GetStats().uUsedBytes;
+  arena.Reset();
+
+  PsramArena::Stats stats = arena.GetStats();
+  CheckEqual("Reset used bytes", stats.uUsedBytes, 0);
+  CheckEqual("Reset last frame bytes", stats.uLastFrameBytes, uFrameBytes);
+  Check(stats.uHighWater >= uFrameBytes, "Reset high water", stats.uHighWater, uFrameBytes);
+  CheckEqual("Reset gives the overflow back to lwmem", LwmemAvailable(), uLwmemBefore);
+  CheckEqual("Reset keeps the overflow count", stats.uOverflowCount, start.uOverflowCount + 2);
+
+  // the next frame starts where this one did, and a smaller one leaves the high water alone
+  CheckEqual("Reset starts over", (uintptr_t)arena.Malloc(16, 16), (uintptr_t)pFirst);
+  size_t uSmallFrameBytes = arena.GetStats().uUsedBytes;
+  arena.Reset();
+  CheckEqual("high water kept", arena.GetStats().uHighWater, stats.uHighWater);
+  CheckEqual("last frame bytes", arena.GetStats().uLastFrameBytes, uSmallFrameBytes);
+}
+
+int main()
+{
+  PsramArena &arena = PsramArena::getInstance();
+  CheckEqual("arena size", arena.GetStats().uArenaBytes, PSRAM_ARENA_SIZE);
+
+  TestBump(arena);
+  TestAlignment(arena);
+  TestOverflowAndReset(arena);
+
+  printf("PsramArena: %u failures\n", (unsigned)uFailures);
+  return uFailures ? 1 : 0;
+}
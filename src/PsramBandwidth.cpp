@@ -0,0 +1,373 @@
+// ******************************************************************************
+// This benchmark measures the raw PSRAM bandwidth of the access patterns the
+// renderers are built from, so choices between them can be made on numbers.
+//
+// Each kernel runs over a 480x480 RGB565 frame sized region from
+// PicoPlusPsram, through the uncached view and through the cached view with
+// the clean needed before the display reads it:
+//
+//   store8/16/32  - sequential stores of each width
+//   store16/N     - 16 bit stores N bytes apart, until the whole region is written
+//   load32        - sequential word loads
+//   load16/960    - 16 bit loads a 480 pixel row apart, down the columns
+//   memset        - memset() against the store32 word loop
+//   copy32        - word loop copying half the region to the other half
+//   memcpy        - memcpy() of the same
+//   sram copy     - memcpy() of an SRAM block over the region
+//
+// and the fill and copies are also queued on PsramDma. Each run is checked
+// against what the kernel should have left in psram, read through the uncached
+// view, so the host build also regression tests the kernels.
+//
+// The psram timing in use is printed first. If the SD card has TIMING_FILE on
+// it, saved by an earlier run, it is given to PicoPlusPsram::SetSavedTiming()
+// before the first getInstance(), and a calibrated timing is saved back to it
+// for the next run, so a PSRAM_CALIBRATE build only sweeps once.
+//
+// Results are logged to the USB UART every 5 seconds as CSV:
+//   kernel,view,bytes,us,mbps,ok
+// MB/s is of the bytes stored, loaded or copied, the best of RUN_COUNT runs.
+// On the host the process exits after one pass, with 1 if any check failed.
+// ******************************************************************************
+
+#include <cstring>
+
+#include "pico/stdlib.h"
+#include "ff.h"
+
+#include "PicoPlusPsram.h"
+#include "PsramDma.h"
+
+#define FRAME_WIDTH  480
+#define FRAME_HEIGHT 480
+#define REGION_SIZE  (FRAME_WIDTH * FRAME_HEIGHT * 2)
+#define SRAM_SIZE    (16 * 1024)
+#define RUN_COUNT    3
+#define TIMING_FILE  "psram_timing.bin"
+
+typedef PicoPlusPsram::Buffer<uint8_t> Region;
+
+// What a kernel leaves in the region, to check it against
+enum Check
+{
+  checkFill,  // every byte is fillByte
+  checkSum,   // loadSum is the sum of what was loaded from the fill
+  checkCopy,  // the second half is the first half's pattern
+  checkSram   // every SRAM_SIZE block is the SRAM pattern
+};
+
+struct Kernel
+{
+  const char *pName;
+  void       (*fnRun)(uint8_t *pRegion, uint32_t uStride);
+  uint32_t   uStride;
+  Check      check;
+  bool       bDma;
+};
+
+static uint8_t  fillByte;
+static uint32_t loadSum;
+static uint8_t  sram[SRAM_SIZE] __attribute__((aligned(4)));
+static PsramDma *pDma;
+
+// The stores are volatile so the compiler keeps their width rather than making a memset of them
+
+static void Store8(uint8_t *pRegion, uint32_t uStride)
+{
+  volatile uint8_t *p = pRegion;
+  for(uint32_t i = 0; i < REGION_SIZE; i++)
+    p[i] = fillByte;
+}
+
+static void Store16(uint8_t *pRegion, uint32_t uStride)
+{
+  volatile uint16_t *p = (uint16_t *)pRegion;
+  const uint16_t uValue = fillByte * 0x0101u;
+  const uint32_t uStep = uStride / 2;
+
+  for(uint32_t uStart = 0; uStart < uStep; uStart++)
+  {
+    for(uint32_t i = uStart; i < REGION_SIZE / 2; i += uStep)
+      p[i] = uValue;
+  }
+}
+
+static void Store32(uint8_t *pRegion, uint32_t uStride)
+{
+  volatile uint32_t *p = (uint32_t *)pRegion;
+  const uint32_t uValue = fillByte * 0x01010101u;
+  for(uint32_t i = 0; i < REGION_SIZE / 4; i++)
+    p[i] = uValue;
+}
+
+static void Load32(uint8_t *pRegion, uint32_t uStride)
+{
+  volatile uint32_t *p = (uint32_t *)pRegion;
+  uint32_t uSum = 0;
+  for(uint32_t i = 0; i < REGION_SIZE / 4; i++)
+    uSum += p[i];
+  loadSum = uSum;
+}
+
+static void Load16(uint8_t *pRegion, uint32_t uStride)
+{
+  volatile uint16_t *p = (uint16_t *)pRegion;
+  const uint32_t uStep = uStride / 2;
+  uint32_t uSum = 0;
+
+  for(uint32_t uStart = 0; uStart < uStep; uStart++)
+  {
+    for(uint32_t i = uStart; i < REGION_SIZE / 2; i += uStep)
+      uSum += p[i];
+  }
+  loadSum = uSum;
+}
+
+static void Memset(uint8_t *pRegion, uint32_t uStride)
+{
+  memset(pRegion, fillByte, REGION_SIZE);
+}
+
+static void Copy32(uint8_t *pRegion, uint32_t uStride)
+{
+  volatile uint32_t *pDst = (uint32_t *)(pRegion + REGION_SIZE / 2);
+  volatile uint32_t *pSrc = (uint32_t *)pRegion;
+  for(uint32_t i = 0; i < REGION_SIZE / 8; i++)
+    pDst[i] = pSrc[i];
+}
+
+static void Memcpy(uint8_t *pRegion, uint32_t uStride)
+{
+  memcpy(pRegion + REGION_SIZE / 2, pRegion, REGION_SIZE / 2);
+}
+
+// The last SRAM block copied over the region is cut short
+static inline uint32_t GetBlockSize(uint32_t uOffset)
+{
+  return REGION_SIZE - uOffset < SRAM_SIZE ? REGION_SIZE - uOffset : SRAM_SIZE;
+}
+
+static void SramCopy(uint8_t *pRegion, uint32_t uStride)
+{
+  for(uint32_t uOffset = 0; uOffset < REGION_SIZE; uOffset += SRAM_SIZE)
+    memcpy(pRegion + uOffset, sram, GetBlockSize(uOffset));
+}
+
+static void DmaFill(uint8_t *pRegion, uint32_t uStride)
+{
+  pDma->Wait(pDma->Fill((uint16_t *)pRegion, fillByte * 0x0101u, FRAME_WIDTH, FRAME_HEIGHT));
+}
+
+static void DmaCopy(uint8_t *pRegion, uint32_t uStride)
+{
+  pDma->Wait(pDma->Copy((uint16_t *)(pRegion + REGION_SIZE / 2), (uint16_t *)pRegion, FRAME_WIDTH, FRAME_HEIGHT / 2));
+}
+
+static void DmaSramCopy(uint8_t *pRegion, uint32_t uStride)
+{
+  for(uint32_t uOffset = 0; uOffset < REGION_SIZE; uOffset += SRAM_SIZE)
+    pDma->Copy((uint16_t *)(pRegion + uOffset), (uint16_t *)sram, GetBlockSize(uOffset) / 2);
+  pDma->WaitAll();
+}
+
+static const Kernel kernels[] =
+{
+  {"store8",      Store8,      1,   checkFill, false},
+  {"store16",     Store16,     2,   checkFill, false},
+  {"store32",     Store32,     4,   checkFill, false},
+  {"store16/8",   Store16,     8,   checkFill, false},
+  {"store16/64",  Store16,     64,  checkFill, false},
+  {"store16/960", Store16,     960, checkFill, false},
+  {"load32",      Load32,      4,   checkSum,  false},
+  {"load16/960",  Load16,      960, checkSum,  false},
+  {"memset",      Memset,      1,   checkFill, false},
+  {"copy32",      Copy32,      4,   checkCopy, false},
+  {"memcpy",      Memcpy,      1,   checkCopy, false},
+  {"sram copy",   SramCopy,    1,   checkSram, false},
+  {"fill",        DmaFill,     2,   checkFill, true},
+  {"copy",        DmaCopy,     2,   checkCopy, true},
+  {"sram copy",   DmaSramCopy, 2,   checkSram, true},
+};
+
+static inline uint8_t CopyPattern(uint32_t i)
+{
+  return (uint8_t)(i * 7 + (i >> 8));
+}
+
+// Bytes the kernel stores, loads or copies
+static uint32_t GetBytes(const Kernel &kernel)
+{
+  return kernel.check == checkCopy ? REGION_SIZE / 2 : REGION_SIZE;
+}
+
+// Put the region in the state the kernel starts from, through the uncached view
+static void Prepare(const Kernel &kernel, const Region &region)
+{
+  uint8_t *p = region.Uncached();
+
+  if(kernel.check == checkCopy)
+  {
+    for(uint32_t i = 0; i < REGION_SIZE / 2; i++)
+      p[i] = CopyPattern(i);
+    memset(p + REGION_SIZE / 2, 0, REGION_SIZE / 2);
+  }
+  else if(kernel.check == checkSum)
+    memset(p, fillByte, REGION_SIZE);
+  else
+    memset(p, (uint8_t)~fillByte, REGION_SIZE);
+}
+
+static bool Verify(const Kernel &kernel, const Region &region)
+{
+  const uint8_t *p = region.Uncached();
+
+  switch(kernel.check)
+  {
+    case checkFill:
+      for(uint32_t i = 0; i < REGION_SIZE; i++)
+      {
+        if(p[i] != fillByte)
+          return false;
+      }
+      return true;
+
+    case checkSum:
+    {
+      // every 16 or 32 bit value loaded was all fillByte
+      uint32_t uLoads = kernel.fnRun == Load32 ? REGION_SIZE / 4 : REGION_SIZE / 2;
+      uint32_t uValue = kernel.fnRun == Load32 ? fillByte * 0x01010101u : fillByte * 0x0101u;
+      return loadSum == uLoads * uValue;
+    }
+
+    case checkCopy:
+      for(uint32_t i = 0; i < REGION_SIZE / 2; i++)
+      {
+        if(p[REGION_SIZE / 2 + i] != CopyPattern(i))
+          return false;
+      }
+      return true;
+
+    case checkSram:
+      for(uint32_t i = 0; i < REGION_SIZE; i++)
+      {
+        if(p[i] != sram[i % SRAM_SIZE])
+          return false;
+      }
+      return true;
+  }
+  return false;
+}
+
+// Best of RUN_COUNT runs through one view, false if any run left the wrong result
+static bool Run(const Kernel &kernel, const Region &region, bool bCached)
+{
+  uint64_t bestUs = UINT64_MAX;
+  bool bOk = true;
+
+  for(uint32_t uRun = 0; uRun < RUN_COUNT; uRun++)
+  {
+    fillByte = (uint8_t)(0x5a + uRun * 0x31);
+    loadSum = 0;
+    Prepare(kernel, region);
+    region.Invalidate();
+
+    uint64_t startTime = time_us_64();
+    kernel.fnRun(bCached ? region.Cached() : region.Uncached(), kernel.uStride);
+    if(bCached)
+      region.Clean();
+    uint64_t elapsedUs = time_us_64() - startTime;
+
+    if(elapsedUs < bestUs)
+      bestUs = elapsedUs;
+    bOk &= Verify(kernel, region);
+  }
+
+  printf("%s,%s,%u,%u,%.1f,%d\n", kernel.pName, kernel.bDma ? "dma" : bCached ? "cached" : "uncached",
+         (unsigned)GetBytes(kernel), (unsigned)bestUs, bestUs ? (float)GetBytes(kernel) / bestUs : 0.0f, bOk ? 1 : 0);
+  return bOk;
+}
+
+// The timing an earlier run saved, false if there is none
+static bool LoadTiming(PsramTiming &timing)
+{
+  FIL file;
+  if(f_open(&file, TIMING_FILE, FA_READ) != FR_OK)
+    return false;
+
+  UINT uBytes;
+  bool bOk = f_read(&file, &timing, sizeof(timing), &uBytes) == FR_OK && uBytes == sizeof(timing);
+  f_close(&file);
+  return bOk;
+}
+
+static bool SaveTiming(const PsramTiming &timing)
+{
+  FIL file;
+  if(f_open(&file, TIMING_FILE, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+    return false;
+
+  UINT uBytes;
+  bool bOk = f_write(&file, &timing, sizeof(timing), &uBytes) == FR_OK && uBytes == sizeof(timing);
+  f_close(&file);
+  return bOk;
+}
+
+int main()
+{
+  // run as 266mhz, twice the speed of the Psram
+  set_sys_clock_khz(266000, true);
+  stdio_init_all();
+
+  // the saved timing has to be set before the first getInstance(), which retests it
+  FATFS fs;
+  bool bCard = f_mount(&fs, "", 1) == FR_OK;
+  PsramTiming saved = {};
+  if(bCard && LoadTiming(saved))
+    PicoPlusPsram::SetSavedTiming(saved);
+
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  const PsramTiming &timing = ps.GetTiming();
+  printf("psram %u MHz, clkdiv=%u rxdelay=%u max_select=%u min_deselect=%u, %s\n",
+         (unsigned)(timing.GetPsramHz() / 1000000), timing.uClkDiv, timing.uRxDelay, timing.uMaxSelect,
+         timing.uMinDeselect, ps.IsCalibrated() ? "calibrated" : "default");
+
+  // save a new calibration, not the one just read back
+  if(bCard && ps.IsCalibrated() && memcmp(&saved, &timing, sizeof(timing)) != 0 && !SaveTiming(timing))
+    printf("Cannot save the psram timing to %s\n", TIMING_FILE);
+  Region region = ps.Allocate<uint8_t>(REGION_SIZE);
+  if(!region.IsValid())
+  {
+    printf("Cannot allocate %u bytes of psram\n", REGION_SIZE);
+    return 1;
+  }
+
+  for(uint32_t i = 0; i < SRAM_SIZE; i++)
+    sram[i] = (uint8_t)(i ^ (i >> 7));
+
+  PsramDma dma;
+  pDma = &dma;
+
+  while(true)
+  {
+    uint32_t uFailures = 0;
+
+    printf("kernel,view,bytes,us,mbps,ok\n");
+    for(const Kernel &kernel : kernels)
+    {
+      // the DMA goes to psram around the cache
+      if(kernel.bDma)
+        uFailures += !Run(kernel, region, false);
+      else
+      {
+        uFailures += !Run(kernel, region, false);
+        uFailures += !Run(kernel, region, true);
+      }
+    }
+    printf("\n");
+
+#if PRESTO_HOST
+    return uFailures ? 1 : 0;
+#endif
+    sleep_ms(5000);
+  }
+}
@@ -0,0 +1,176 @@
+// ******************************************************************************
+// This benchmark compares drawing into a 480x480 RGB565 frame in PSRAM through
+// the cached and the uncached views of a PicoPlusPsram::Buffer.
+//
+// Each test is run through the uncached view, the way the examples draw, and
+// through the cached view followed by the Clean() the display needs before it
+// reads the frame. The cached view starts with nothing of the frame in the XIP
+// cache, and the time to clean is included.
+//
+//   fill     - every pixel written once
+//   blend    - every pixel blended 50% with a colour, cleaned a band at a time
+//              as a strip renderer would before the band is shown
+//   scatter  - single pixels written all over the frame
+//   tile     - a 32x32 sprite read over and over
+//
+// The throughput is of the pixel bytes read or written. The frame is summed
+// through the uncached view afterwards, what the display would see, and the
+// sum must be the same for both views. A test whose sums differ, say because
+// a Clean() missed part of the frame, is printed as a FAIL line and the host
+// build exits with 1.
+//
+// Results are logged to the USB UART every 5 seconds.
+// ******************************************************************************
+
+#include "pico/stdlib.h"
+
+#include "PicoPlusPsram.h"
+
+#define FRAME_WIDTH   480
+#define FRAME_HEIGHT  480
+#define BAND_HEIGHT   16
+#define SCATTER_COUNT 50000
+#define TILE_SIZE     32
+#define TILE_REPEATS  64
+
+typedef PicoPlusPsram::Buffer<uint16_t> Frame;
+
+// Small deterministic generator so both views see the same sequence
+static uint32_t randState;
+
+static uint32_t NextRand(void)
+{
+  randState ^= randState << 13;
+  randState ^= randState >> 17;
+  randState ^= randState << 5;
+  return randState;
+}
+
+// 50% blend of two byte swapped RGB565 pixels
+static inline uint16_t Blend(uint16_t uA, uint16_t uB)
+{
+  uA = __builtin_bswap16(uA);
+  uB = __builtin_bswap16(uB);
+  return __builtin_bswap16(((uA & 0xf7de) >> 1) + ((uB & 0xf7de) >> 1));
+}
+
+static void Fill(const Frame &frame, uint16_t *pPixels, bool bCached)
+{
+  for(uint32_t i = 0; i < frame.GetCount(); i++)
+    pPixels[i] = (uint16_t)i;
+
+  if(bCached)
+    frame.Clean();
+}
+
+static void BlendFrame(const Frame &frame, uint16_t *pPixels, bool bCached)
+{
+  for(uint32_t y = 0; y < FRAME_HEIGHT; y += BAND_HEIGHT)
+  {
+    uint16_t *pBand = pPixels + y * FRAME_WIDTH;
+    for(uint32_t i = 0; i < BAND_HEIGHT * FRAME_WIDTH; i++)
+      pBand[i] = Blend(pBand[i], 0x1f00);
+
+    if(bCached)
+      frame.Clean(y * FRAME_WIDTH, BAND_HEIGHT * FRAME_WIDTH);
+  }
+}
+
+static void Scatter(const Frame &frame, uint16_t *pPixels, bool bCached)
+{
+  randState = 0x12345678;
+  for(uint32_t i = 0; i < SCATTER_COUNT; i++)
+    pPixels[NextRand() % frame.GetCount()] = 0xffff;
+
+  if(bCached)
+    frame.Clean();
+}
+
+static uint32_t tileSum;
+
+static void ReadTile(const Frame &frame, uint16_t *pPixels, bool bCached)
+{
+  uint32_t uSum = 0;
+  for(uint32_t uRepeat = 0; uRepeat < TILE_REPEATS; uRepeat++)
+  {
+    for(uint32_t y = 0; y < TILE_SIZE; y++)
+    {
+      const uint16_t *pRow = pPixels + y * FRAME_WIDTH;
+      for(uint32_t x = 0; x < TILE_SIZE; x++)
+        uSum += pRow[x];
+    }
+  }
+  tileSum = uSum;
+}
+
+// Time fnTest through one view, uBytes is how many pixel bytes it reads or writes, returns
+// the sum of the frame the display would see
+static uint32_t Run(const char *pName, const Frame &frame, bool bCached, uint32_t uBytes,
+                void (*fnTest)(const Frame &frame, uint16_t *pPixels, bool bCached))
+{
+  // start from the same frame with none of it cached
+  for(uint32_t i = 0; i < frame.GetCount(); i++)
+    frame.Uncached()[i] = (uint16_t)(i * 7);
+  frame.Invalidate();
+  tileSum = 0;
+
+  uint64_t startTime = time_us_64();
+  fnTest(frame, bCached ? frame.Cached() : frame.Uncached(), bCached);
+  uint64_t elapsedUs = time_us_64() - startTime;
+
+  uint32_t uSum = tileSum;
+  for(uint32_t i = 0; i < frame.GetCount(); i++)
+    uSum += frame.Uncached()[i];
+
+  printf("%-8s %-8s %8.1f MB/s %8u us  sum=%08x\n", pName, bCached ? "cached" : "uncached",
+         elapsedUs ? (float)uBytes / elapsedUs : 0.0f, (unsigned)elapsedUs, (unsigned)uSum);
+  return uSum;
+}
+
+int main()
+{
+  // run as 266mhz, twice the speed of the Psram
+  set_sys_clock_khz(266000, true);
+  stdio_init_all();
+
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  Frame frame = ps.Allocate<uint16_t>(FRAME_WIDTH * FRAME_HEIGHT);
+  if(!frame.IsValid())
+  {
+    printf("Cannot allocate a frame in psram\n");
+    return 1;
+  }
+
+  const uint32_t uFrameBytes = frame.GetSizeBytes();
+
+  const char *testNames[] = {"fill", "blend", "scatter", "tile"};
+  uint32_t uFailures = 0;
+
+  while(true)
+  {
+    uint32_t sums[2][4];
+    for(int iCached = 0; iCached < 2; iCached++)
+    {
+      sums[iCached][0] = Run(testNames[0], frame, iCached, uFrameBytes, Fill);
+      sums[iCached][1] = Run(testNames[1], frame, iCached, uFrameBytes * 2, BlendFrame);
+      sums[iCached][2] = Run(testNames[2], frame, iCached, SCATTER_COUNT * 2, Scatter);
+      sums[iCached][3] = Run(testNames[3], frame, iCached, TILE_SIZE * TILE_SIZE * TILE_REPEATS * 2, ReadTile);
+    }
+
+    for(uint32_t i = 0; i < 4; i++)
+    {
+      if(sums[0][i] != sums[1][i])
+      {
+        printf("FAIL %s cached sum=%08x, uncached sum=%08x\n", testNames[i], (unsigned)sums[1][i], (unsigned)sums[0][i]);
+        uFailures++;
+      }
+    }
+    printf("\n");
+
+#if PRESTO_HOST
+    printf("%u failures\n", (unsigned)uFailures);
+    return uFailures ? 1 : 0;
+#endif
+    sleep_ms(5000);
+  }
+}
@@ -0,0 +1,174 @@
+#include <assert.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#include "PsramDma.h"
+
+// Engines by DMA channel, for the shared irq handler
+static PsramDma *engines[NUM_DMA_CHANNELS];
+
+PsramDma::PsramDma(uint16_t uQueueSize)
+{
+  assert(uQueueSize != 0 && (uQueueSize & (uQueueSize - 1)) == 0);
+
+  m_pOps = new Op[uQueueSize];
+  m_uQueueMask = uQueueSize - 1;
+  m_pBlocks = new ControlBlock[c_uMaxChainRows];
+
+  m_iChannel = dma_claim_unused_channel(true);
+  m_iControlChannel = dma_claim_unused_channel(true);
+  engines[m_iChannel] = this;
+
+  // DMA_IRQ_1 so we stay out of the way of the display driver
+  bool bFirst = true;
+  for(uint i = 0; i < NUM_DMA_CHANNELS; i++)
+    bFirst &= (engines[i] == nullptr || engines[i] == this);
+
+  if(bFirst)
+  {
+    irq_add_shared_handler(DMA_IRQ_1, IrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+  }
+
+  dma_channel_set_irq1_enabled(m_iChannel, true);
+}
+
+PsramDma::~PsramDma(void)
+{
+  WaitAll();
+
+  dma_channel_set_irq1_enabled(m_iChannel, false);
+  engines[m_iChannel] = nullptr;
+
+  bool bLast = true;
+  for(uint i = 0; i < NUM_DMA_CHANNELS; i++)
+    bLast &= engines[i] == nullptr;
+
+  if(bLast)
+    irq_remove_handler(DMA_IRQ_1, IrqHandler);
+
+  dma_channel_unclaim(m_iControlChannel);
+  dma_channel_unclaim(m_iChannel);
+  delete[] m_pBlocks;
+  delete[] m_pOps;
+}
+
+void __not_in_flash_func(PsramDma::IrqHandler)(void)
+{
+  for(uint i = 0; i < NUM_DMA_CHANNELS; i++)
+  {
+    if(engines[i] && dma_channel_get_irq1_status(i))
+    {
+      dma_channel_acknowledge_irq1(i);
+      engines[i]->ChainComplete();
+    }
+  }
+}
+
+PsramDma::Fence PsramDma::Fill(uint16_t *pDst, uint16_t uValue, uint32_t w, uint32_t h, uint32_t uStride)
+{
+  Op op = {pDst, nullptr, uValue | ((uint32_t)uValue << 16), w, h, uStride ? uStride : w, 0, 0};
+  return Queue(op);
+}
+
+PsramDma::Fence PsramDma::Copy(uint16_t *pDst, const uint16_t *pSrc, uint32_t w, uint32_t h, uint32_t uDstStride, uint32_t uSrcStride)
+{
+  Op op = {pDst, pSrc, 0, w, h, uDstStride ? uDstStride : w, uSrcStride ? uSrcStride : w, 0};
+  return Queue(op);
+}
+
+PsramDma::Fence PsramDma::Queue(const Op &op)
+{
+  if(op.w == 0 || op.h == 0)
+    return m_uTail;
+
+  // wait for space in the queue
+  while(m_uTail - m_uHead > m_uQueueMask)
+    tight_loop_contents();
+
+  Op &queued = m_pOps[m_uTail & m_uQueueMask];
+  queued = op;
+
+  // packed rows go as a single transfer
+  if(queued.uDstStride == queued.w && (!queued.pSrc || queued.uSrcStride == queued.w))
+  {
+    queued.w *= queued.h;
+    queued.h = 1;
+  }
+
+  uint32_t intr_stash = save_and_disable_interrupts();
+
+  Fence fence = ++m_uTail;
+  if(!m_bBusy)
+  {
+    m_bBusy = true;
+    StartChain();
+  }
+
+  restore_interrupts(intr_stash);
+  return fence;
+}
+
+// Write a control block for each row of the next chain and start the control channel,
+// each row chains back to it to load the next and the last row raises the interrupt
+void __not_in_flash_func(PsramDma::StartChain)(void)
+{
+  static_assert(sizeof(ControlBlock) == 16, "a control block is the four alias 3 registers");
+
+  const Op &op = m_pOps[m_uHead & m_uQueueMask];
+
+  m_uChainRows = op.h - op.uRow;
+  if(m_uChainRows > c_uMaxChainRows)
+    m_uChainRows = c_uMaxChainRows;
+
+  for(uint32_t i = 0; i < m_uChainRows; i++)
+  {
+    uint32_t uRow = op.uRow + i;
+    uint16_t *pDst = op.pDst + uRow * op.uDstStride;
+    const void *pSrc = op.pSrc ? (const void *)(op.pSrc + uRow * op.uSrcStride) : (const void *)&op.uFillWord;
+
+    bool bWords = ((uintptr_t)pDst & 3) == 0 && ((uintptr_t)pSrc & 3) == 0 && (op.w & 1) == 0;
+    bool bLast = i == m_uChainRows - 1;
+
+    dma_channel_config c = dma_channel_get_default_config(m_iChannel);
+    channel_config_set_transfer_data_size(&c, bWords ? DMA_SIZE_32 : DMA_SIZE_16);
+    channel_config_set_read_increment(&c, op.pSrc != nullptr);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_chain_to(&c, bLast ? m_iChannel : m_iControlChannel);
+    channel_config_set_irq_quiet(&c, !bLast);
+
+    m_pBlocks[i] = {channel_config_get_ctrl_value(&c), pDst, bWords ? op.w / 2 : op.w, pSrc};
+  }
+
+  // the control channel writes one block per trigger, wrapping on the data channel's
+  // four alias 3 registers, and is left pointing at the next block
+  dma_channel_config c = dma_channel_get_default_config(m_iControlChannel);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, true);
+  channel_config_set_ring(&c, true, 4);
+
+  __dmb();
+  dma_channel_configure(m_iControlChannel, &c, &dma_hw->ch[m_iChannel].al3_ctrl, m_pBlocks, sizeof(ControlBlock) / 4, true);
+}
+
+void __not_in_flash_func(PsramDma::ChainComplete)(void)
+{
+  Op &op = m_pOps[m_uHead & m_uQueueMask];
+
+  op.uRow += m_uChainRows;
+  if(op.uRow < op.h)
+  {
+    StartChain();
+    return;
+  }
+
+  m_uHead = m_uHead + 1;
+  if(m_uHead != m_uTail)
+    StartChain();
+  else
+    m_bBusy = false;
+}
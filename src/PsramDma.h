@@ -0,0 +1,98 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// PsramDma
+//  Queues fills and copies of 16 bit pixels over psram (or any memory) on a DMA channel,
+//  so the CPU can carry on while a back buffer is cleared or synced.
+//
+//  Each operation is a w x h rectangle with rows uStride pixels apart, a stride of
+//  0 means the rows are packed. Operations run in the order they are queued and
+//  return a fence, waiting on a fence also waits on everything queued before it.
+//  Rows that are word aligned with an even width are moved 32 bits at a time.
+//
+//  The rows of an operation are written as control blocks that a second channel loads
+//  into the data channel one after another, so only the last row of a chain raises an
+//  interrupt. That is one interrupt per operation of up to c_uMaxChainRows rows.
+class PsramDma
+{
+public:
+  typedef uint32_t Fence;
+
+  // uQueueSize must be a power of two, queueing into a full queue waits for space
+  PsramDma(uint16_t uQueueSize = 256);
+  ~PsramDma(void);
+
+  PsramDma(const PsramDma&) = delete;
+  PsramDma& operator = (const PsramDma&) = delete;
+
+  // Fill a rectangle with uValue
+  Fence Fill(uint16_t *pDst, uint16_t uValue, uint32_t w, uint32_t h = 1, uint32_t uStride = 0);
+
+  // Copy a rectangle
+  Fence Copy(uint16_t *pDst, const uint16_t *pSrc, uint32_t w, uint32_t h = 1, uint32_t uDstStride = 0, uint32_t uSrcStride = 0);
+
+  // Fence of the last operation queued
+  Fence GetLastFence(void) const
+  {
+    return m_uTail;
+  }
+
+  bool IsComplete(Fence fence) const
+  {
+    return (int32_t)(m_uHead - fence) >= 0;
+  }
+
+  void Wait(Fence fence)
+  {
+    while(!IsComplete(fence))
+      tight_loop_contents();
+  }
+
+  void WaitAll(void)
+  {
+    Wait(m_uTail);
+  }
+
+  // Rows moved per interrupt
+  static const uint32_t c_uMaxChainRows = 64;
+
+private:
+  struct Op
+  {
+    uint16_t       *pDst;
+    const uint16_t *pSrc;       // nullptr for a fill
+    uint32_t       uFillWord;   // fill value in both halves, read by the DMA
+    uint32_t       w;
+    uint32_t       h;
+    uint32_t       uDstStride;
+    uint32_t       uSrcStride;
+    uint32_t       uRow;
+  };
+
+  // Data channel registers written by the control channel for each row, in the order
+  // of the channel's third register alias so that writing uReadAddr starts the row
+  struct ControlBlock
+  {
+    uint32_t   uCtrl;
+    uint16_t   *pWrite;
+    uint32_t   uCount;
+    const void *pRead;
+  };
+
+  Fence Queue(const Op &op);
+  void StartChain(void);
+  void ChainComplete(void);
+
+  static void IrqHandler(void);
+
+  Op                *m_pOps;
+  uint16_t          m_uQueueMask;
+  int               m_iChannel = -1;
+  int               m_iControlChannel = -1;
+  uint32_t          m_uChainRows = 0;          // rows in the chain running
+  ControlBlock      *m_pBlocks;
+  volatile uint32_t m_uHead = 0;  // operations completed
+  volatile uint32_t m_uTail = 0;  // operations queued
+  volatile bool     m_bBusy = false;
+};
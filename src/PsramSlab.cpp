@@ -0,0 +1,162 @@
+#include "pico/stdlib.h"
+
+#include "PsramSlab.h"
+
+// Private constructor
+PsramSlab::PsramSlab(void)
+{
+  for(uint8_t uClass = 0; uClass < c_uClassCount; uClass++)
+    m_partial[uClass] = c_uNoPage;
+
+  // take the slab region from lwmem, everything falls back to lwmem if it is not available
+  PsramTrace::Scope tag("slab");
+  m_pBase = (uint8_t *)PicoPlusPsram::getInstance().Malloc(c_uPageCount * c_uPageSize);
+
+  if(m_pBase)
+  {
+    for(uint16_t uPage = c_uPageCount; uPage > 0; uPage--)
+      Push(m_uFreePages, uPage - 1);
+  }
+}
+
+void PsramSlab::Unlink(uint16_t &uHead, uint16_t uPage)
+{
+  Page &page = m_pages[uPage];
+
+  if(page.uPrev != c_uNoPage)
+    m_pages[page.uPrev].uNext = page.uNext;
+  else
+    uHead = page.uNext;
+
+  if(page.uNext != c_uNoPage)
+    m_pages[page.uNext].uPrev = page.uPrev;
+}
+
+void PsramSlab::Push(uint16_t &uHead, uint16_t uPage)
+{
+  Page &page = m_pages[uPage];
+
+  page.uPrev = c_uNoPage;
+  page.uNext = uHead;
+  if(uHead != c_uNoPage)
+    m_pages[uHead].uPrev = uPage;
+  uHead = uPage;
+}
+
+// Assign an unused page to a size class, all slots start free
+uint16_t PsramSlab::NewPage(uint8_t uClass)
+{
+  uint16_t uPage = m_uFreePages;
+
+  if(uPage == c_uNoPage)
+    return c_uNoPage;
+
+  Unlink(m_uFreePages, uPage);
+
+  Page &page = m_pages[uPage];
+  uint16_t uSlots = SlotCount(uClass);
+
+  page.uClass = uClass;
+  page.uFreeCount = uSlots;
+  for(uint16_t i = 0; i < c_uBitWords; i++)
+  {
+    if(uSlots >= 32)
+      page.freeBits[i] = 0xffffffff;
+    else
+      page.freeBits[i] = (1u << uSlots) - 1;
+    uSlots -= uSlots >= 32 ? 32 : uSlots;
+  }
+
+  Push(m_partial[uClass], uPage);
+  m_uPagesInUse++;
+  return uPage;
+}
+
+void *PsramSlab::Malloc(size_t uSize)
+{
+  // find the size class, the smallest power of two that fits
+  uint8_t uClass = 0;
+  while(uClass < c_uClassCount && uSize > (1u << (uClass + c_uMinShift)))
+    uClass++;
+
+  if(uClass < c_uClassCount)
+  {
+    uint16_t uPage = m_partial[uClass];
+    if(uPage == c_uNoPage)
+      uPage = NewPage(uClass);
+
+    if(uPage != c_uNoPage)
+    {
+      Page &page = m_pages[uPage];
+
+      uint16_t uWord = 0;
+      while(page.freeBits[uWord] == 0)
+        uWord++;
+
+      uint8_t uBit = __builtin_ctz(page.freeBits[uWord]);
+      page.freeBits[uWord] &= ~(1u << uBit);
+
+      if(--page.uFreeCount == 0)
+        Unlink(m_partial[uClass], uPage);
+
+      m_uUsedBytes += 1u << (uClass + c_uMinShift);
+
+      uint32_t uSlot = uWord * 32 + uBit;
+      return m_pBase + uPage * c_uPageSize + (uSlot << (uClass + c_uMinShift));
+    }
+  }
+
+  m_uFallbackCount++;
+  return PicoPlusPsram::getInstance().Malloc(uSize);
+}
+
+void PsramSlab::Free(void * const pMem)
+{
+  uint8_t *p = (uint8_t *)pMem;
+
+  if(!m_pBase || p < m_pBase || p >= m_pBase + c_uPageCount * c_uPageSize)
+  {
+    PicoPlusPsram::getInstance().Free(pMem);
+    return;
+  }
+
+  size_t   uOffset = p - m_pBase;
+  uint16_t uPage   = uOffset / c_uPageSize;
+  Page     &page   = m_pages[uPage];
+  uint32_t uSlot   = (uOffset % c_uPageSize) >> (page.uClass + c_uMinShift);
+
+  page.freeBits[uSlot / 32] |= 1u << (uSlot % 32);
+  m_uUsedBytes -= 1u << (page.uClass + c_uMinShift);
+
+  if(page.uFreeCount++ == 0)
+    Push(m_partial[page.uClass], uPage);
+
+  // hand empty pages back for any class, but keep the head page so a class does not thrash
+  if(page.uFreeCount == SlotCount(page.uClass) && m_partial[page.uClass] != uPage)
+  {
+    Unlink(m_partial[page.uClass], uPage);
+    Push(m_uFreePages, uPage);
+    m_uPagesInUse--;
+  }
+}
+
+size_t PsramSlab::GetSize(void *pMem)
+{
+  uint8_t *p = (uint8_t *)pMem;
+
+  if(!m_pBase || p < m_pBase || p >= m_pBase + c_uPageCount * c_uPageSize)
+    return PicoPlusPsram::getInstance().GetSize(pMem);
+
+  return 1u << (m_pages[(p - m_pBase) / c_uPageSize].uClass + c_uMinShift);
+}
+
+PsramSlab::Stats PsramSlab::GetStats(void) const
+{
+  Stats stats;
+
+  stats.uSlabBytes     = m_pBase ? c_uPageCount * c_uPageSize : 0;
+  stats.uUsedBytes     = m_uUsedBytes;
+  stats.uPagesInUse    = m_uPagesInUse;
+  stats.uFallbackCount = m_uFallbackCount;
+  return stats;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "PicoPlusPsram.h"
+
+// Size of the psram region split into slab pages
+#ifndef PSRAM_SLAB_SIZE
+#define PSRAM_SLAB_SIZE (256 * 1024)
+#endif
+
+// PsramSlab
+//  Size class allocator for small psram objects, layered over PicoPlusPsram.
+//
+//  On first use PSRAM_SLAB_SIZE bytes are taken from lwmem and split into pages,
+//  each page holds objects of one power of two size class from 16 to 512 bytes.
+//  The page lists and free bitmaps are kept in SRAM so allocating and freeing is
+//  a bit scan and never walks lwmem's free list or touches psram. Larger
+//  allocations, and any made once the slab pages run out, go straight to lwmem.
+class PsramSlab
+{
+public:
+  // BaseClass
+  //  Inherit from this instead of PicoPlusPsram::BaseClass to allocate dynamic objects from the slab
+  class BaseClass
+  {
+  public:
+    BaseClass(void) = default;
+    ~BaseClass(void) = default;
+
+    void *operator new(size_t size)
+    {
+      return PsramSlab::getInstance().Malloc(size);
+    }
+
+    void operator delete(void *ptr)
+    {
+      PsramSlab::getInstance().Free(ptr);
+    }
+  };
+
+  // Allocator
+  //  Use instead of PicoPlusPsram::Allocator to allocate from the slab
+  template<class T>
+  struct Allocator
+  {
+      typedef T value_type;
+
+      Allocator() = default;
+
+      template<class U>
+      constexpr Allocator(const Allocator <U>&) noexcept {}
+
+      [[nodiscard]] T* allocate(std::size_t n)
+      {
+          return static_cast<T*>(PsramSlab::getInstance().Malloc(n * sizeof(T)));
+      }
+
+      void deallocate(T* p, std::size_t n) noexcept
+      {
+          PsramSlab::getInstance().Free(p);
+      }
+      bool operator==(const Allocator <T>&) { return true;}
+      bool operator!=(const Allocator <T>&) { return false;}
+  };
+
+  struct Stats
+  {
+    size_t   uSlabBytes;      // size of the slab region
+    size_t   uUsedBytes;      // bytes handed out from slab pages, rounded up to the size class
+    uint16_t uPagesInUse;     // pages assigned to a size class
+    uint32_t uFallbackCount;  // allocations passed to lwmem
+  };
+
+  // No public access to constructor/destructor
+  PsramSlab(const PsramSlab&) = delete;
+  PsramSlab& operator = (const PsramSlab&) = delete;
+
+  // Get singleton instance
+  static PsramSlab& getInstance()
+  {
+    static PsramSlab instance;
+    return instance;
+  }
+
+  // Malloc psram memory
+  void *Malloc(size_t uSize);
+
+  // Free psram memory from Malloc
+  void Free(void * const pMem);
+
+  // Get the usable size of an allocated block
+  size_t GetSize(void *pMem);
+
+  Stats GetStats(void) const;
+
+private:
+  PsramSlab(void);
+  ~PsramSlab(void) = default;
+
+  static const size_t   c_uPageSize   = 4096;
+  static const uint8_t  c_uMinShift   = 4;    // 16 byte objects
+  static const uint8_t  c_uClassCount = 6;    // up to 512 byte objects
+  static const uint16_t c_uPageCount  = PSRAM_SLAB_SIZE / c_uPageSize;
+  static const uint16_t c_uNoPage     = 0xffff;
+  static const uint16_t c_uBitWords   = c_uPageSize / (1 << c_uMinShift) / 32;
+
+  struct Page
+  {
+    uint16_t uPrev;
+    uint16_t uNext;
+    uint8_t  uClass;
+    uint16_t uFreeCount;
+    uint32_t freeBits[c_uBitWords];
+  };
+
+  static uint16_t SlotCount(uint8_t uClass)
+  {
+    return c_uPageSize >> (uClass + c_uMinShift);
+  }
+
+  void Unlink(uint16_t &uHead, uint16_t uPage);
+  void Push(uint16_t &uHead, uint16_t uPage);
+  uint16_t NewPage(uint8_t uClass);
+
+  uint8_t  *m_pBase = nullptr;
+  uint16_t m_uFreePages = c_uNoPage;          // pages not assigned to a size class
+  uint16_t m_partial[c_uClassCount];          // per class, pages with a free slot
+  Page     m_pages[c_uPageCount];
+  size_t   m_uUsedBytes = 0;
+  uint16_t m_uPagesInUse = 0;
+  uint32_t m_uFallbackCount = 0;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+
+// PsramTiming
+//  The QMI M1 timing for the APS6404 psram at a given system clock. This only works the
+//  numbers out, PicoPlusPsram writes them to the QMI, so it builds and can be checked on the
+//  host as well.
+//
+//  Default() is the timing PicoPlusPsram has always used, a divisor keeping the psram clock
+//  within its 133MHz rating and an rx delay that is safe at any clock. Calibration tries
+//  smaller divisors and rx delays and keeps the fastest that reads back correctly, Make()
+//  fills in the select limits for each one it tries.
+//
+//  A calibrated timing can be saved, it is plain data, and given back with
+//  PicoPlusPsram::SetSavedTiming() before the first getInstance() to skip the sweep.
+struct PsramTiming
+{
+  static const uint32_t c_uMagic = 0x54535350;  // "PSST"
+  static const uint8_t  c_uMaxRxDelay = 7;      // the QMI rxdelay field is 3 bits
+
+  uint32_t uMagic;
+  uint32_t uSysClockHz;    // the timing only holds at this system clock
+  uint8_t  uClkDiv;        // psram clock is the system clock divided by this
+  uint8_t  uRxDelay;       // half system clocks after the clock edge to sample read data
+  uint8_t  uMaxSelect;     // chip select held for at most this many 64 system clocks
+  uint8_t  uMinDeselect;   // chip select released for at least this many system clocks
+
+  uint32_t GetPsramHz(void) const
+  {
+    return uSysClockHz / uClkDiv;
+  }
+
+  // Made for this system clock, and not garbage read back from wherever it was saved
+  bool IsValidFor(uint32_t uClockHz) const
+  {
+    return uMagic == c_uMagic && uSysClockHz == uClockHz && uClkDiv != 0 && uRxDelay <= c_uMaxRxDelay;
+  }
+
+  // Timing with the given divisor and rx delay
+  //  - Max select must be <= 8us, the value is in multiples of 64 system clocks.
+  //  - Min deselect must be >= 18ns, the value is in system clocks - ceil(divisor / 2).
+  static PsramTiming Make(uint32_t uSysClockHz, uint8_t uClkDiv, uint8_t uRxDelay)
+  {
+    const int64_t clock_period_fs = 1000000000000000ll / uSysClockHz;
+    int64_t max_select = (125 * 1000000) / clock_period_fs;  // 125 = 8000ns / 64
+    int64_t min_deselect = (18 * 1000000 + (clock_period_fs - 1)) / clock_period_fs - (uClkDiv + 1) / 2;
+
+    PsramTiming timing;
+    timing.uMagic = c_uMagic;
+    timing.uSysClockHz = uSysClockHz;
+    timing.uClkDiv = uClkDiv;
+    timing.uRxDelay = uRxDelay;
+    timing.uMaxSelect = max_select > 63 ? 63 : (uint8_t)max_select;
+    timing.uMinDeselect = min_deselect < 0 ? 0 : (min_deselect > 31 ? 31 : (uint8_t)min_deselect);
+    return timing;
+  }
+
+  // Timing for the APS6404 rated at uMaxPsramHz
+  //
+  // Using an rxdelay equal to the divisor isn't enough when running the APS6404 close to 133MHz.
+  // So: don't allow running at divisor 1 above 100MHz (because delay of 2 would be too late),
+  // and add an extra 1 to the rxdelay if the divided clock is > 100MHz (i.e. sys clock > 200MHz).
+  static PsramTiming Default(uint32_t uSysClockHz, uint32_t uMaxPsramHz = 133000000)
+  {
+    uint32_t divisor = (uSysClockHz + uMaxPsramHz - 1) / uMaxPsramHz;
+    if(divisor == 1 && uSysClockHz > 100000000)
+      divisor = 2;
+
+    uint32_t rxdelay = divisor;
+    if(uSysClockHz / divisor > 100000000)
+      rxdelay += 1;
+
+    return Make(uSysClockHz, divisor, rxdelay > c_uMaxRxDelay ? c_uMaxRxDelay : rxdelay);
+  }
+
+  // Given a bit per rx delay that read back correctly, the delay in the middle of the longest
+  // run of them, furthest from the edges where reads start to fail. -1 if none passed.
+  static int8_t PickRxDelay(uint8_t uPassMask)
+  {
+    int8_t iBestStart = -1;
+    uint8_t uBestLength = 0;
+
+    for(uint8_t uStart = 0; uStart <= c_uMaxRxDelay; uStart++)
+    {
+      uint8_t uLength = 0;
+      while(uStart + uLength <= c_uMaxRxDelay && (uPassMask & (1u << (uStart + uLength))))
+        uLength++;
+
+      if(uLength > uBestLength)
+      {
+        iBestStart = uStart;
+        uBestLength = uLength;
+      }
+    }
+
+    return iBestStart < 0 ? -1 : iBestStart + (uBestLength - 1) / 2;
+  }
+};
@@ -0,0 +1,125 @@
+// ******************************************************************************
+// This host tool checks the PsramTiming math, which is kept free of the SDK so
+// it can be tested without a Presto:
+//
+//   Default()     - against the formula PicoPlusPsram::Init() used before
+//                   calibration, for every system clock from 10 to 400MHz
+//   Make()        - the select limits are clamped to the QMI field widths
+//   PickRxDelay() - on empty, full, single bit and split pass masks
+//
+// Each failed check is printed, and the process exits with 1 if any failed.
+// ******************************************************************************
+
+#include <cstdio>
+
+#include "PsramTiming.h"
+
+static uint32_t uFailures = 0;
+
+static void Check(bool bOk, const char *pWhat, uint32_t uValue, uint32_t uExpected)
+{
+  if(bOk)
+    return;
+
+  printf("FAIL %s: got %u expected %u\n", pWhat, (unsigned)uValue, (unsigned)uExpected);
+  uFailures++;
+}
+
+static void CheckEqual(const char *pWhat, int32_t iValue, int32_t iExpected)
+{
+  Check(iValue == iExpected, pWhat, (uint32_t)iValue, (uint32_t)iExpected);
+}
+
+// The timing PicoPlusPsram::Init() wrote to QMI M1 before PsramTiming
+static void OldInit(uint32_t clock_hz, int &divisor, int &rxdelay, int &max_select, int &min_deselect)
+{
+  const int max_psram_freq = 133000000;
+
+  divisor = (clock_hz + max_psram_freq - 1) / max_psram_freq;
+  if (divisor == 1 && clock_hz > 100000000) {
+      divisor = 2;
+  }
+  rxdelay = divisor;
+  if (clock_hz / divisor > 100000000) {
+      rxdelay += 1;
+  }
+
+  const int64_t clock_period_fs = 1000000000000000ll / clock_hz;
+  max_select = (125 * 1000000) / clock_period_fs;
+  min_deselect = (18 * 1000000 + (clock_period_fs - 1)) / clock_period_fs - (divisor + 1) / 2;
+}
+
+static void TestDefault(void)
+{
+  for(uint32_t uClockHz = 10000000; uClockHz <= 400000000; uClockHz += 250000)
+  {
+    int divisor, rxdelay, max_select, min_deselect;
+    OldInit(uClockHz, divisor, rxdelay, max_select, min_deselect);
+
+    PsramTiming timing = PsramTiming::Default(uClockHz);
+    uint32_t uFailuresBefore = uFailures;
+    CheckEqual("Default divisor", timing.uClkDiv, divisor);
+    CheckEqual("Default rxdelay", timing.uRxDelay, rxdelay);
+    CheckEqual("Default max select", timing.uMaxSelect, max_select);
+    CheckEqual("Default min deselect", timing.uMinDeselect, min_deselect);
+    Check(timing.IsValidFor(uClockHz), "Default valid", 0, 1);
+    Check(!timing.IsValidFor(uClockHz + 1), "Default valid at another clock", 1, 0);
+
+    if(uFailures != uFailuresBefore)
+      printf("  at %u Hz\n", (unsigned)uClockHz);
+  }
+}
+
+static void TestMake(void)
+{
+  // 18ns at 1MHz is one clock, less half of the divisor goes negative
+  PsramTiming timing = PsramTiming::Make(1000000, 4, 0);
+  CheckEqual("Make min deselect clamped to 0", timing.uMinDeselect, 0);
+
+  // 8us is more than 63 lots of 64 clocks above 504MHz
+  timing = PsramTiming::Make(600000000, 5, 6);
+  CheckEqual("Make max select clamped to 63", timing.uMaxSelect, 63);
+  CheckEqual("Make divisor", timing.uClkDiv, 5);
+  CheckEqual("Make rxdelay", timing.uRxDelay, 6);
+
+  // 18ns is 36 clocks at 2GHz
+  timing = PsramTiming::Make(2000000000, 1, 0);
+  CheckEqual("Make min deselect clamped to 31", timing.uMinDeselect, 31);
+
+  // within range both are as worked out
+  timing = PsramTiming::Make(150000000, 2, 3);
+  CheckEqual("Make max select", timing.uMaxSelect, 18);
+  CheckEqual("Make min deselect", timing.uMinDeselect, 2);
+  CheckEqual("Make psram clock", timing.GetPsramHz(), 75000000);
+
+  PsramTiming garbage = timing;
+  garbage.uMagic = 0;
+  Check(!garbage.IsValidFor(150000000), "Make valid without the magic", 1, 0);
+  garbage = timing;
+  garbage.uRxDelay = PsramTiming::c_uMaxRxDelay + 1;
+  Check(!garbage.IsValidFor(150000000), "Make valid with rxdelay out of range", 1, 0);
+}
+
+static void TestPickRxDelay(void)
+{
+  CheckEqual("PickRxDelay none", PsramTiming::PickRxDelay(0x00), -1);
+  CheckEqual("PickRxDelay all", PsramTiming::PickRxDelay(0xff), 3);
+
+  for(int8_t iBit = 0; iBit <= PsramTiming::c_uMaxRxDelay; iBit++)
+    CheckEqual("PickRxDelay single", PsramTiming::PickRxDelay(1u << iBit), iBit);
+
+  CheckEqual("PickRxDelay split, longer run last", PsramTiming::PickRxDelay(0x73), 5);
+  CheckEqual("PickRxDelay split, longer run first", PsramTiming::PickRxDelay(0x8f), 1);
+  CheckEqual("PickRxDelay split, equal runs", PsramTiming::PickRxDelay(0x33), 0);
+  CheckEqual("PickRxDelay top bits", PsramTiming::PickRxDelay(0xe0), 6);
+}
+
+int main()
+{
+  TestDefault();
+  TestMake();
+  TestPickRxDelay();
+
+  printf("PsramTiming: %u failures\n", (unsigned)uFailures);
+  return uFailures ? 1 : 0;
+}
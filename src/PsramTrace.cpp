@@ -0,0 +1,53 @@
+#include "pico/stdlib.h"
+
+#include "PsramTrace.h"
+#include "PicoPlusPsram.h"
+
+// Longest heap map row printed
+static const uint32_t c_uMaxColumns = 128;
+
+void PsramTrace::Report(uint32_t uColumns, uint32_t uRows)
+{
+  static uint32_t lastAllocations[PSRAM_TRACE_MAX_TAGS];
+  static uint64_t lastReportTime = 0;
+
+  uint64_t now = time_us_64();
+  float fSeconds = (now - lastReportTime) / 1000000.0f;
+  lastReportTime = now;
+
+  printf("%-16s %10s %10s %10s %10s %6s %10s\n", "tag", "live", "peak", "allocs", "frees", "fails", "allocs/s");
+  for(uint8_t uTag = 0; uTag < tagCount; uTag++)
+  {
+    const TagStats &stats = tags[uTag];
+    printf("%-16s %10u %10u %10u %10u %6u %10.1f\n", stats.pName, (unsigned)stats.uLiveBytes, (unsigned)stats.uPeakBytes,
+           (unsigned)stats.uAllocations, (unsigned)stats.uFrees, (unsigned)stats.uFailures,
+           fSeconds > 0.0f ? (stats.uAllocations - lastAllocations[uTag]) / fSeconds : 0.0f);
+    lastAllocations[uTag] = stats.uAllocations;
+  }
+
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  if(uColumns > c_uMaxColumns)
+    uColumns = c_uMaxColumns;
+
+  for(int iHeap = 0; iHeap < PicoPlusPsram::heapCount; iHeap++)
+  {
+    PicoPlusPsram::Heap heap = (PicoPlusPsram::Heap)iHeap;
+    PicoPlusPsram::HeapStats stats = ps.GetStats(heap);
+    if(!stats.uSize)
+      continue;
+
+    printf("heap %s: size=%u free=%u min free=%u largest=%u free blocks=%u fragmentation=%.3f\n", stats.pName,
+           (unsigned)stats.uSize, (unsigned)stats.uAvailable, (unsigned)stats.uMinimumAvailable,
+           (unsigned)stats.uLargestFree, (unsigned)stats.uFreeBlocks, stats.GetFragmentation());
+
+    // a row at a time, each row is the same slice of the heap
+    char row[c_uMaxColumns + 1];
+    size_t uRowSize = (stats.uSize + uRows - 1) / uRows;
+    for(uint32_t uRow = 0; uRow < uRows; uRow++)
+    {
+      ps.GetHeapMap(heap, row, uColumns, uRow * uRowSize, uRowSize);
+      row[uColumns] = 0;
+      printf("  %08x %s\n", (unsigned)(uRow * uRowSize), row);
+    }
+  }
+}
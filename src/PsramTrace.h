@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+// PSRAM_TRACE 1 = count PicoPlusPsram allocations by tag, 0 = no tracing and no per allocation header
+#ifndef PSRAM_TRACE
+#define PSRAM_TRACE 1
+#endif
+
+// Tags that can be told apart, allocations under any more are counted as untagged
+#ifndef PSRAM_TRACE_MAX_TAGS
+#define PSRAM_TRACE_MAX_TAGS 16
+#endif
+
+// PsramTrace
+//  Counts PicoPlusPsram allocations by tag, so a slow leak shows up as one tag's live
+//  bytes creeping up long before an allocation fails.
+//
+//  The tag is whatever Scope is innermost on the calling core, so a subsystem or call site
+//  is tagged by putting a Scope around it, allocations outside any are "untagged". Each
+//  allocation keeps its tag and size in a small header in front of it, counting costs a
+//  few adds and the tables live in SRAM, so it can be left on. Like lwmem it is not
+//  locked, allocate from one core at a time.
+//
+//  Usage:
+//    PsramTrace::Scope tag("textures");  - tag allocations until the end of the block
+//    PsramTrace::Report()                - print the tags and heaps, with heap maps
+class PsramTrace
+{
+public:
+  struct TagStats
+  {
+    const char *pName;
+    size_t     uLiveBytes;     // allocated and not yet freed
+    size_t     uPeakBytes;     // most live at once
+    uint32_t   uAllocations;
+    uint32_t   uFrees;
+    uint32_t   uFailures;      // allocations there was no room for
+  };
+
+  // Scope
+  //  Tags allocations made on this core while it is in scope
+  class Scope
+  {
+  public:
+    Scope(const char *pName) : m_uPrevious(currentTags[get_core_num()])
+    {
+      currentTags[get_core_num()] = GetTag(pName);
+    }
+
+    ~Scope(void)
+    {
+      currentTags[get_core_num()] = m_uPrevious;
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator = (const Scope&) = delete;
+
+  private:
+    uint8_t m_uPrevious;
+  };
+
+  // The tag for a name, made the first time it is asked for. 0 is untagged.
+  static uint8_t GetTag(const char *pName)
+  {
+    for(uint8_t uTag = 0; uTag < tagCount; uTag++)
+    {
+      if(tags[uTag].pName == pName || strcmp(tags[uTag].pName, pName) == 0)
+        return uTag;
+    }
+
+    if(tagCount == PSRAM_TRACE_MAX_TAGS)
+      return 0;
+
+    tags[tagCount].pName = pName;
+    return tagCount++;
+  }
+
+  static uint8_t GetCurrentTag(void)
+  {
+    return currentTags[get_core_num()];
+  }
+
+  static uint8_t GetTagCount(void)
+  {
+    return tagCount;
+  }
+
+  static const TagStats &GetTagStats(uint8_t uTag)
+  {
+    return tags[uTag];
+  }
+
+  // Called by PicoPlusPsram as blocks come and go
+  static void OnAlloc(uint8_t uTag, size_t uBytes)
+  {
+#if PSRAM_TRACE
+    TagStats &stats = tags[uTag];
+    stats.uLiveBytes += uBytes;
+    if(stats.uLiveBytes > stats.uPeakBytes)
+      stats.uPeakBytes = stats.uLiveBytes;
+    stats.uAllocations++;
+#endif
+  }
+
+  static void OnFree(uint8_t uTag, size_t uBytes)
+  {
+#if PSRAM_TRACE
+    TagStats &stats = tags[uTag];
+    stats.uLiveBytes -= uBytes;
+    stats.uFrees++;
+#endif
+  }
+
+  static void OnFailure(uint8_t uTag)
+  {
+#if PSRAM_TRACE
+    tags[uTag].uFailures++;
+#endif
+  }
+
+  // Print each tag with its allocation rate since the last Report(), then each heap with its
+  // fragmentation and a map of uColumns x uRows cells, '#' used, '.' free and '+' part used
+  static void Report(uint32_t uColumns = 64, uint32_t uRows = 8);
+
+private:
+  inline static TagStats tags[PSRAM_TRACE_MAX_TAGS] = {{"untagged", 0, 0, 0, 0, 0}};
+  inline static uint8_t  tagCount = 1;
+  inline static uint8_t  currentTags[2] = {0, 0};
+};
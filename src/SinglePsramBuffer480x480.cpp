@@ -20,18 +20,26 @@
 // then you can see glitching whenever your code is updating the same row of the 
 // display that is currently being sent to the screen.
 //
-// To avoid this glitching you can use two back buffers but for this example
-// one back buffer works fine.
+// To avoid this glitching the drawing is queued on a BeamRacer, which estimates
+// the row being sent from the vsync timing and holds each draw back until the
+// rows it touches are clear of the beam. So one back buffer works fine.
 //
-// Note: Timings and fps data are logged to the USB UART, if you attach a 
-//       serial monitor to see them then you may get some slight glitching
-//       with the display.
+// The brush is drawn where the finger is predicted to be when its rows are next
+// sent to the panel, rather than where it was last read, so it keeps up with the
+// finger. Set TOUCH_PREDICTION_GAIN to 0 to draw at the last position read.
+//
+// Note: A summary of the phase timings and fps is logged to the USB UART every
+//       128 frames by FrameProfiler, with how many draws had to wait for the beam
+//       and how many were drawn without it being clear.
 // ******************************************************************************
 
 #include "libraries/pico_graphics/pico_graphics.hpp"
 #include "drivers/st7701/st7701Cached.hpp"
 
 #include "PicoPlusPsram.h"
+#include "BeamRacer.h"
+#include "DisplayList.h"
+#include "TouchPredictor.h"
 #include "Elapsed.h"
 #include "FT6236.h"
 
@@ -47,6 +55,13 @@ static const uint LCD_DAT = 27;
 static const uint LCD_DC = -1;
 static const uint LCD_D0 = 1;
 
+// TOUCH_PREDICTION_GAIN 0 = draw at the last touch read, 1 = extrapolate to when the rows are sent
+#define TOUCH_PREDICTION_GAIN 1.0f
+
+// Phases timed each frame, the names match the log
+enum { phaseVsync, phaseTouch, phaseDraw, phaseCount };
+static const char * const phaseNames[phaseCount] = {"V", "T", "D"};
+
 FT6236 touchDisplay;
 
 uint16_t                *back_buffer; // Single back buffer to use
@@ -70,7 +85,10 @@ int main()
   gpio_set_dir(LCD_CS, 1);
 
   // allocate 480x480 back buffer in psram, use uncached address
-  back_buffer = (uint16_t *)ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2) + 0x02000000;
+  {
+    PsramTrace::Scope tag("framebuffers");
+    back_buffer = (uint16_t *)ps.GetUncachedAddress(ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2, PicoPlusPsram::heapFrame));
+  }
 
   // Use the ST7701Cached presto object, this works by providing the back_buffer it whould use to send to the display
   presto = new ST7701Cached(FRAME_WIDTH, FRAME_HEIGHT, ROTATE_0, SPIPins{spi1, LCD_CS, LCD_CLK, LCD_DAT, PIN_UNUSED, LCD_DC, BACKLIGHT}, (uint16_t *)back_buffer);
@@ -82,9 +100,11 @@ int main()
   presto->init();
   memset(back_buffer, 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
 
-  // display some help text
-  graphics->set_pen(0xffff);
-  graphics->text("Draw with finger, tap with two fingers one above the other to clear.", {0, 0}, 480);
+  // display some help text, recorded once so it can be redrawn after each clear
+  DisplayList help(FRAME_HEIGHT);
+  help.set_pen(0xffff);
+  help.text(*graphics, "Draw with finger, tap with two fingers one above the other to clear.", {0, 0}, 480);
+  help.Replay(*graphics);
 
   // Variables for changing radius
   int16_t radius       = 10;
@@ -94,30 +114,50 @@ int main()
   int16_t colorComponents[3] = {(int16_t)(rand()%256), (int16_t)(rand()%256), (int16_t)(rand()%256)};
   int8_t  colorComponentsChange[3] = {(int8_t)((rand()%5)-2), (int8_t)((rand()%5)-2), (int8_t)((rand()%5)-2)};
   
+  // Read touches in the background when the controller signals
+  touchDisplay.EnableInterrupt();
+
+  // Used to hold drawing back until the beam is clear of it
+  ScanlineEstimator scanline(FRAME_HEIGHT);
+  BeamRacer racer(scanline);
+
+  // Used to draw where the finger will be rather than where it was
+  TouchPredictor::Config predictorConfig;
+  predictorConfig.fGain = TOUCH_PREDICTION_GAIN;
+  TouchPredictor predictor(predictorConfig);
+
+  // Used for timings
+  FrameProfiler<phaseCount> profiler(phaseNames, 0);
+  uint32_t frame_count = 0;
+  uint32_t waited_count = 0;
+  uint32_t forced_count = 0;
+
   while (true)
   {
-    float vsyncMs = 0;
-    float touchMs = 0;
-    float drawMs = 0;
-    float totalMs = 0;
-    
-    // Used for timings
-    Elapsed elapsed;
-
-    // poll for touches
-    touchDisplay.ReadTouch();
-    touchMs = elapsed.elapsedMs();
+    profiler.BeginFrame();
+
+    // apply the touches read in the background since the last frame, every sample goes into the prediction
+    touchDisplay.Update([&](const FT6236::Event &event) { predictor.Add(event); });
+    profiler.Lap(phaseTouch);
 
     // wait for vsync
     presto->wait_for_vsync();
-    vsyncMs = elapsed.elapsedMs();
+    scanline.OnVsync(time_us_64());
+    profiler.Lap(phaseVsync);
 
     // draw touch
     const FT6236::Touch &touch0 = touchDisplay.GetTouch(0);
-    touchMs = elapsed.elapsedMs();
 
     if(touch0.active && touch0.HasMoved())
     {
+      // predict where the finger will be when the rows around it are next sent, the row
+      // depends on the position so predict to now first and then to that row's time
+      uint64_t now = time_us_64();
+      int16_t x = touch0.x, y = touch0.y;
+      predictor.Predict(0, now, x, y);
+      uint16_t uRow = y < 0 ? 0 : (y >= FRAME_HEIGHT ? FRAME_HEIGHT - 1 : y);
+      predictor.Predict(0, scanline.GetRowTime(uRow, now), x, y);
+
       // Next radius
       if(radius > 50 || radius < 10)
         radiusChange = 0 - radiusChange;
@@ -141,16 +181,17 @@ int main()
       }
 
       // draw circles
-      graphics->set_pen(colorComponents[0], colorComponents[1], colorComponents[2]);
-      graphics->circle({touch0.x, touch0.y}, radius);
-      graphics->circle({FRAME_WIDTH-touch0.x, touch0.y}, radius);
-      graphics->circle({FRAME_WIDTH-touch0.x, FRAME_HEIGHT-touch0.y}, radius);
-      graphics->circle({touch0.x, FRAME_HEIGHT-touch0.y}, radius);
+      racer.set_pen(graphics->create_pen(colorComponents[0], colorComponents[1], colorComponents[2]));
+      racer.circle({x, y}, radius);
+      racer.circle({FRAME_WIDTH-x, y}, radius);
+      racer.circle({FRAME_WIDTH-x, FRAME_HEIGHT-y}, radius);
+      racer.circle({x, FRAME_HEIGHT-y}, radius);
     }
 
     // if we have a second touch then clear the screen and start again
     const FT6236::Touch &touch1 = touchDisplay.GetTouch(1);
-    if(touch1.active)
+    bool bCleared = touch1.active;
+    if(bCleared)
     {
       // generate new colors
       for(int i = 0; i < 3; i++)
@@ -159,19 +200,28 @@ int main()
         colorComponentsChange[i] = (int16_t)(rand()%11)-5;
       }
 
-      // clear the back_buffer
-      memset(back_buffer, 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
+      // clear the back_buffer in bands so each one can be cleared behind the beam
+      racer.set_pen(0);
+      for(int32_t y = 0; y < FRAME_HEIGHT; y += 16)
+        racer.rectangle({0, y, FRAME_WIDTH, 16});
    }
 
-    drawMs = elapsed.elapsedMs();
+    // the help text goes back after a clear, behind the beam like everything else
+    if(bCleared)
+      racer.Add(help);
 
-    totalMs = touchMs + drawMs + vsyncMs;
-    float fps = 1000.0f / totalMs;
+    // draw everything queued this frame
+    waited_count += racer.Run(*graphics);
+    forced_count += racer.GetForcedCount();
+    profiler.Lap(phaseDraw);
 
-    printf("V=%.2f ", vsyncMs);
-    printf("T=%.2f ", touchMs);
-    printf("D=%.2f ", drawMs);
-    printf("A=%.2f ", totalMs);
-    printf("F=%.2f\n", fps);
+    profiler.EndFrame();
+    if ((++frame_count & 127) == 0)
+    {
+      profiler.Report();
+      printf("racer waited=%u forced=%u\n", (unsigned)waited_count, (unsigned)forced_count);
+      waited_count = 0;
+      forced_count = 0;
+    }
   }
 }
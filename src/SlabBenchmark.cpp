@@ -0,0 +1,157 @@
+// ******************************************************************************
+// This benchmark compares PsramSlab against plain lwmem allocations from
+// PicoPlusPsram when churning lots of small objects in PSRAM.
+//
+// Both allocators are given the same sequence of allocations and frees of
+// 8 to 256 byte objects. The mean latency of an allocate/free pair is reported
+// along with the fragmentation left behind, which is the largest block lwmem
+// can still allocate compared with the total bytes it has available. The
+// PsramTrace report with the heap maps follows.
+//
+// The first and last byte of each object are tagged when it is allocated and
+// checked before it is freed, so objects handed out twice or overlapping show
+// up. Every allocation must succeed, and once everything is freed lwmem must
+// have the bytes back it started with and the slab no bytes in use. A failed
+// check is printed as a FAIL line and the host build exits with 1.
+//
+// Results are logged to the USB UART every 5 seconds.
+// ******************************************************************************
+
+#include "pico/stdlib.h"
+
+#include "PicoPlusPsram.h"
+#include "PsramSlab.h"
+#include "PsramTrace.h"
+
+#define LIVE_OBJECTS  1000
+#define CHURN_COUNT   20000
+#define MIN_SIZE      8
+#define MAX_SIZE      256
+
+static void    *objects[LIVE_OBJECTS];
+static size_t  sizes[LIVE_OBJECTS];
+static uint8_t tags[LIVE_OBJECTS];
+
+static uint32_t uFailures = 0;
+
+static void Check(bool bOk, const char *pName, const char *pWhat)
+{
+  if(bOk)
+    return;
+
+  printf("FAIL %s: %s\n", pName, pWhat);
+  uFailures++;
+}
+
+// Small deterministic generator so both runs see the same sequence
+static uint32_t randState;
+
+static uint32_t NextRand(void)
+{
+  randState ^= randState << 13;
+  randState ^= randState >> 17;
+  randState ^= randState << 5;
+  return randState;
+}
+
+static size_t NextSize(void)
+{
+  return MIN_SIZE + NextRand() % (MAX_SIZE - MIN_SIZE + 1);
+}
+
+// Allocate object uIndex and tag its ends, false if the allocation failed
+template<typename MALLOC>
+static bool Allocate(MALLOC fnMalloc, uint32_t uIndex, uint8_t uTag)
+{
+  size_t uSize = NextSize();
+  uint8_t *pObject = (uint8_t *)fnMalloc(uSize);
+  objects[uIndex] = pObject;
+  sizes[uIndex] = uSize;
+  tags[uIndex] = uTag;
+  if(!pObject)
+    return false;
+
+  pObject[0] = uTag;
+  pObject[uSize - 1] = uTag;
+  return true;
+}
+
+// Free object uIndex, false if another object wrote over its tags
+template<typename FREE>
+static bool Release(FREE fnFree, uint32_t uIndex)
+{
+  uint8_t *pObject = (uint8_t *)objects[uIndex];
+  if(!pObject)
+    return true;
+
+  bool bOk = pObject[0] == tags[uIndex] && pObject[sizes[uIndex] - 1] == tags[uIndex];
+  fnFree(pObject);
+  objects[uIndex] = nullptr;
+  return bOk;
+}
+
+template<typename MALLOC, typename FREE>
+static void Run(const char *pName, MALLOC fnMalloc, FREE fnFree)
+{
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  PsramTrace::Scope tag("churn");
+
+  randState = 0x12345678;
+  size_t uStartAvailable = ps.GetStats(PicoPlusPsram::heapGeneral).uAvailable;
+  bool bAllocated = true;
+  bool bTagsIntact = true;
+
+  for(uint32_t i = 0; i < LIVE_OBJECTS; i++)
+    bAllocated &= Allocate(fnMalloc, i, (uint8_t)i);
+
+  uint64_t startTime = time_us_64();
+  for(uint32_t i = 0; i < CHURN_COUNT; i++)
+  {
+    uint32_t uIndex = NextRand() % LIVE_OBJECTS;
+    bTagsIntact &= Release(fnFree, uIndex);
+    bAllocated &= Allocate(fnMalloc, uIndex, (uint8_t)(i + 1));
+  }
+  uint64_t elapsedUs = time_us_64() - startTime;
+
+  PicoPlusPsram::HeapStats heapStats = ps.GetStats(PicoPlusPsram::heapGeneral);
+  size_t uAvailable = heapStats.uAvailable;
+  size_t uLargest = heapStats.uLargestFree;
+
+  for(uint32_t i = 0; i < LIVE_OBJECTS; i++)
+    bTagsIntact &= Release(fnFree, i);
+
+  Check(bAllocated, pName, "an allocation failed");
+  Check(bTagsIntact, pName, "an object was written over by another");
+  Check(ps.GetStats(PicoPlusPsram::heapGeneral).uAvailable == uStartAvailable, pName, "lwmem did not get every byte back");
+
+  printf("%s: %.3f us per malloc/free, available=%u largest=%u fragmentation=%.4f\n", pName,
+         (float)elapsedUs / CHURN_COUNT, (unsigned)uAvailable, (unsigned)uLargest,
+         heapStats.GetFragmentation());
+}
+
+int main()
+{
+  // run as 266mhz, twice the speed of the Psram
+  set_sys_clock_khz(266000, true);
+  stdio_init_all();
+
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  PsramSlab &slab = PsramSlab::getInstance();
+
+  while(true)
+  {
+    Run("lwmem", [&](size_t uSize) { return ps.Malloc(uSize); }, [&](void *p) { ps.Free(p); });
+    Run("slab ", [&](size_t uSize) { return slab.Malloc(uSize); }, [&](void *p) { slab.Free(p); });
+
+    PsramSlab::Stats stats = slab.GetStats();
+    printf("slab: pages in use=%u fallbacks=%u\n", stats.uPagesInUse, (unsigned)stats.uFallbackCount);
+    Check(stats.uUsedBytes == 0, "slab ", "bytes still in use with every object freed");
+    PsramTrace::Report();
+
+#if PRESTO_HOST
+    printf("%u failures\n", (unsigned)uFailures);
+    return uFailures ? 1 : 0;
+#endif
+    sleep_ms(5000);
+  }
+}
@@ -0,0 +1,69 @@
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "SplitRenderer.h"
+
+using namespace pimoroni;
+
+// FIFO words between the cores
+#define SPLIT_RENDER (0x53504c54)
+#define SPLIT_DONE   (0x444f4e45)
+
+// The renderer core 1 is serving
+static SplitRenderer *pCore1Renderer = nullptr;
+
+SplitRenderer::SplitRenderer(uint16_t uWidth, uint16_t uHeight, uint16_t *pTarget, uint16_t uBandHeight)
+  : m_uWidth(uWidth), m_uHeight(uHeight), m_uBandHeight(uBandHeight),
+    m_graphics{{uWidth, uHeight, pTarget}, {uWidth, uHeight, pTarget}}, m_list(uHeight, uBandHeight)
+{
+  pCore1Renderer = this;
+  multicore_launch_core1(Core1Entry);
+}
+
+void SplitRenderer::Core1Entry(void)
+{
+  while(true)
+  {
+    if(multicore_fifo_pop_blocking() != SPLIT_RENDER)
+      continue;
+
+    pCore1Renderer->DrawBands(1);
+
+    // make the band writes visible before reporting back
+    __dmb();
+    multicore_fifo_push_blocking(SPLIT_DONE);
+  }
+}
+
+// Draw every other band, starting with band uCore
+void SplitRenderer::DrawBands(uint8_t uCore)
+{
+  PicoGraphics_PenRGB565 &graphics = m_graphics[uCore];
+
+  for(uint16_t uBand = uCore; uBand < m_list.GetBandCount(); uBand += 2)
+  {
+    graphics.set_clip(Rect(0, uBand * m_uBandHeight, m_uWidth, m_uBandHeight));
+    m_list.ReplayBand(uBand, graphics);
+  }
+}
+
+void SplitRenderer::Render(uint16_t *pTarget)
+{
+  m_graphics[0].set_framebuffer(pTarget);
+  m_graphics[1].set_framebuffer(pTarget);
+
+  // bin and publish the commands and target, then wake core 1
+  m_list.Sort();
+  __dmb();
+  multicore_fifo_push_blocking(SPLIT_RENDER);
+
+  DrawBands(0);
+
+  // frame barrier
+  while(multicore_fifo_pop_blocking() != SPLIT_DONE)
+    tight_loop_contents();
+  __dmb();
+
+  m_list.Clear();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "DisplayList.h"
+
+// SplitRenderer
+//  Records the draw calls for a frame in a DisplayList and rasterises them on both cores.
+//  The frame is cut into horizontal bands, core 0 draws the even bands and core 1 the odd
+//  ones, each through its own PicoGraphics clipped to the band. A band height of half the frame
+//  height gives a top/bottom split, smaller bands spread uneven scenes more evenly.
+//
+//  Render() wakes core 1 through the multicore FIFO, draws core 0's bands, then waits
+//  for core 1 to report back so the frame is complete when it returns. Core 1 is
+//  launched by the constructor and must not be used for anything else.
+//
+//  Each frame:
+//    set_pen(), rectangle(), circle(), pixel_span() - record the frame
+//    Render(back_buffer)                              - rasterise it on both cores
+class SplitRenderer
+{
+public:
+  // pTarget is any back buffer, PicoGraphics would allocate a frame buffer without one
+  SplitRenderer(uint16_t uWidth, uint16_t uHeight, uint16_t *pTarget, uint16_t uBandHeight = 16);
+
+  SplitRenderer(const SplitRenderer&) = delete;
+  SplitRenderer& operator = (const SplitRenderer&) = delete;
+
+  void set_pen(uint c)
+  {
+    m_uPen = c;
+  }
+
+  void rectangle(const pimoroni::Rect &r)
+  {
+    m_list.Add(DrawCommand::Rectangle(m_uPen, r));
+  }
+
+  void circle(const pimoroni::Point &p, int32_t radius)
+  {
+    m_list.Add(DrawCommand::Circle(m_uPen, p, radius));
+  }
+
+  void pixel_span(const pimoroni::Point &p, int32_t l)
+  {
+    m_list.Add(DrawCommand::PixelSpan(m_uPen, p, l));
+  }
+
+  // Rasterise the recorded commands into pTarget on both cores and start a new frame
+  void Render(uint16_t *pTarget);
+
+private:
+  void DrawBands(uint8_t uCore);
+
+  static void Core1Entry(void);
+
+  uint16_t                   m_uWidth;
+  uint16_t                   m_uHeight;
+  uint16_t                   m_uBandHeight;
+  uint16_t                   m_uPen = 0;
+
+  pimoroni::PicoGraphics_PenRGB565 m_graphics[2];  // one per core
+  DisplayList                m_list;               // the frame, binned by band
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// SpscQueue
+//  Lock free fixed size queue for one producer and one consumer, for example
+//  passing buffers between core 0 and core 1. Push() is only called from the
+//  producer and Pop() only from the consumer, neither ever blocks.
+//
+//  SIZE must be a power of two, the queue holds up to SIZE items.
+template<typename T, uint32_t SIZE> class SpscQueue
+{
+  static_assert((SIZE & (SIZE - 1)) == 0, "SpscQueue SIZE must be a power of two");
+
+public:
+  // Returns false if the queue is full
+  bool Push(const T &item)
+  {
+    uint32_t uTail = m_uTail.load(std::memory_order_relaxed);
+    if(uTail - m_uHead.load(std::memory_order_acquire) >= SIZE)
+      return false;
+
+    m_items[uTail & (SIZE - 1)] = item;
+    m_uTail.store(uTail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false if the queue is empty
+  bool Pop(T &item)
+  {
+    uint32_t uHead = m_uHead.load(std::memory_order_relaxed);
+    if(uHead == m_uTail.load(std::memory_order_acquire))
+      return false;
+
+    item = m_items[uHead & (SIZE - 1)];
+    m_uHead.store(uHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool IsEmpty(void) const
+  {
+    return m_uHead.load(std::memory_order_acquire) == m_uTail.load(std::memory_order_acquire);
+  }
+
+private:
+  T                     m_items[SIZE];
+  std::atomic<uint32_t> m_uHead{0};  // items popped, written by the consumer
+  std::atomic<uint32_t> m_uTail{0};  // items pushed, written by the producer
+};
@@ -0,0 +1,104 @@
+#include <algorithm>
+
+#include "StripRenderer.h"
+
+using namespace pimoroni;
+
+StripRenderer::StripRenderer(uint16_t uWidth, uint16_t uHeight, uint16_t uStripHeight, uint16_t uClearColour)
+  : m_uWidth(uWidth), m_uHeight(uHeight), m_uStripHeight(uStripHeight), m_uClearColour(uClearColour),
+    m_pStrip(new uint16_t[uWidth * uStripHeight]), m_graphics(uWidth, uStripHeight, m_pStrip), m_list(uHeight, uStripHeight)
+{
+  m_pDrawn = new DamageTracker(uWidth, uHeight);
+
+  for(uint8_t i = 0; i < c_uMaxTargets; i++)
+  {
+    m_targets[i].pBuffer = nullptr;
+    m_targets[i].pWritten = new DamageTracker(uWidth, uHeight);
+  }
+}
+
+StripRenderer::~StripRenderer(void)
+{
+  for(uint8_t i = 0; i < c_uMaxTargets; i++)
+    delete m_targets[i].pWritten;
+
+  delete m_pDrawn;
+  delete[] m_pStrip;
+}
+
+void StripRenderer::Add(const DrawCommand &command)
+{
+  m_list.Add(command);
+  m_pDrawn->Add(command.Bounds());
+}
+
+// Find what was last written to a back buffer, a buffer not seen before is assumed to be all dirty
+StripRenderer::Target &StripRenderer::FindTarget(uint16_t *pBuffer)
+{
+  for(uint8_t i = 0; i < c_uMaxTargets; i++)
+  {
+    if(m_targets[i].pBuffer == pBuffer)
+      return m_targets[i];
+  }
+
+  Target &target = m_targets[m_uNextTarget];
+  m_uNextTarget = (m_uNextTarget + 1) % c_uMaxTargets;
+
+  target.pBuffer = pBuffer;
+  target.pWritten->Reset();
+  target.pWritten->Add(Rect(0, 0, m_uWidth, m_uHeight));
+  return target;
+}
+
+void StripRenderer::Render(uint16_t *pTarget)
+{
+  Target &target = FindTarget(pTarget);
+
+  // bin the commands by strip
+  m_list.Sort();
+
+  // the spans drawn now and the spans that need clearing from last time are written out
+  target.pWritten->Add(*m_pDrawn);
+
+  for(uint16_t uStrip = 0; uStrip < m_list.GetBandCount(); uStrip++)
+  {
+    uint16_t y1 = uStrip * m_uStripHeight;
+    uint16_t y2 = std::min((uint16_t)(y1 + m_uStripHeight), m_uHeight);
+
+    // skip strips with nothing drawn now or left over from last time
+    bool bDirty = false;
+    for(uint16_t y = y1; y < y2 && !bDirty; y++)
+      bDirty = target.pWritten->IsRowDamaged(y);
+
+    if(!bDirty)
+      continue;
+
+    // rasterise into SRAM, the commands are drawn moved up so the strip's rows land in m_pStrip
+    size_t uPixels = (size_t)m_uWidth * (y2 - y1);
+    if(m_uClearColour == 0)
+      memset(m_pStrip, 0, uPixels * 2);
+    else
+      std::fill(m_pStrip, m_pStrip + uPixels, m_uClearColour);
+
+    m_graphics.set_clip(Rect(0, 0, m_uWidth, y2 - y1));
+
+    m_list.ReplayBand(uStrip, m_graphics, y1);
+
+    // write out the damaged spans
+    for(uint16_t y = y1; y < y2; y++)
+    {
+      uint16_t *pSrc = m_pStrip + (y - y1) * m_uWidth;
+      uint16_t *pDst = pTarget + y * m_uWidth;
+
+      target.pWritten->ForEachSpan(y, [&](uint16_t, uint16_t x, uint16_t w)
+      {
+        memcpy(pDst + x, pSrc + x, w * 2);
+      });
+    }
+  }
+
+  // the target now only holds what was drawn this frame
+  std::swap(target.pWritten, m_pDrawn);
+  m_pDrawn->Reset();
+  m_list.Clear();
+}
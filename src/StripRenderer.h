@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "DisplayList.h"
+#include "DamageDoubleBuffer.h"
+
+// StripRenderer
+//  Records the draw calls for a frame, then rasterises the frame a horizontal strip
+//  at a time into a small SRAM buffer and writes each finished strip to the psram
+//  back buffer. Overdraw only costs SRAM cycles and psram just sees a few
+//  sequential writes per row.
+//
+//  The commands are recorded in a DisplayList with a band per strip, so each strip
+//  only replays the commands that touch it. Only the row spans drawn
+//  this frame, or drawn the last time the same back buffer was rendered, are
+//  written to psram so the rest of the back buffer needs no clearing.
+//
+//  Each frame:
+//    set_pen(), rectangle(), circle(), pixel_span() - record the frame
+//    Render(back_buffer)                              - rasterise and write it out
+class StripRenderer
+{
+public:
+  StripRenderer(uint16_t uWidth, uint16_t uHeight, uint16_t uStripHeight = 16, uint16_t uClearColour = 0);
+  ~StripRenderer(void);
+
+  StripRenderer(const StripRenderer&) = delete;
+  StripRenderer& operator = (const StripRenderer&) = delete;
+
+  void set_pen(uint c)
+  {
+    m_uPen = c;
+  }
+
+  void rectangle(const pimoroni::Rect &r)
+  {
+    Add(DrawCommand::Rectangle(m_uPen, r));
+  }
+
+  void circle(const pimoroni::Point &p, int32_t radius)
+  {
+    Add(DrawCommand::Circle(m_uPen, p, radius));
+  }
+
+  void pixel_span(const pimoroni::Point &p, int32_t l)
+  {
+    Add(DrawCommand::PixelSpan(m_uPen, p, l));
+  }
+
+  // Rasterise the recorded commands into pTarget and start a new frame
+  void Render(uint16_t *pTarget);
+
+private:
+  // Back buffers rendered to, with the spans last written to each
+  static const uint8_t c_uMaxTargets = 3;
+
+  struct Target
+  {
+    uint16_t      *pBuffer;
+    DamageTracker *pWritten;
+  };
+
+  void Add(const DrawCommand &command);
+  Target &FindTarget(uint16_t *pBuffer);
+
+  uint16_t                   m_uWidth;
+  uint16_t                   m_uHeight;
+  uint16_t                   m_uStripHeight;
+  uint16_t                   m_uClearColour;
+  uint16_t                   m_uPen = 0;
+
+  uint16_t                   *m_pStrip;       // SRAM the strips are rasterised into
+  pimoroni::PicoGraphics_PenRGB565 m_graphics;
+
+  DisplayList                m_list;          // the frame, binned by strip
+
+  DamageTracker              *m_pDrawn;       // spans drawn this frame
+  Target                     m_targets[c_uMaxTargets];
+  uint8_t                    m_uNextTarget = 0;
+};
@@ -0,0 +1,262 @@
+#include "TextureCache.h"
+#include "PicoPlusPsram.h"
+
+// Pixels decompressed per AssetLoader::Step() while loading
+static const uint32_t c_uStepBytes = 8192;
+
+// Magenta and grey checker board, in the PicoGraphics_PenRGB565 byte order
+static uint16_t placeholderPixels[16 * 16];
+
+TextureCache::TextureCache(size_t uBudget, uint32_t uMaxEntries) : m_uBudget(uBudget), m_uMaxEntries(uMaxEntries)
+{
+  m_entries.reserve(m_uMaxEntries);
+  m_queue.reserve(m_uMaxEntries);
+
+  for(uint32_t i = 0; i < 16 * 16; i++)
+    placeholderPixels[i] = ((i / 16 / 4) + (i % 16 / 4)) & 1 ? 0x1ff8 : 0x0842;
+  m_placeholder = {placeholderPixels, 16, 16, 16, 16, 1};
+}
+
+TextureCache::~TextureCache(void)
+{
+  m_loader.Cancel();
+  for(Entry &entry : m_entries)
+  {
+    if(entry.state == stateResident || entry.state == stateLoading)
+      PicoPlusPsram::getInstance().Free((void *)entry.texture.pPixels);
+  }
+}
+
+// FNV-1a, to compare paths without comparing strings
+uint32_t TextureCache::Hash(const char *pPath)
+{
+  uint32_t uHash = 2166136261u;
+  while(*pPath)
+    uHash = (uHash ^ (uint8_t)*pPath++) * 16777619u;
+  return uHash;
+}
+
+int32_t TextureCache::FindIndex(const char *pPath, uint32_t uHash) const
+{
+  for(uint32_t i = 0; i < m_entries.size(); i++)
+  {
+    const Entry &entry = m_entries[i];
+    if(entry.uHash == uHash && entry.state != stateEmpty && entry.path == pPath)
+      return i;
+  }
+  return -1;
+}
+
+const TextureCache::Texture &TextureCache::Get(const char *pPath)
+{
+  uint32_t uHash = Hash(pPath);
+  int32_t iIndex = FindIndex(pPath, uHash);
+
+  Entry *pEntry = iIndex >= 0 ? &m_entries[iIndex] : nullptr;
+  if(!pEntry)
+  {
+    // queue it, unless every entry is busy
+    pEntry = NewEntry();
+    if(!pEntry)
+    {
+      m_stats.uMisses++;
+      return m_placeholder;
+    }
+
+    pEntry->path = pPath;
+    pEntry->uHash = uHash;
+    pEntry->state = stateQueued;
+    m_queue.push_back(pEntry);
+  }
+
+  pEntry->uLastUsed = ++m_uClock;
+  pEntry->uLastFrame = m_uFrame;
+
+  if(pEntry->state == stateResident)
+  {
+    m_stats.uHits++;
+    return pEntry->texture;
+  }
+
+  m_stats.uMisses++;
+  return m_placeholder;
+}
+
+bool TextureCache::IsResident(const char *pPath) const
+{
+  int32_t iIndex = FindIndex(pPath, Hash(pPath));
+  return iIndex >= 0 && m_entries[iIndex].state == stateResident;
+}
+
+TextureCache::Entry *TextureCache::NewEntry(void)
+{
+  if(m_entries.size() < m_uMaxEntries)
+  {
+    m_entries.push_back({});
+    return &m_entries.back();
+  }
+
+  // reuse the entry used longest ago that is not waiting, loading or in use
+  Entry *pOldest = nullptr;
+  for(Entry &entry : m_entries)
+  {
+    if(entry.state == stateQueued || entry.state == stateLoading || IsInUse(entry))
+      continue;
+    if(!pOldest || entry.state == stateEmpty || entry.uLastUsed < pOldest->uLastUsed)
+    {
+      pOldest = &entry;
+      if(entry.state == stateEmpty)
+        break;
+    }
+  }
+
+  if(pOldest && pOldest->state == stateResident)
+    Evict(*pOldest);
+  return pOldest;
+}
+
+void TextureCache::Evict(Entry &entry)
+{
+  PicoPlusPsram::getInstance().Free((void *)entry.texture.pPixels);
+  m_stats.uResidentBytes -= entry.texture.uWidth * entry.texture.uHeight * 2;
+  m_stats.uEvictions++;
+
+  entry.state = stateEmpty;
+  entry.texture = {};
+}
+
+bool TextureCache::EvictOldest(void)
+{
+  Entry *pOldest = nullptr;
+  for(Entry &entry : m_entries)
+  {
+    if(entry.state == stateResident && !IsInUse(entry) && (!pOldest || entry.uLastUsed < pOldest->uLastUsed))
+      pOldest = &entry;
+  }
+
+  if(!pOldest)
+    return false;
+
+  Evict(*pOldest);
+  return true;
+}
+
+TextureCache::LoadStart TextureCache::StartLoad(Entry &entry)
+{
+  if(!m_loader.Open(entry.path.c_str()))
+    return loadFailed;
+
+  // make room under the budget, then in psram if it is short
+  size_t uSize = m_loader.GetHeader().uDataSize;
+  if(uSize > m_uBudget)
+  {
+    m_loader.Cancel();
+    return loadFailed;
+  }
+
+  // what is left is in use this frame, there may be room after the next Update()
+  while(m_stats.uResidentBytes + uSize > m_uBudget)
+  {
+    if(!EvictOldest())
+    {
+      m_loader.Cancel();
+      return loadDeferred;
+    }
+  }
+
+  PsramTrace::Scope tag("textures");
+  void *pPixels;
+  while(!(pPixels = PicoPlusPsram::getInstance().Malloc(uSize)))
+  {
+    if(!EvictOldest())
+    {
+      m_loader.Cancel();
+      return loadDeferred;
+    }
+  }
+
+  if(!m_loader.Start(pPixels, uSize))
+  {
+    PicoPlusPsram::getInstance().Free(pPixels);
+    return loadFailed;
+  }
+
+  const AssetLoader::Header &header = m_loader.GetHeader();
+  entry.texture = {(const uint16_t *)pPixels, header.uWidth, header.uHeight, header.uFrameWidth, header.uFrameHeight, (uint16_t)header.GetFrameCount()};
+  entry.state = stateLoading;
+  return loadStarted;
+}
+
+void TextureCache::Update(uint32_t uBudgetUs)
+{
+  uint64_t startTime = time_us_64();
+
+  // load whatever fits in the time, a texture at a time
+  while(time_us_64() - startTime < uBudgetUs)
+  {
+    if(!m_pLoading)
+    {
+      if(m_queue.empty())
+        break;
+
+      m_pLoading = m_queue.front();
+      m_queue.erase(m_queue.begin());
+
+      LoadStart start = StartLoad(*m_pLoading);
+      if(start == loadDeferred)
+      {
+        // keep it queued and try again next Update(), once this frame's textures can be evicted
+        m_queue.push_back(m_pLoading);
+        m_pLoading = nullptr;
+        break;
+      }
+      if(start == loadFailed)
+      {
+        m_pLoading->state = stateFailed;
+        m_stats.uLoadFailures++;
+        m_pLoading = nullptr;
+        continue;
+      }
+    }
+
+    AssetLoader::Result result = m_loader.Step(c_uStepBytes);
+    if(result == AssetLoader::resultBusy)
+      continue;
+
+    if(result == AssetLoader::resultDone)
+    {
+      m_pLoading->state = stateResident;
+      m_stats.uResidentBytes += m_loader.GetHeader().uDataSize;
+      m_stats.uLoads++;
+    }
+    else
+    {
+      PicoPlusPsram::getInstance().Free((void *)m_pLoading->texture.pPixels);
+      m_pLoading->texture = {};
+      m_pLoading->state = stateFailed;
+      m_stats.uLoadFailures++;
+    }
+    m_pLoading = nullptr;
+  }
+
+  // the textures returned so far can be evicted from the next Update() on
+  m_uFrame++;
+}
+
+void TextureCache::SetBudget(size_t uBudget)
+{
+  m_uBudget = uBudget;
+  while(m_stats.uResidentBytes > m_uBudget && EvictOldest())
+    ;
+}
+
+void TextureCache::Clear(void)
+{
+  for(Entry &entry : m_entries)
+  {
+    if(entry.state == stateResident && !IsInUse(entry))
+      Evict(entry);
+    else if(entry.state == stateFailed)
+      entry.state = stateEmpty;
+  }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "pico/stdlib.h"
+
+#include "AssetLoader.h"
+
+// TextureCache
+//  Keeps textures, images and sprite sheets packed with AssetPack, in psram from
+//  PicoPlusPsram, loading them from the SD card as they are asked for. Get() never waits on
+//  the card, a texture that is not loaded yet is queued and the placeholder is returned
+//  instead. Update() loads the queued textures a step at a time for a limited time each
+//  frame, so a miss costs a little of several frames rather than a stall.
+//
+//  The textures used longest ago are evicted to keep the total under the budget, but never
+//  one returned by Get() since the last Update(), so a texture can be drawn until the next
+//  Update() without being freed under it. A texture that only fits once those can be
+//  evicted stays queued and is tried again by the next Update(), only a texture that can't
+//  be read or is larger than the budget is given up on.
+//
+//  Each frame:
+//    Get(path)         - the texture, or the placeholder until it is loaded
+//    Update(budgetUs)  - after drawing, load queued textures for up to budgetUs
+class TextureCache
+{
+public:
+  struct Texture
+  {
+    const uint16_t *pPixels;
+    uint16_t       uWidth;
+    uint16_t       uHeight;
+    uint16_t       uFrameWidth;
+    uint16_t       uFrameHeight;
+    uint16_t       uFrameCount;
+
+    // A sprite's pixels, the frames of a sheet run left to right then top to bottom
+    const uint16_t *GetFrame(uint32_t uFrame) const
+    {
+      return pPixels + (uFrame % uFrameCount) * uFrameWidth * uFrameHeight;
+    }
+  };
+
+  struct Stats
+  {
+    uint32_t uHits;           // Get() calls returning the texture
+    uint32_t uMisses;         // Get() calls returning the placeholder
+    uint32_t uLoads;          // textures loaded
+    uint32_t uLoadFailures;   // textures that could not be loaded
+    uint32_t uEvictions;      // textures evicted to keep under the budget
+    size_t   uResidentBytes;  // pixel bytes loaded
+  };
+
+  // Keeps up to uBudget bytes of pixels in psram, for up to uMaxEntries different paths
+  TextureCache(size_t uBudget, uint32_t uMaxEntries = 64);
+  ~TextureCache(void);
+
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator = (const TextureCache&) = delete;
+
+  // The texture if it is loaded, otherwise it is queued to load and the placeholder is returned
+  const Texture &Get(const char *pPath);
+
+  bool IsResident(const char *pPath) const;
+
+  // Load queued textures for up to uBudgetUs, call once a frame after drawing
+  void Update(uint32_t uBudgetUs);
+
+  // Shown for textures that are not loaded, a 16x16 checker board by default. The pixels
+  // must stay valid while the cache uses them.
+  void SetPlaceholder(const Texture &placeholder)
+  {
+    m_placeholder = placeholder;
+  }
+
+  // Evicts textures not used since the last Update() if the new budget is smaller
+  void SetBudget(size_t uBudget);
+
+  size_t GetBudget(void) const
+  {
+    return m_uBudget;
+  }
+
+  // Evict everything not used since the last Update() and forget failed loads
+  void Clear(void);
+
+  const Stats &GetStats(void) const
+  {
+    return m_stats;
+  }
+
+  void ResetCounters(void)
+  {
+    size_t uResidentBytes = m_stats.uResidentBytes;
+    m_stats = {};
+    m_stats.uResidentBytes = uResidentBytes;
+  }
+
+private:
+  enum State { stateEmpty, stateQueued, stateLoading, stateResident, stateFailed };
+
+  // loadDeferred when there is no room until textures in use this frame can be evicted
+  enum LoadStart { loadStarted, loadDeferred, loadFailed };
+
+  struct Entry
+  {
+    std::string path;
+    uint32_t    uHash;
+    State       state;
+    uint32_t    uLastUsed;    // m_uClock at the last Get()
+    uint32_t    uLastFrame;   // m_uFrame at the last Get()
+    Texture     texture;
+  };
+
+  static uint32_t Hash(const char *pPath);
+
+  // Returned by Get() since the last Update()
+  bool IsInUse(const Entry &entry) const
+  {
+    return entry.uLastFrame == m_uFrame;
+  }
+
+  int32_t FindIndex(const char *pPath, uint32_t uHash) const;
+  Entry  *NewEntry(void);
+  void    Evict(Entry &entry);
+  bool    EvictOldest(void);
+  LoadStart StartLoad(Entry &entry);
+
+  size_t               m_uBudget;
+  uint32_t             m_uMaxEntries;
+  std::vector<Entry>   m_entries;         // never more than m_uMaxEntries, so the pointers stay valid
+  std::vector<Entry *> m_queue;           // waiting to load, oldest first
+  Entry                *m_pLoading = nullptr;
+  AssetLoader          m_loader;
+  Texture              m_placeholder;
+  uint32_t             m_uClock = 0;
+  uint32_t             m_uFrame = 1;
+  Stats                m_stats = {};
+};
@@ -0,0 +1,97 @@
+#include "TouchPredictor.h"
+
+void TouchPredictor::Add(const FT6236::Event &event)
+{
+  if(event.id >= FT6236::c_uMaxTouches)
+    return;
+
+  Track &track = m_tracks[event.id];
+
+  if(event.state == STATE_UP)
+  {
+    track.bActive = false;
+    return;
+  }
+
+  if(!track.bActive || event.state == STATE_DOWN)
+  {
+    track.bActive = true;
+    track.uCount = 0;
+    track.uNext = 0;
+  }
+
+  track.samples[track.uNext] = {event.time, event.x, event.y};
+  track.uNext = (track.uNext + 1) % c_uHistory;
+  if(track.uCount < c_uHistory)
+    track.uCount++;
+}
+
+bool TouchPredictor::GetVelocity(uint8_t uId, float &fVx, float &fVy) const
+{
+  fVx = 0.0f;
+  fVy = 0.0f;
+
+  if(!IsActive(uId))
+    return false;
+
+  const Track &track = m_tracks[uId];
+  const Sample &last = GetLast(track);
+
+  // least squares fit of x and y against time over the window, times relative to the last sample
+  float fSumT = 0.0f, fSumX = 0.0f, fSumY = 0.0f;
+  float fSumTT = 0.0f, fSumTX = 0.0f, fSumTY = 0.0f;
+  uint8_t uUsed = 0;
+
+  for(uint8_t i = 0; i < track.uCount; i++)
+  {
+    const Sample &sample = track.samples[(track.uNext + c_uHistory - 1 - i) % c_uHistory];
+    uint64_t age = last.time - sample.time;
+    if(age > m_config.uWindowUs)
+      break;
+
+    float t = -(float)age * 1e-6f;
+    float x = sample.x - last.x;
+    float y = sample.y - last.y;
+
+    fSumT += t;
+    fSumX += x;
+    fSumY += y;
+    fSumTT += t * t;
+    fSumTX += t * x;
+    fSumTY += t * y;
+    uUsed++;
+  }
+
+  float fDenominator = uUsed * fSumTT - fSumT * fSumT;
+  if(uUsed < 2 || fDenominator <= 0.0f)
+    return true;
+
+  fVx = (uUsed * fSumTX - fSumT * fSumX) / fDenominator;
+  fVy = (uUsed * fSumTY - fSumT * fSumY) / fDenominator;
+  return true;
+}
+
+bool TouchPredictor::Predict(uint8_t uId, uint64_t timeAt, int16_t &x, int16_t &y) const
+{
+  if(!IsActive(uId))
+    return false;
+
+  const Sample &last = GetLast(m_tracks[uId]);
+  x = last.x;
+  y = last.y;
+
+  if(m_config.fGain == 0.0f || timeAt <= last.time)
+    return true;
+
+  float fVx, fVy;
+  GetVelocity(uId, fVx, fVy);
+
+  uint64_t ahead = timeAt - last.time;
+  if(ahead > m_config.uMaxAheadUs)
+    ahead = m_config.uMaxAheadUs;
+
+  float fAhead = (float)ahead * 1e-6f * m_config.fGain;
+  x = (int16_t)(last.x + fVx * fAhead + 0.5f);
+  y = (int16_t)(last.y + fVy * fAhead + 0.5f);
+  return true;
+}
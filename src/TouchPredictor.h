@@ -0,0 +1,83 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+#include "FT6236.h"
+
+// TouchPredictor
+//  Keeps the recent samples of each touch and extrapolates where the finger will be at a
+//  given time, usually when the rows being drawn are next sent to the panel, so what is
+//  drawn lands under the finger rather than where it was a frame or more ago.
+//
+//  Every event read since the last frame is added, not just the last, and the velocity is
+//  a least squares fit over the samples in the last uWindowUs. A gain of 0 turns prediction
+//  off and gives the latest sample.
+//
+//  Each frame:
+//    touch.Update([&](const FT6236::Event &event) { predictor.Add(event); });
+//    predictor.Predict(id, time, x, y)
+class TouchPredictor
+{
+public:
+  struct Config
+  {
+    float    fGain = 1.0f;         // fraction of the extrapolated movement used
+    uint32_t uMaxAheadUs = 40000;  // never predict further ahead than this
+    uint32_t uWindowUs = 50000;    // samples older than this are not used for the velocity
+  };
+
+  TouchPredictor(void) = default;
+  TouchPredictor(const Config &config) : m_config(config)
+  {
+  }
+
+  const Config &GetConfig(void) const
+  {
+    return m_config;
+  }
+
+  void SetConfig(const Config &config)
+  {
+    m_config = config;
+  }
+
+  // Add a sample, a touch going down starts a new history
+  void Add(const FT6236::Event &event);
+
+  bool IsActive(uint8_t uId) const
+  {
+    return uId < FT6236::c_uMaxTouches && m_tracks[uId].bActive;
+  }
+
+  // Position predicted for timeAt, false if the touch is not down
+  bool Predict(uint8_t uId, uint64_t timeAt, int16_t &x, int16_t &y) const;
+
+  // Velocity in pixels per second from the recent samples, false if the touch is not down
+  bool GetVelocity(uint8_t uId, float &fVx, float &fVy) const;
+
+private:
+  static const uint8_t c_uHistory = 8;
+
+  struct Sample
+  {
+    uint64_t time;
+    int16_t  x;
+    int16_t  y;
+  };
+
+  struct Track
+  {
+    bool     bActive;
+    uint8_t  uCount;
+    uint8_t  uNext;
+    Sample   samples[c_uHistory];
+  };
+
+  const Sample &GetLast(const Track &track) const
+  {
+    return track.samples[(track.uNext + c_uHistory - 1) % c_uHistory];
+  }
+
+  Config m_config;
+  Track  m_tracks[FT6236::c_uMaxTouches] = {};
+};
@@ -0,0 +1,236 @@
+// ******************************************************************************
+// This host tool replays touch strokes through TouchPredictor and reports how far
+// the predicted positions are from where the finger really was, to tune the
+// prediction without a Presto.
+//
+// Each sample is added as FT6236 would report it and the position is then
+// predicted some time ahead, as the examples do for the next scan-out of the rows
+// being drawn, and compared with the stroke at that time. Gain 0, drawing at the
+// last sample read, is reported alongside the gain being tried.
+//
+// Usage:
+//   TouchReplay [gain] [script]
+//
+// With a script, in the PRESTO_TOUCH_SCRIPT format, each frame is taken as a
+// sample at SAMPLE_INTERVAL_US and the stroke between samples as a straight line.
+// Without one a few strokes are made up: a circle, a flick that slows down and a
+// zigzag, sampled with a pixel of noise like the FT6236.
+//
+// On the made up strokes, with any gain but 0, the predicted mean error has to be
+// below the last sample's at every horizon up to uMaxAheadUs, else the tool exits
+// with 1. A script is only reported.
+// ******************************************************************************
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "TouchPredictor.h"
+
+#define SAMPLE_INTERVAL_US 10000
+
+// How far ahead to predict, from the sample just read
+static const uint32_t horizonsUs[] = {8000, 16000, 33000};
+static const uint32_t horizonCount = sizeof(horizonsUs) / sizeof(horizonsUs[0]);
+
+struct Sample
+{
+  uint64_t time;
+  float    x;
+  float    y;
+};
+
+typedef std::vector<Sample> Stroke;
+
+struct ErrorStats
+{
+  double   dSum = 0.0;
+  float    fMax = 0.0f;
+  uint32_t uCount = 0;
+
+  void Add(float fError)
+  {
+    dSum += fError;
+    if(fError > fMax)
+      fMax = fError;
+    uCount++;
+  }
+};
+
+static bool LoadScript(const char *pPath, std::vector<Stroke> &strokes)
+{
+  FILE *pFile = fopen(pPath, "r");
+  if(!pFile)
+    return false;
+
+  Stroke stroke;
+  char line[128];
+  while(fgets(line, sizeof(line), pFile))
+  {
+    unsigned uFrame, uId;
+    int x, y;
+    char up[8];
+
+    // only touch 0 is replayed
+    if(sscanf(line, "%u %u %d %d", &uFrame, &uId, &x, &y) == 4 && uId == 0)
+      stroke.push_back({(uint64_t)uFrame * SAMPLE_INTERVAL_US, (float)x, (float)y});
+    else if(sscanf(line, "%u %u %7s", &uFrame, &uId, up) == 3 && uId == 0 && strcmp(up, "up") == 0 && !stroke.empty())
+    {
+      strokes.push_back(stroke);
+      stroke.clear();
+    }
+  }
+  fclose(pFile);
+
+  if(!stroke.empty())
+    strokes.push_back(stroke);
+  return true;
+}
+
+// A path through time, position in pixels for a time in seconds
+typedef void (*PathFn)(float t, float &x, float &y);
+
+static void Circle(float t, float &x, float &y)
+{
+  x = 240.0f + 150.0f * cosf(t * 6.0f);
+  y = 240.0f + 150.0f * sinf(t * 6.0f);
+}
+
+static void Flick(float t, float &x, float &y)
+{
+  float d = 400.0f * (1.0f - expf(-t * 4.0f));
+  x = 40.0f + d;
+  y = 60.0f + d * 0.75f;
+}
+
+static void Zigzag(float t, float &x, float &y)
+{
+  float phase = fmodf(t * 2.0f, 2.0f);
+  x = 40.0f + t * 200.0f;
+  y = 100.0f + 250.0f * (phase < 1.0f ? phase : 2.0f - phase);
+}
+
+static Stroke MakeStroke(PathFn fnPath, float fSeconds, uint64_t start)
+{
+  Stroke stroke;
+  for(uint64_t t = 0; t <= fSeconds * 1e6f; t += SAMPLE_INTERVAL_US)
+  {
+    float x, y;
+    fnPath(t * 1e-6f, x, y);
+    stroke.push_back({start + t, x, y});
+  }
+  return stroke;
+}
+
+// Where the stroke was at a time, between samples it moves in a straight line
+static bool StrokeAt(const Stroke &stroke, uint64_t time, float &x, float &y)
+{
+  for(size_t i = 1; i < stroke.size(); i++)
+  {
+    if(stroke[i].time >= time)
+    {
+      const Sample &a = stroke[i - 1];
+      const Sample &b = stroke[i];
+      float f = (float)(time - a.time) / (float)(b.time - a.time);
+      x = a.x + (b.x - a.x) * f;
+      y = a.y + (b.y - a.y) * f;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void Replay(const std::vector<Stroke> &strokes, const TouchPredictor::Config &config, bool bNoise, ErrorStats *pStats)
+{
+  TouchPredictor predictor(config);
+
+  for(const Stroke &stroke : strokes)
+  {
+    for(size_t i = 0; i < stroke.size(); i++)
+    {
+      const Sample &sample = stroke[i];
+
+      FT6236::Event event;
+      event.time = sample.time;
+      event.id = 0;
+      event.state = i == 0 ? STATE_DOWN : STATE_CONTACT;
+      event.x = (int16_t)lroundf(sample.x) + (bNoise ? rand() % 3 - 1 : 0);
+      event.y = (int16_t)lroundf(sample.y) + (bNoise ? rand() % 3 - 1 : 0);
+      predictor.Add(event);
+
+      for(uint32_t h = 0; h < horizonCount; h++)
+      {
+        float fTrueX, fTrueY;
+        if(!StrokeAt(stroke, sample.time + horizonsUs[h], fTrueX, fTrueY))
+          continue;
+
+        int16_t x, y;
+        predictor.Predict(0, sample.time + horizonsUs[h], x, y);
+        pStats[h].Add(hypotf(x - fTrueX, y - fTrueY));
+      }
+    }
+
+    FT6236::Event up = {stroke.back().time, 0, STATE_UP, 0, 0};
+    predictor.Add(up);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<Stroke> strokes;
+  bool bNoise = true;
+
+  if(argc > 2)
+  {
+    if(!LoadScript(argv[2], strokes))
+    {
+      fprintf(stderr, "cannot open touch script %s\n", argv[2]);
+      return 1;
+    }
+    bNoise = false;
+  }
+  else
+  {
+    strokes.push_back(MakeStroke(Circle, 2.0f, 0));
+    strokes.push_back(MakeStroke(Flick, 1.0f, 3000000));
+    strokes.push_back(MakeStroke(Zigzag, 1.5f, 5000000));
+  }
+
+  TouchPredictor::Config config;
+  if(argc > 1)
+    config.fGain = strtof(argv[1], nullptr);
+
+  TouchPredictor::Config noPrediction = config;
+  noPrediction.fGain = 0.0f;
+
+  ErrorStats lastStats[horizonCount];
+  ErrorStats predictedStats[horizonCount];
+
+  // the same noise for both
+  srand(1);
+  Replay(strokes, noPrediction, bNoise, lastStats);
+  srand(1);
+  Replay(strokes, config, bNoise, predictedStats);
+
+  printf("%zu strokes, gain %.2f, at most %u us ahead over a %u us window\n", strokes.size(), config.fGain, config.uMaxAheadUs, config.uWindowUs);
+  printf("ahead ms   last sample mean/max px   predicted mean/max px\n");
+  uint32_t uFailures = 0;
+  for(uint32_t h = 0; h < horizonCount; h++)
+  {
+    double dLastMean = lastStats[h].uCount ? lastStats[h].dSum / lastStats[h].uCount : 0.0;
+    double dPredictedMean = predictedStats[h].uCount ? predictedStats[h].dSum / predictedStats[h].uCount : 0.0;
+    printf("%8.1f   %10.1f %10.1f        %10.1f %10.1f\n", horizonsUs[h] / 1000.0f,
+           dLastMean, lastStats[h].fMax, dPredictedMean, predictedStats[h].fMax);
+
+    // bNoise is only set for the made up strokes, which should be easier to predict than to lag
+    if(bNoise && config.fGain != 0.0f && horizonsUs[h] <= config.uMaxAheadUs &&
+       (!predictedStats[h].uCount || dPredictedMean >= dLastMean))
+    {
+      printf("FAIL predicting %u us ahead is no better than the last sample\n", (unsigned)horizonsUs[h]);
+      uFailures++;
+    }
+  }
+  return uFailures ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "DamageDoubleBuffer.h"
+#include "SpscQueue.h"
+
+// TripleBufferOf
+//  Three back buffers passed between a renderer and the display through two lock
+//  free queues, so the renderer only waits when all three buffers are in use. A frame
+//  that takes longer than the refresh interval just misses one vsync rather than
+//  holding the renderer until the next one, so the frame rate drops smoothly instead
+//  of snapping to half the refresh rate.
+//
+//  Every buffer is in exactly one place: being drawn, waiting in the ready queue, waiting
+//  to be latched by the display, being displayed, or in the free queue. Like the
+//  modeClear DamageDoubleBuffer, each buffer remembers the spans drawn into it and only
+//  those are cleared when it is reused.
+//
+//  PIXEL is uint16_t for RGB565 buffers, TripleBuffer, or uint8_t for P8 buffers shown
+//  through a PaletteExpander, TripleBufferP8. RepairAsync() is only for RGB565.
+//
+//  Renderer (core 0), each frame:
+//    Acquire()      - wait for a free buffer and draw into it
+//    Repair()       - clear what was last drawn into it, or RepairAsync() with DMA
+//    AddDamage()    - for everything drawn
+//    Present()      - queue it for display
+//
+//  Display (core 1), each vsync:
+//    Latch()        - as soon as wait_for_vsync() returns, pass the result to set_backbuffer(),
+//                     or for P8 to PaletteExpander::Expand()
+template<typename PIXEL> class TripleBufferOf
+{
+public:
+  // pBuffer0 is the buffer being displayed to start with
+  TripleBufferOf(uint16_t uWidth, uint16_t uHeight, PIXEL *pBuffer0, PIXEL *pBuffer1, PIXEL *pBuffer2, PIXEL uClearColour = 0)
+    : m_uClearColour(uClearColour), m_trackers{{uWidth, uHeight}, {uWidth, uHeight}, {uWidth, uHeight}}
+  {
+    m_pBuffers[0] = pBuffer0;
+    m_pBuffers[1] = pBuffer1;
+    m_pBuffers[2] = pBuffer2;
+
+    m_free.Push(1);
+    m_free.Push(2);
+  }
+
+  // Renderer: take a free buffer to draw into, only waits if all three buffers are in use
+  PIXEL *Acquire(void)
+  {
+    while(!m_free.Pop(m_uBack))
+      tight_loop_contents();
+
+    return m_pBuffers[m_uBack];
+  }
+
+  PIXEL *GetBackBuffer(void) const
+  {
+    return m_pBuffers[m_uBack];
+  }
+
+  // Renderer: record a rectangle drawn into the acquired buffer
+  void AddDamage(const pimoroni::Rect &r)
+  {
+    m_trackers[m_uBack].Add(r);
+  }
+
+  // Renderer: clear what was last drawn into the acquired buffer, returns the number of bytes written
+  size_t Repair(void)
+  {
+    size_t uBytes = m_trackers[m_uBack].Clear(m_pBuffers[m_uBack], m_uClearColour);
+    m_trackers[m_uBack].Reset();
+    return uBytes;
+  }
+
+  // As Repair() but the spans are queued on a PsramDma, wait on the fence returned before drawing
+  PsramDma::Fence RepairAsync(PsramDma &dma)
+  {
+    PsramDma::Fence fence = m_trackers[m_uBack].ClearAsync(dma, m_pBuffers[m_uBack], m_uClearColour);
+    m_trackers[m_uBack].Reset();
+    return fence;
+  }
+
+  // Renderer: the acquired buffer is finished, display it from the next vsync it is latched at
+  void Present(void)
+  {
+    // never full, there are only three buffers
+    m_ready.Push(m_uBack);
+  }
+
+  // Display: call straight after each vsync, returns the buffer to pass to set_backbuffer().
+  // The buffer latched at this vsync is now displayed so the one it replaced is freed, and the
+  // newest presented frame is chosen for the next vsync. Older presented frames are dropped.
+  PIXEL *Latch(void)
+  {
+    if(m_uPending != c_uNone)
+    {
+      m_free.Push(m_uDisplayed);
+      m_uDisplayed = m_uPending;
+      m_uPending = c_uNone;
+    }
+
+    uint8_t uIndex;
+    while(m_ready.Pop(uIndex))
+    {
+      if(m_uPending != c_uNone)
+      {
+        m_free.Push(m_uPending);
+        m_uDropped = m_uDropped + 1;
+      }
+      m_uPending = uIndex;
+    }
+
+    return m_pBuffers[m_uPending != c_uNone ? m_uPending : m_uDisplayed];
+  }
+
+  // Frames presented but replaced by a newer frame before they were displayed
+  uint32_t GetDroppedCount(void) const
+  {
+    return m_uDropped;
+  }
+
+private:
+  static const uint8_t c_uNone = 0xff;
+
+  PIXEL                  m_uClearColour;
+  PIXEL                  *m_pBuffers[3];
+  DamageTracker          m_trackers[3];
+
+  SpscQueue<uint8_t, 4>  m_ready;                 // renderer to display, presented frames
+  SpscQueue<uint8_t, 4>  m_free;                  // display to renderer, buffers to draw into
+
+  uint8_t                m_uBack = c_uNone;       // renderer only
+  uint8_t                m_uDisplayed = 0;        // display only
+  uint8_t                m_uPending = c_uNone;    // display only, set_backbuffer() but not yet latched
+  volatile uint32_t      m_uDropped = 0;
+};
+
+typedef TripleBufferOf<uint16_t> TripleBuffer;
+typedef TripleBufferOf<uint8_t>  TripleBufferP8;
@@ -0,0 +1,212 @@
+// ******************************************************************************
+// This example shows three back buffers stored in PSRAM with
+// the Presto running at 480x480 and using the ST7701Cached class.
+//
+// With two back buffers the renderer hands the finished buffer over with
+// set_backbuffer() and then has to wait in wait_for_vsync() before it can draw
+// into the other one. A frame that takes just over the refresh interval then
+// waits for a whole extra refresh and the frame rate halves.
+//
+// Here TripleBuffer passes three back buffers between core 0, which draws, and
+// core 1, which waits for each vsync and latches the newest finished frame.
+// The buffers move through lock free single producer single consumer queues, so
+// core 0 only waits when all three buffers are in use and slow frames just
+// miss a vsync, the frame rate drops smoothly rather than in steps.
+//
+// This example bounces some boxes around, touch the screen to change how many,
+// near the top for fewer and near the bottom for more. Each back buffer remembers
+// which rows were drawn into it and only clears those spans before the next draw.
+//
+// Note: A summary of the phase timings and fps is logged to the USB UART every
+//       128 frames by FrameProfiler, the frames themselves are only timed. The
+//       PsramArena line after it shows the bytes the rectangles drawn each frame
+//       took from the arena, and the most any frame took.
+// ******************************************************************************
+
+#include "libraries/pico_graphics/pico_graphics.hpp"
+#include "drivers/st7701/st7701Cached.hpp"
+#include "pico/multicore.h"
+
+#include "PicoPlusPsram.h"
+#include "PsramArena.h"
+#include "TripleBuffer.h"
+#include "PsramDma.h"
+#include "ParticleSystem.h"
+#include "Elapsed.h"
+#include "FT6236.h"
+
+using namespace pimoroni;
+
+#define FRAME_WIDTH 480
+#define FRAME_HEIGHT 480
+
+static const uint BACKLIGHT = 45;
+static const uint LCD_CLK = 26;
+static const uint LCD_CS = 28;
+static const uint LCD_DAT = 27;
+static const uint LCD_DC = -1;
+static const uint LCD_D0 = 1;
+
+#define PIX_WH 16
+#define BLOCK_COUNT 100
+#define MAX_BLOCK_COUNT 2000
+
+// USE_DMA 0 = clear with the CPU, 1 = clear with DMA while the blocks are updated
+#define USE_DMA 1
+
+// Phases timed each frame, the names match the log
+enum { phaseAcquire, phaseUpdate, phaseClear, phaseDraw, phaseCount };
+static const char * const phaseNames[phaseCount] = {"Q", "U", "C", "D"};
+
+FT6236 touchDisplay;
+
+uint16_t                *back_buffers[3]; // Three back buffers to use
+TripleBuffer            *buffers;         // Passes them between the cores
+ST7701Cached            *presto;          // Sends data to the display
+ParticleSystem          *blocks;          // The boxes, moved in fixed point
+PicoGraphics_PenRGB565  *graphics;        // We draw with this
+#if USE_DMA
+PsramDma                *dma;             // Clears the back buffers
+#endif
+
+// Core 1 latches the newest finished frame at each vsync
+void core1_present()
+{
+  while (true)
+  {
+    presto->wait_for_vsync();
+    presto->set_backbuffer(buffers->Latch());
+  }
+}
+
+int main()
+{
+  // run as 266mhz, twice the speed of the Psram
+  set_sys_clock_khz(266000, true);
+  stdio_init_all();
+
+  // Display available Psram
+  PicoPlusPsram &ps = PicoPlusPsram::getInstance();
+  size_t uMemorySize = ps.GetMemorySize();
+  printf("PSRAM = %x\n", uMemorySize);
+
+  // Set up the chip select
+  gpio_init(LCD_CS);
+  gpio_put(LCD_CS, 1);
+  gpio_set_dir(LCD_CS, 1);
+
+  // allocate 480x480 back buffers in psram, use uncached address
+  {
+    PsramTrace::Scope tag("framebuffers");
+    for (int i = 0; i < 3; i++)
+      back_buffers[i] = (uint16_t *)ps.GetUncachedAddress(ps.Malloc(FRAME_WIDTH * FRAME_HEIGHT * 2, PicoPlusPsram::heapFrame));
+  }
+
+  // take the region for per frame allocations now, rather than part way through the first frame
+  PsramArena &arena = PsramArena::getInstance();
+
+  // Use the ST7701Cached presto object, this works by providing the back_buffer it whould use to send to the display
+  presto = new ST7701Cached(FRAME_WIDTH, FRAME_HEIGHT, ROTATE_0, SPIPins{spi1, LCD_CS, LCD_CLK, LCD_DAT, PIN_UNUSED, LCD_DC, BACKLIGHT}, (uint16_t *)back_buffers[0]);
+
+  // back_buffers[0] is displayed first, the other two are free to draw into
+  buffers = new TripleBuffer(FRAME_WIDTH, FRAME_HEIGHT, back_buffers[0], back_buffers[1], back_buffers[2]);
+
+  // picographics draws into whichever buffer is acquired each frame
+  graphics = new PicoGraphics_PenRGB565(FRAME_WIDTH, FRAME_HEIGHT, (uint16_t *)back_buffers[1]);
+
+#if USE_DMA
+  dma = new PsramDma();
+#endif
+
+  // Init the ST7701 display and clear back buffers
+  presto->init();
+  for (int i = 0; i < 3; i++)
+    memset(back_buffers[i], 0, FRAME_WIDTH * FRAME_HEIGHT * 2);
+
+  // inititalise blocks, kept in SRAM as fixed point
+  blocks = new ParticleSystem(MAX_BLOCK_COUNT, graphics->bounds.w - PIX_WH, graphics->bounds.h - PIX_WH);
+  for (int i = 0; i < MAX_BLOCK_COUNT; i++)
+  {
+    float x = rand() % (graphics->bounds.w - PIX_WH);
+    float y = rand() % (graphics->bounds.h - PIX_WH);
+
+    float dx = float(rand() % 255) / 64.0f;
+    float dy = float(rand() % 255) / 64.0f;
+    uint16_t use_pen = graphics->create_pen(rand() % 255, rand() % 255, rand() % 255);
+    blocks->Add(x, y, dx, dy, use_pen);
+  }
+  size_t block_count = BLOCK_COUNT;
+
+  // read touches in the background when the controller signals
+  touchDisplay.EnableInterrupt();
+
+  // hand vsyncs over to core 1
+  multicore_launch_core1(core1_present);
+
+  // Used for timings
+  FrameProfiler<phaseCount> profiler(phaseNames, 0);
+  uint32_t frame_count = 0;
+
+  while (true)
+  {
+    profiler.BeginFrame();
+
+    // take a free back buffer, this only waits when all three are in use
+    graphics->set_framebuffer(buffers->Acquire());
+    profiler.Lap(phaseAcquire);
+
+#if USE_DMA
+    // start clearing the spans drawn into this back buffer the last time it was used, the update runs while it clears
+    PsramDma::Fence clearFence = buffers->RepairAsync(*dma);
+#endif
+
+    // touch sets the number of boxes
+    touchDisplay.Update();
+    const FT6236::Touch &touch0 = touchDisplay.GetTouch(0);
+    if (touch0.active)
+      block_count = 1 + (MAX_BLOCK_COUNT - 1) * touch0.y / (FRAME_HEIGHT - 1);
+
+    // update the blocks shown
+    blocks->Update(block_count);
+    profiler.Lap(phaseUpdate);
+
+#if USE_DMA
+    // wait for the clear to finish
+    dma->Wait(clearFence);
+#else
+    // clear the spans drawn into this back buffer the last time it was used
+    buffers->Repair();
+#endif
+    profiler.Lap(phaseClear);
+
+    // draw blocks, their rectangles are gathered first in memory that only lives for this
+    // frame, however many touch asks for
+    {
+      std::vector<Rect, PsramArena::Allocator<Rect>> rects;
+      rects.reserve(block_count);
+      for (size_t i = 0; i < block_count; i++)
+        rects.push_back(Rect(blocks->GetX(i), blocks->GetY(i), PIX_WH, PIX_WH));
+
+      for (size_t i = 0; i < rects.size(); i++)
+      {
+        graphics->set_pen(blocks->GetPen(i));
+        graphics->rectangle(rects[i]);
+        buffers->AddDamage(rects[i]);
+      }
+    }
+    profiler.Lap(phaseDraw);
+
+    // queue it for core 1 to display, memory allocated for this frame is released
+    buffers->Present();
+    arena.Reset();
+
+    profiler.EndFrame();
+    if ((++frame_count & 127) == 0)
+    {
+      profiler.Report();
+      PsramArena::Stats arenaStats = arena.GetStats();
+      printf("arena last=%u high=%u of %u overflows=%u\n", (unsigned)arenaStats.uLastFrameBytes,
+             (unsigned)arenaStats.uHighWater, (unsigned)arenaStats.uArenaBytes, (unsigned)arenaStats.uOverflowCount);
+    }
+  }
+}
@@ -0,0 +1,127 @@
+#include <string.h>
+
+#include "hardware/interp.h"
+
+#include "Upscaler.h"
+
+Upscaler::Upscaler(uint16_t uWidth, uint16_t uHeight, uint8_t uScale, uint16_t *pScanout, PsramDma *pDma,
+                   const ScanlineEstimator *pEstimator)
+  : m_uWidth(uWidth), m_uHeight(uHeight), m_uScale(uScale), m_uScanoutWidth(uWidth * uScale), m_pScanout(pScanout), m_pDma(pDma),
+    m_pEstimator(pEstimator)
+{
+  m_pSrcLines[0] = new uint16_t[uWidth];
+  m_pSrcLines[1] = new uint16_t[uWidth];
+  m_pLines[0] = new uint16_t[m_uScanoutWidth];
+  m_pLines[1] = new uint16_t[m_uScanoutWidth];
+}
+
+Upscaler::~Upscaler(void)
+{
+  delete[] m_pSrcLines[0];
+  delete[] m_pSrcLines[1];
+  delete[] m_pLines[0];
+  delete[] m_pLines[1];
+}
+
+bool Upscaler::Upscale(const uint16_t *pFrame)
+{
+  if(pFrame == m_pLastFrame)
+    return false;
+
+  uint64_t startTime = time_us_64();
+
+  // Lane 0 steps the source position by 1 / scale of a pixel per pop, shifted and masked
+  // to a byte offset that the full result adds to the row address in base 2
+  interp_config config = interp_default_config();
+  interp_config_set_add_raw(&config, true);
+  interp_config_set_shift(&config, c_uFractionBits - 1);
+  interp_config_set_mask(&config, 1, 16);
+  interp_set_config(interp0, 0, &config);
+
+  config = interp_default_config();
+  interp_set_config(interp0, 1, &config);
+  interp0->accum[1] = 0;
+  interp0->base[1] = 0;
+  interp0->base[0] = (1u << c_uFractionBits) / m_uScale;
+
+  // rows are timed from the start of the frame being sent now, before calibration they are not held back
+  bool bBehindBeam = m_pEstimator && m_pEstimator->IsCalibrated();
+  uint32_t uPeriodUs = bBehindBeam ? m_pEstimator->GetFramePeriodUs() : 0;
+  uint32_t uTotalLines = bBehindBeam ? m_pEstimator->GetTotalLines() : 1;
+  uint64_t frameStart = 0;
+  if(bBehindBeam)
+  {
+    uint64_t lastVsyncTime = m_pEstimator->GetLastVsyncTime();
+    frameStart = lastVsyncTime + ((startTime - lastVsyncTime) / uPeriodUs) * uPeriodUs;
+  }
+  uint32_t uLateRows = 0;
+
+  // the first source row is read in before the loop, each pass reads the next
+  PsramDma::Fence srcFence = 0;
+  if(m_pDma)
+    srcFence = m_pDma->Copy(m_pSrcLines[0], pFrame, m_uWidth);
+
+  for(uint16_t y = 0; y < m_uHeight; y++)
+  {
+    uint16_t *pSrcLine = m_pSrcLines[y & 1];
+    uint16_t *pLine = m_pLines[y & 1];
+    uint16_t uFirstRow = y * m_uScale;
+    uint16_t *pDst = m_pScanout + uFirstRow * m_uScanoutWidth;
+
+    if(m_pDma)
+    {
+      // read the next source row in while this one is widened
+      m_pDma->Wait(srcFence);
+      if(y + 1 < m_uHeight)
+        srcFence = m_pDma->Copy(m_pSrcLines[(y + 1) & 1], pFrame + (y + 1) * m_uWidth, m_uWidth);
+
+      // the line was last written out two source rows ago
+      m_pDma->Wait(m_lineFences[y & 1]);
+      WidenRow(pSrcLine, pLine);
+    }
+    else
+    {
+      memcpy(pSrcLine, pFrame + y * m_uWidth, m_uWidth * 2);
+      WidenRow(pSrcLine, pLine);
+    }
+
+    if(bBehindBeam)
+    {
+      // wait for the beam to leave the block of rows, late if it has come back round to its first row
+      uint64_t blockTime = frameStart + ((uint64_t)(uFirstRow + m_uScale) * uPeriodUs) / uTotalLines;
+      uint64_t timeNow;
+      while((timeNow = time_us_64()) < blockTime)
+        tight_loop_contents();
+      if(timeNow >= frameStart + uPeriodUs + ((uint64_t)uFirstRow * uPeriodUs) / uTotalLines)
+        uLateRows += m_uScale;
+    }
+
+    for(uint8_t uRow = 0; uRow < m_uScale; uRow++)
+    {
+      if(m_pDma)
+        m_lineFences[y & 1] = m_pDma->Copy(pDst + uRow * m_uScanoutWidth, pLine, m_uScanoutWidth);
+      else
+        memcpy(pDst + uRow * m_uScanoutWidth, pLine, m_uScanoutWidth * 2);
+    }
+  }
+
+  if(m_pDma)
+    m_pDma->Wait(m_pDma->GetLastFence());
+
+  m_pLastFrame = pFrame;
+  m_uUpscaleUs = (uint32_t)(time_us_64() - startTime);
+  m_uLateRows = uLateRows;
+  return true;
+}
+
+// Each pop gives the address of the source pixel for the next output pixel, sampled at
+// the output pixel's centre so the 1 / scale step rounding never picks the pixel before.
+// pSrc is the SRAM copy of the row, so the reads stay off the psram bus
+void Upscaler::WidenRow(const uint16_t *pSrc, uint16_t *pDst) const
+{
+  interp0->accum[0] = (1u << c_uFractionBits) / (2 * m_uScale);
+  interp0->base[2] = (uintptr_t)pSrc;
+
+  for(uint16_t x = 0; x < m_uScanoutWidth; x++)
+    pDst[x] = *(const uint16_t *)interp0->pop[2];
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "PsramDma.h"
+#include "BeamRacer.h"
+
+// Upscaler
+//  Shows a low resolution RGB565 back buffer, for example 240x240, on the 480x480 panel
+//  by scaling each new frame up by a whole number into the one buffer ST7701Cached scans
+//  out, so drawing and clearing touch a quarter of the pixels at a scale of 2.
+//
+//  The frame is scaled from the top down. Each source row is read from psram into SRAM in
+//  one burst, with pDma while the row before is widened if one is given, so the
+//  interpolator's per pixel reads never go over the psram bus. The row is widened into an
+//  SRAM line with the interpolator stepping through the source pixels, then the line is
+//  written out as a block of uScale rows of the scan-out buffer. A frame that is shown
+//  again is not scaled again.
+//
+//  Given a calibrated ScanlineEstimator, a block is only written once the beam has left
+//  it in the frame being sent when Upscale() is called, so the new frame is shown whole
+//  from the next vsync. Upscale() returns as the beam leaves the last row, only call it
+//  again after the next vsync. Rows the beam comes back round to before they are written
+//  would tear and are counted by GetLateRows(). Without an estimator the frame is scaled
+//  as fast as it can be, racing ahead of the beam, and tears wherever the panel catches
+//  up with it.
+//  Upscale() sets up interp0 of the core it runs on, so nothing else on that core can
+//  rely on interp0 keeping its state.
+//
+//  Display (core 1), each frame:
+//    OnVsync()      - on the estimator, as soon as wait_for_vsync() returns
+//    Upscale()      - with the frame to show, any time before the next vsync
+class Upscaler
+{
+public:
+  // uWidth and uHeight are the size of the frames, the scan-out buffer is uScale times
+  // both. Rows are read in and written out with pDma if one is given, while the next row
+  // is widened, and behind the beam pEstimator is following if one is given.
+  Upscaler(uint16_t uWidth, uint16_t uHeight, uint8_t uScale, uint16_t *pScanout, PsramDma *pDma = nullptr,
+           const ScanlineEstimator *pEstimator = nullptr);
+  ~Upscaler(void);
+
+  Upscaler(const Upscaler&) = delete;
+  Upscaler& operator = (const Upscaler&) = delete;
+
+  // Display: scale pFrame into the scan-out buffer if it changed, returns true if it was
+  bool Upscale(const uint16_t *pFrame);
+
+  // Time the last upscale took, including waiting for the beam
+  uint32_t GetUpscaleUs(void) const
+  {
+    return m_uUpscaleUs;
+  }
+
+  // Scan-out rows the last upscale wrote after the beam had come back round to them
+  uint32_t GetLateRows(void) const
+  {
+    return m_uLateRows;
+  }
+
+private:
+  void WidenRow(const uint16_t *pSrc, uint16_t *pDst) const;
+
+  // Source position is in 16.16 fixed point
+  static const uint32_t c_uFractionBits = 16;
+
+  uint16_t          m_uWidth;
+  uint16_t          m_uHeight;
+  uint8_t           m_uScale;
+  uint16_t          m_uScanoutWidth;
+  uint16_t          *m_pScanout;
+  PsramDma          *m_pDma;
+  const ScanlineEstimator *m_pEstimator;
+  uint16_t          *m_pSrcLines[2];                  // SRAM, source rows read from psram
+  uint16_t          *m_pLines[2];                     // SRAM, widened rows on their way to psram
+  PsramDma::Fence   m_lineFences[2] = {};
+
+  const uint16_t    *m_pLastFrame = nullptr;
+  volatile uint32_t m_uUpscaleUs = 0;
+  volatile uint32_t m_uLateRows = 0;
+};
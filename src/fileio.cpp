@@ -5,40 +5,45 @@
 #include "stdio.h"
 #include <stdlib.h>
 
+#include "BufferedFile.h"
+
+// Bytes read ahead at a time, rounded up to whole 512 byte sectors
+#ifndef FILEIO_CHUNK_SIZE
+#define FILEIO_CHUNK_SIZE 4096
+#endif
+
+// FILEIO_USE_PSRAM 0 = read ahead buffers in SRAM, 1 = in psram
+#ifndef FILEIO_USE_PSRAM
+#define FILEIO_USE_PSRAM 0
+#endif
+
 void* fileio_open(const char* filename) {
     printf("IMPL: Opening %s\n", filename);
-    FIL *fil = (FIL*)malloc(sizeof(FIL));
-    FRESULT fr = f_open(fil, filename, FA_READ);
-    if(fr == FR_OK) {
-        return (void *)fil;
+    BufferedFile *file = new BufferedFile(FILEIO_CHUNK_SIZE, FILEIO_USE_PSRAM);
+    if(file->Open(filename)) {
+        return (void *)file;
     } else {
-        free(fil);
+        delete file;
         return NULL;
     }
 }
 
 void fileio_close(void* fhandle) {
-    f_close((FIL*)fhandle);
-    free(fhandle);
+    delete (BufferedFile*)fhandle;
 }
 
 size_t fileio_read(void* fhandle, void *buf, size_t len) {
-    unsigned int bytes_read;
-    FRESULT fr = f_read((FIL*)fhandle, buf, len, &bytes_read);
-    return fr == FR_OK ? bytes_read : 0;
+    return ((BufferedFile*)fhandle)->Read(buf, len);
 }
 
 int fileio_getc(void* fhandle) {
-    unsigned char buf;
-    (void *)fileio_read(fhandle, (void*)&buf, (size_t)1);
-    return (int)buf;
+    return ((BufferedFile*)fhandle)->Getc();
 }
 
 size_t fileio_tell(void* fhandle) {
-    return f_tell((FIL*)fhandle);
+    return ((BufferedFile*)fhandle)->Tell();
 }
 
 size_t fileio_seek(void* fhandle, size_t pos) {
-    f_lseek((FIL*)fhandle, pos);
-    return f_tell((FIL*)fhandle);
-}
\ No newline at end of file
+    return ((BufferedFile*)fhandle)->Seek(pos);
+}
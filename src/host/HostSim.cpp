@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "hardware/spi.h"
+#include "hardware/i2c.h"
+
+#include "HostSim.h"
+
+// FT6236 i2c address, see FT6236.h
+#define TOUCH_ADDR (0x48)
+
+// Display dimensions used for fuzzed touches
+#define FUZZ_WIDTH  480
+#define FUZZ_HEIGHT 480
+
+i2c_inst_t *i2c0 = nullptr;
+i2c_inst_t *i2c1 = (i2c_inst_t *)&i2c1;
+spi_inst_t *spi0 = nullptr;
+spi_inst_t *spi1 = nullptr;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+uint64_t time_us_64(void)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void sleep_us(uint64_t us)
+{
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void sleep_ms(uint32_t ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+  if(addr != TOUCH_ADDR)
+    return -1;
+
+  HostSim::getInstance().TouchWrite(src, len);
+  return (int)len;
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler)
+{
+  HostSim::getInstance().SetTouchIrqHandler(handler);
+}
+
+void gpio_remove_raw_irq_handler(uint gpio, irq_handler_t handler)
+{
+  HostSim::getInstance().SetTouchIrqHandler(nullptr);
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+  if(addr != TOUCH_ADDR)
+    return -1;
+
+  HostSim::getInstance().TouchRead(dst, len);
+  return (int)len;
+}
+
+HostSim::HostSim(void)
+{
+  if(const char *pFrames = getenv("PRESTO_HOST_FRAMES"))
+    m_uFrameLimit = strtoul(pFrames, nullptr, 0);
+
+  m_pDumpPath = getenv("PRESTO_HOST_DUMP");
+
+  if(const char *pHz = getenv("PRESTO_HOST_VSYNC_HZ"))
+    m_uVsyncPeriodUs = 1000000 / std::max(strtoul(pHz, nullptr, 0), 1ul);
+
+  if(const char *pScript = getenv("PRESTO_TOUCH_SCRIPT"))
+    LoadTouchScript(pScript);
+  else if(const char *pSeed = getenv("PRESTO_TOUCH_FUZZ"))
+  {
+    srand(strtoul(pSeed, nullptr, 0));
+    m_bFuzz = true;
+  }
+}
+
+void HostSim::LoadTouchScript(const char *pPath)
+{
+  FILE *pFile = fopen(pPath, "r");
+  if(!pFile)
+  {
+    fprintf(stderr, "HOST: cannot open touch script %s\n", pPath);
+    exit(1);
+  }
+
+  std::vector<TouchEvent> events;
+  char line[128];
+  while(fgets(line, sizeof(line), pFile))
+  {
+    unsigned uFrame, uId;
+    int x, y;
+    char up[8];
+
+    if(line[0] == '#' || line[0] == '\n')
+      continue;
+
+    if(sscanf(line, "%u %u %d %d", &uFrame, &uId, &x, &y) == 4 && uId < c_uMaxTouches)
+      events.push_back({uFrame, (uint8_t)uId, true, (int16_t)x, (int16_t)y});
+    else if(sscanf(line, "%u %u %7s", &uFrame, &uId, up) == 3 && uId < c_uMaxTouches && strcmp(up, "up") == 0)
+      events.push_back({uFrame, (uint8_t)uId, false, 0, 0});
+    else
+      fprintf(stderr, "HOST: ignoring touch script line: %s", line);
+  }
+  fclose(pFile);
+
+  m_uTouchEventCount = events.size();
+  m_pTouchEvents = new TouchEvent[m_uTouchEventCount];
+  std::copy(events.begin(), events.end(), m_pTouchEvents);
+}
+
+// Apply the script or fuzzer for the current frame
+void HostSim::UpdateTouches(void)
+{
+  while(m_uNextTouchEvent < m_uTouchEventCount && m_pTouchEvents[m_uNextTouchEvent].uFrame <= m_uFrame)
+  {
+    const TouchEvent &event = m_pTouchEvents[m_uNextTouchEvent++];
+    TouchState &touch = m_touches[event.uId];
+    touch.bDown = event.bDown;
+    if(event.bDown)
+    {
+      touch.x = event.x;
+      touch.y = event.y;
+    }
+  }
+
+  if(m_bFuzz)
+  {
+    for(uint8_t i = 0; i < c_uMaxTouches; i++)
+    {
+      TouchState &touch = m_touches[i];
+      if((rand() % 16) == 0)
+      {
+        touch.bDown = !touch.bDown && (i == 0 || m_touches[0].bDown);
+        touch.x = rand() % FUZZ_WIDTH;
+        touch.y = rand() % FUZZ_HEIGHT;
+      }
+      else if(touch.bDown)
+      {
+        touch.x = std::min(std::max(touch.x + (rand() % 17) - 8, 0), FUZZ_WIDTH - 1);
+        touch.y = std::min(std::max(touch.y + (rand() % 17) - 8, 0), FUZZ_HEIGHT - 1);
+      }
+    }
+  }
+}
+
+void HostSim::Vsync(const uint16_t *pFrame, uint16_t uWidth, uint16_t uHeight)
+{
+  if(m_uVsyncPeriodUs)
+  {
+    // vsyncs keep to a fixed grid like the panel's, a late caller waits for the next one
+    uint64_t timeNow = time_us_64();
+    if(!m_nextVsyncTime)
+      m_nextVsyncTime = timeNow;
+    else if(m_nextVsyncTime < timeNow)
+      m_nextVsyncTime += ((timeNow - m_nextVsyncTime) / m_uVsyncPeriodUs + 1) * m_uVsyncPeriodUs;
+
+    if(m_nextVsyncTime > timeNow)
+      sleep_us(m_nextVsyncTime - timeNow);
+    m_nextVsyncTime += m_uVsyncPeriodUs;
+  }
+
+  m_pLastFrame = pFrame;
+  m_uWidth = uWidth;
+  m_uHeight = uHeight;
+  m_uFrame++;
+
+  UpdateTouches();
+
+  // FT6236 in trigger mode signals a report per scan while touched
+  bool bTouchDown = false;
+  for(uint8_t i = 0; i < c_uMaxTouches; i++)
+    bTouchDown |= m_touches[i].bDown;
+
+  if(m_touchIrqHandler && (bTouchDown || m_bTouchWasDown))
+    m_touchIrqHandler();
+  m_bTouchWasDown = bTouchDown;
+
+  if(m_uFrameLimit && m_uFrame >= m_uFrameLimit)
+  {
+    Finish();
+    exit(0);
+  }
+}
+
+// Report the checksum of the last frame and optionally dump it
+void HostSim::Finish(void)
+{
+  uint32_t uHash = 2166136261u;
+  size_t uPixels = (size_t)m_uWidth * m_uHeight;
+
+  for(size_t i = 0; i < uPixels; i++)
+  {
+    uHash = (uHash ^ (m_pLastFrame[i] & 0xff)) * 16777619u;
+    uHash = (uHash ^ (m_pLastFrame[i] >> 8)) * 16777619u;
+  }
+
+  printf("HOST: frames=%u checksum=%08x\n", m_uFrame, uHash);
+
+  if(m_pDumpPath)
+  {
+    FILE *pFile = fopen(m_pDumpPath, "wb");
+    if(!pFile)
+    {
+      fprintf(stderr, "HOST: cannot write %s\n", m_pDumpPath);
+      return;
+    }
+
+    fprintf(pFile, "P6\n%u %u\n255\n", m_uWidth, m_uHeight);
+    for(size_t i = 0; i < uPixels; i++)
+    {
+      // PicoGraphics RGB565 is stored byte swapped
+      uint16_t p = (uint16_t)((m_pLastFrame[i] << 8) | (m_pLastFrame[i] >> 8));
+      uint8_t rgb[3] = {(uint8_t)((p >> 8) & 0xf8), (uint8_t)((p >> 3) & 0xfc), (uint8_t)((p << 3) & 0xf8)};
+      fwrite(rgb, 1, 3, pFile);
+    }
+    fclose(pFile);
+  }
+}
+
+void HostSim::TouchWrite(const uint8_t *pData, size_t uLen)
+{
+  if(uLen)
+    m_uTouchReg = pData[0];
+}
+
+// Build an FT6236 register dump starting at the last register written
+void HostSim::TouchRead(uint8_t *pData, size_t uLen)
+{
+  uint8_t regs[16] = {};
+  uint8_t uCount = 0;
+
+  // unused touch slots report an id of 0xf
+  regs[0x05] = 0xf0;
+  regs[0x0b] = 0xf0;
+
+  for(uint8_t i = 0; i < c_uMaxTouches; i++)
+  {
+    const TouchState &touch = m_touches[i];
+    if(touch.bDown)
+    {
+      uint8_t *pSlot = regs + 0x03 + uCount * 6;
+      pSlot[0] = (0b10 << 6) | ((touch.x >> 8) & 0x0f);
+      pSlot[1] = touch.x & 0xff;
+      pSlot[2] = (i << 4) | ((touch.y >> 8) & 0x0f);
+      pSlot[3] = touch.y & 0xff;
+      uCount++;
+    }
+  }
+  regs[0x02] = uCount;
+
+  for(size_t i = 0; i < uLen; i++)
+    pData[i] = (m_uTouchReg + i) < sizeof(regs) ? regs[m_uTouchReg + i] : 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// HostSim
+//  Shared state behind the host stand-ins, configured from the environment:
+//
+//  PRESTO_HOST_FRAMES   exit after this many vsyncs, printing a checksum of the last frame
+//  PRESTO_HOST_DUMP     write the last frame to this file as a binary PPM on exit
+//  PRESTO_HOST_VSYNC_HZ pace vsyncs to a fixed grid at this rate, otherwise they run at full host speed
+//  PRESTO_TOUCH_SCRIPT  replay touches from this file, one per line:
+//                         <frame> <id> <x> <y>   touch id is down at x,y from frame on
+//                         <frame> <id> up        touch id is released from frame on
+//                       lines starting with # are ignored
+//  PRESTO_TOUCH_FUZZ    seed for random touches, used when there is no script
+class HostSim
+{
+public:
+  HostSim(const HostSim&) = delete;
+  HostSim& operator = (const HostSim&) = delete;
+
+  // Get singleton instance
+  static HostSim& getInstance()
+  {
+    static HostSim instance;
+    return instance;
+  }
+
+  // Called by ST7701Cached each vsync with the buffer now being displayed
+  void Vsync(const uint16_t *pFrame, uint16_t uWidth, uint16_t uHeight);
+
+  // Number of vsyncs so far
+  uint32_t GetFrame(void) const
+  {
+    return m_uFrame;
+  }
+
+  // FT6236 register access, answered from the touch state
+  void TouchWrite(const uint8_t *pData, size_t uLen);
+  void TouchRead(uint8_t *pData, size_t uLen);
+
+  // FT6236 TOUCH_INT handler, raised after each vsync while a touch is down or has just been released
+  void SetTouchIrqHandler(irq_handler_t handler)
+  {
+    m_touchIrqHandler = handler;
+  }
+
+private:
+  HostSim(void);
+  ~HostSim(void) = default;
+
+  struct TouchEvent
+  {
+    uint32_t uFrame;
+    uint8_t  uId;
+    bool     bDown;
+    int16_t  x;
+    int16_t  y;
+  };
+
+  struct TouchState
+  {
+    bool    bDown;
+    int16_t x;
+    int16_t y;
+  };
+
+  void LoadTouchScript(const char *pPath);
+  void UpdateTouches(void);
+  void Finish(void);
+
+  static const uint8_t c_uMaxTouches = 2;
+
+  uint32_t        m_uFrame = 0;
+  uint32_t        m_uFrameLimit = 0;
+  uint32_t        m_uVsyncPeriodUs = 0;
+  uint64_t        m_nextVsyncTime = 0;
+  const char      *m_pDumpPath = nullptr;
+  const uint16_t  *m_pLastFrame = nullptr;
+  uint16_t        m_uWidth = 0;
+  uint16_t        m_uHeight = 0;
+
+  TouchEvent      *m_pTouchEvents = nullptr;
+  size_t          m_uTouchEventCount = 0;
+  size_t          m_uNextTouchEvent = 0;
+  bool            m_bFuzz = false;
+  TouchState      m_touches[c_uMaxTouches] = {};
+  uint8_t         m_uTouchReg = 0;
+  irq_handler_t   m_touchIrqHandler = nullptr;
+  bool            m_bTouchWasDown = false;
+};
@@ -0,0 +1,57 @@
+#include "pico/stdlib.h"
+
+#include "PicoPlusPsram.h"
+
+// Emulated psram size, the same as fitted to the Presto
+#define HOST_PSRAM_SIZE (8 * 1024 * 1024)
+
+// The examples all run at 266MHz
+#define HOST_SYS_CLOCK_HZ 266000000
+
+// Private constructor
+PicoPlusPsram::PicoPlusPsram(void)
+{
+  // initialise psram
+  m_uMemorySize = Init(0);
+
+  if(m_uMemorySize)
+  {
+    static uint8_t *pMemory = (uint8_t *)malloc(m_uMemorySize);
+    AssignHeaps(pMemory, PSRAM_FRAME_HEAP_SIZE);
+  }
+}
+
+size_t PicoPlusPsram::Detect(void)
+{
+  return HOST_PSRAM_SIZE;
+}
+
+size_t PicoPlusPsram::Init(uint cs_pin)
+{
+  m_timing = PsramTiming::Default(HOST_SYS_CLOCK_HZ);
+  return Detect();
+}
+
+// There is no QMI to calibrate, the default timing is reported
+void PicoPlusPsram::SetSavedTiming(const PsramTiming &timing)
+{
+}
+
+// There is no XIP cache on the host, both views are the same memory
+void *PicoPlusPsram::GetUncachedAddress(void *pMem)
+{
+  return pMem;
+}
+
+void *PicoPlusPsram::GetCachedAddress(const void *pMem)
+{
+  return (void *)pMem;
+}
+
+void PicoPlusPsram::CleanCache(const void *pMem, size_t uSize)
+{
+}
+
+void PicoPlusPsram::InvalidateCache(const void *pMem, size_t uSize)
+{
+}
@@ -0,0 +1,52 @@
+#include <assert.h>
+
+#include "pico/stdlib.h"
+
+#include "PsramDma.h"
+
+// There is no DMA on the host, operations complete as they are queued
+
+PsramDma::PsramDma(uint16_t uQueueSize)
+{
+  assert(uQueueSize != 0 && (uQueueSize & (uQueueSize - 1)) == 0);
+
+  m_pOps = nullptr;
+  m_pBlocks = nullptr;
+  m_uQueueMask = uQueueSize - 1;
+}
+
+PsramDma::~PsramDma(void)
+{
+}
+
+PsramDma::Fence PsramDma::Fill(uint16_t *pDst, uint16_t uValue, uint32_t w, uint32_t h, uint32_t uStride)
+{
+  if(!uStride)
+    uStride = w;
+
+  for(uint32_t y = 0; y < h; y++)
+  {
+    uint16_t *pRow = pDst + y * uStride;
+    for(uint32_t x = 0; x < w; x++)
+      pRow[x] = uValue;
+  }
+
+  m_uTail = m_uTail + 1;
+  m_uHead = m_uTail;
+  return m_uTail;
+}
+
+PsramDma::Fence PsramDma::Copy(uint16_t *pDst, const uint16_t *pSrc, uint32_t w, uint32_t h, uint32_t uDstStride, uint32_t uSrcStride)
+{
+  if(!uDstStride)
+    uDstStride = w;
+  if(!uSrcStride)
+    uSrcStride = w;
+
+  for(uint32_t y = 0; y < h; y++)
+    memmove(pDst + y * uDstStride, pSrc + y * uSrcStride, w * 2);
+
+  m_uTail = m_uTail + 1;
+  m_uHead = m_uTail;
+  return m_uTail;
+}
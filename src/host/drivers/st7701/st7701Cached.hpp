@@ -0,0 +1,55 @@
+#pragma once
+
+// Host stand-in for ST7701Cached
+//  There is no panel, each vsync hands the buffer being displayed to HostSim
+//  which counts frames and can dump them. Runs at full host speed.
+
+#include "common/pimoroni_common.hpp"
+#include "common/pimoroni_bus.hpp"
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+#include "HostSim.h"
+
+namespace pimoroni {
+
+  class ST7701Cached
+  {
+  public:
+    ST7701Cached(uint16_t width, uint16_t height, Rotation rotation, SPIPins control_pins, uint16_t *framebuffer,
+                 uint d0 = 1, uint hsync = 19, uint vsync = 20, uint lcd_de = 21, uint lcd_dot_clk = 22)
+      : width(width), height(height), framebuffer(framebuffer), next_framebuffer(framebuffer)
+    {
+    }
+
+    void init()
+    {
+    }
+
+    void set_backlight(uint8_t brightness)
+    {
+    }
+
+    void update(PicoGraphics *graphics)
+    {
+    }
+
+    // Buffer to display from the next vsync
+    void set_backbuffer(uint16_t *next_fb)
+    {
+      next_framebuffer = next_fb;
+    }
+
+    void wait_for_vsync()
+    {
+      framebuffer = next_framebuffer;
+      HostSim::getInstance().Vsync(framebuffer, width, height);
+    }
+
+  private:
+    uint16_t width;
+    uint16_t height;
+    uint16_t *framebuffer;
+    uint16_t *next_framebuffer;
+  };
+
+}
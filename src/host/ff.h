@@ -0,0 +1,88 @@
+#pragma once
+
+// Host stand-in for the parts of FatFs used by the examples, files are read from the host
+// file system relative to the working directory
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int UINT;
+typedef uint8_t      BYTE;
+typedef char         TCHAR;
+typedef uint32_t     FSIZE_t;
+
+typedef enum
+{
+  FR_OK = 0,
+  FR_DISK_ERR,
+  FR_NO_FILE = 4,
+  FR_INVALID_PARAMETER = 19
+} FRESULT;
+
+#define FA_READ          0x01
+#define FA_WRITE         0x02
+#define FA_CREATE_ALWAYS 0x08
+
+typedef struct
+{
+  int dummy;
+} FATFS;
+
+typedef struct
+{
+  FILE    *pFile;
+  FSIZE_t fptr;
+  FSIZE_t size;
+} FIL;
+
+static inline FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt)
+{
+  return FR_OK;
+}
+
+static inline FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+  fp->pFile = fopen(path, (mode & FA_WRITE) ? "w+b" : "rb");
+  if(!fp->pFile)
+    return FR_NO_FILE;
+
+  fseek(fp->pFile, 0, SEEK_END);
+  fp->size = ftell(fp->pFile);
+  fseek(fp->pFile, 0, SEEK_SET);
+  fp->fptr = 0;
+  return FR_OK;
+}
+
+static inline FRESULT f_close(FIL *fp)
+{
+  fclose(fp->pFile);
+  fp->pFile = NULL;
+  return FR_OK;
+}
+
+static inline FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+  *br = fread(buff, 1, btr, fp->pFile);
+  fp->fptr += *br;
+  return ferror(fp->pFile) ? FR_DISK_ERR : FR_OK;
+}
+
+static inline FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+  *bw = fwrite(buff, 1, btw, fp->pFile);
+  fp->fptr += *bw;
+  if(fp->fptr > fp->size)
+    fp->size = fp->fptr;
+  return *bw == btw ? FR_OK : FR_DISK_ERR;
+}
+
+static inline FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+  if(fseek(fp->pFile, ofs, SEEK_SET) != 0)
+    return FR_INVALID_PARAMETER;
+  fp->fptr = ofs;
+  return FR_OK;
+}
+
+#define f_tell(fp) ((fp)->fptr)
+#define f_size(fp) ((fp)->size)
@@ -0,0 +1,42 @@
+#pragma once
+
+// Host stand-in for hardware/gpio.h, pins do nothing
+
+#include "pico.h"
+
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+#define GPIO_IRQ_LEVEL_LOW  0x1u
+#define GPIO_IRQ_LEVEL_HIGH 0x2u
+#define GPIO_IRQ_EDGE_FALL  0x4u
+#define GPIO_IRQ_EDGE_RISE  0x8u
+
+typedef void (*irq_handler_t)(void);
+
+enum gpio_function
+{
+  GPIO_FUNC_XIP_CS1 = 0,
+  GPIO_FUNC_SPI     = 1,
+  GPIO_FUNC_UART    = 2,
+  GPIO_FUNC_I2C     = 3,
+  GPIO_FUNC_PWM     = 4,
+  GPIO_FUNC_SIO     = 5,
+  GPIO_FUNC_PIO0    = 6,
+  GPIO_FUNC_NULL    = 0x1f,
+};
+
+static inline void gpio_init(uint gpio) {}
+static inline void gpio_put(uint gpio, bool value) {}
+static inline bool gpio_get(uint gpio) { return false; }
+static inline void gpio_set_dir(uint gpio, bool out) {}
+static inline void gpio_set_function(uint gpio, enum gpio_function fn) {}
+static inline void gpio_pull_up(uint gpio) {}
+static inline void gpio_disable_pulls(uint gpio) {}
+
+// Raw handlers are called by HostSim, only TOUCH_INT is raised
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler);
+void gpio_remove_raw_irq_handler(uint gpio, irq_handler_t handler);
+static inline void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {}
+static inline uint32_t gpio_get_irq_event_mask(uint gpio) { return GPIO_IRQ_EDGE_FALL; }
+static inline void gpio_acknowledge_irq(uint gpio, uint32_t event_mask) {}
@@ -0,0 +1,31 @@
+#pragma once
+
+// Host stand-in for hardware/i2c.h
+//  Transfers to the FT6236 address are answered by HostSim from the touch script
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t *i2c0;
+extern i2c_inst_t *i2c1;
+
+static inline uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+  return baudrate;
+}
+
+static inline void i2c_deinit(i2c_inst_t *i2c)
+{
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,108 @@
+#pragma once
+
+// Host stand-in for hardware/interp.h
+//  Each core has its own interp0 and interp1. The lanes shift, mask and add, with
+//  ADD_RAW, and reading pop writes both lane results back to the accumulators. Signed
+//  results and the cross input and cross result options are not modelled. The registers
+//  are pointer sized so base and result can hold host addresses.
+
+#include "pico/stdlib.h"
+
+#define SIO_INTERP0_CTRL_LANE0_SHIFT_LSB    0
+#define SIO_INTERP0_CTRL_LANE0_SHIFT_BITS   0x0000001fu
+#define SIO_INTERP0_CTRL_LANE0_MASK_LSB_LSB 5
+#define SIO_INTERP0_CTRL_LANE0_MASK_LSB_BITS 0x000003e0u
+#define SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB 10
+#define SIO_INTERP0_CTRL_LANE0_MASK_MSB_BITS 0x00007c00u
+#define SIO_INTERP0_CTRL_LANE0_ADD_RAW_BITS 0x00040000u
+
+typedef struct
+{
+  uint32_t ctrl;
+} interp_config;
+
+struct interp_hw_t
+{
+  // Reads of pop[] and peek[], lanes 0 and 1 and the full result 2
+  class Results
+  {
+  public:
+    Results(interp_hw_t *pInterp, bool bPop) : m_pInterp(pInterp), m_bPop(bPop)
+    {
+    }
+
+    uintptr_t operator[](uint32_t uIndex) const
+    {
+      uintptr_t results[3];
+      m_pInterp->GetResults(results);
+      if(m_bPop)
+      {
+        m_pInterp->accum[0] = results[0];
+        m_pInterp->accum[1] = results[1];
+      }
+      return results[uIndex];
+    }
+
+  private:
+    interp_hw_t *m_pInterp;
+    bool        m_bPop;
+  };
+
+  uintptr_t accum[2] = {};
+  uintptr_t base[3] = {};
+  uint32_t  ctrl[2] = {};
+  Results   pop{this, true};
+  Results   peek{this, false};
+
+  interp_hw_t(void) = default;
+  interp_hw_t(const interp_hw_t&) = delete;
+  interp_hw_t& operator = (const interp_hw_t&) = delete;
+
+  void GetResults(uintptr_t *pResults) const
+  {
+    uintptr_t shiftMasked[2];
+    for(int iLane = 0; iLane < 2; iLane++)
+    {
+      uint32_t uShift = ctrl[iLane] & SIO_INTERP0_CTRL_LANE0_SHIFT_BITS;
+      uint32_t uMaskLsb = (ctrl[iLane] & SIO_INTERP0_CTRL_LANE0_MASK_LSB_BITS) >> SIO_INTERP0_CTRL_LANE0_MASK_LSB_LSB;
+      uint32_t uMaskMsb = (ctrl[iLane] & SIO_INTERP0_CTRL_LANE0_MASK_MSB_BITS) >> SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB;
+      uint32_t uMask = (uint32_t)((0xffffffffull << uMaskLsb) & (0xffffffffull >> (31 - uMaskMsb)));
+
+      shiftMasked[iLane] = ((uint32_t)accum[iLane] >> uShift) & uMask;
+      pResults[iLane] = base[iLane] + ((ctrl[iLane] & SIO_INTERP0_CTRL_LANE0_ADD_RAW_BITS) ? accum[iLane] : shiftMasked[iLane]);
+    }
+    pResults[2] = base[2] + shiftMasked[0] + shiftMasked[1];
+  }
+};
+
+inline interp_hw_t hostInterps[2][2];
+
+#define interp0 (&hostInterps[get_core_num()][0])
+#define interp1 (&hostInterps[get_core_num()][1])
+
+static inline interp_config interp_default_config(void)
+{
+  interp_config config = {31u << SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB};
+  return config;
+}
+
+static inline void interp_config_set_shift(interp_config *c, uint shift)
+{
+  c->ctrl = (c->ctrl & ~SIO_INTERP0_CTRL_LANE0_SHIFT_BITS) | (shift << SIO_INTERP0_CTRL_LANE0_SHIFT_LSB);
+}
+
+static inline void interp_config_set_mask(interp_config *c, uint mask_lsb, uint mask_msb)
+{
+  c->ctrl = (c->ctrl & ~(SIO_INTERP0_CTRL_LANE0_MASK_LSB_BITS | SIO_INTERP0_CTRL_LANE0_MASK_MSB_BITS)) |
+            (mask_lsb << SIO_INTERP0_CTRL_LANE0_MASK_LSB_LSB) | (mask_msb << SIO_INTERP0_CTRL_LANE0_MASK_MSB_LSB);
+}
+
+static inline void interp_config_set_add_raw(interp_config *c, bool add_raw)
+{
+  c->ctrl = add_raw ? c->ctrl | SIO_INTERP0_CTRL_LANE0_ADD_RAW_BITS : c->ctrl & ~SIO_INTERP0_CTRL_LANE0_ADD_RAW_BITS;
+}
+
+static inline void interp_set_config(interp_hw_t *interp, uint lane, interp_config *config)
+{
+  interp->ctrl[lane] = config->ctrl;
+}
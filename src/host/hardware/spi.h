@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for hardware/spi.h, only the instances are needed for SPIPins
+
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct spi_inst spi_inst_t;
+
+extern spi_inst_t *spi0;
+extern spi_inst_t *spi1;
+
+#ifdef __cplusplus
+}
+#endif
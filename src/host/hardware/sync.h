@@ -0,0 +1,21 @@
+#pragma once
+
+// Host stand-in for hardware/sync.h, barriers are fences and there are no interrupts
+
+#include <atomic>
+
+#include "pico.h"
+
+static inline void __dmb(void)
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+static inline uint32_t save_and_disable_interrupts(void)
+{
+  return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+}
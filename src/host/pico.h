@@ -0,0 +1,17 @@
+#pragma once
+
+// Host stand-in for pico.h, the basic types and section macros
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#ifndef _u
+#define _u(x) x ## u
+#endif
+
+#define __not_in_flash_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
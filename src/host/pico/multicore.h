@@ -0,0 +1,51 @@
+#pragma once
+
+// Host stand-in for pico_multicore, core 1 is a thread and the inter-core
+// FIFOs are a pair of queues
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "pico/stdlib.h"
+
+struct HostFifo
+{
+  std::mutex              mutex;
+  std::condition_variable ready;
+  std::deque<uint32_t>    data;
+};
+
+// FIFO read by each core, never destroyed as core 1 may still be waiting on it at exit
+inline HostFifo *hostFifos = new HostFifo[2];
+
+static inline void multicore_launch_core1(void (*entry)(void))
+{
+  std::thread([entry]()
+  {
+    hostCoreNum = 1;
+    entry();
+  }).detach();
+}
+
+static inline void multicore_fifo_push_blocking(uint32_t data)
+{
+  HostFifo &fifo = hostFifos[!hostCoreNum];
+  {
+    std::lock_guard<std::mutex> lock(fifo.mutex);
+    fifo.data.push_back(data);
+  }
+  fifo.ready.notify_one();
+}
+
+static inline uint32_t multicore_fifo_pop_blocking(void)
+{
+  HostFifo &fifo = hostFifos[hostCoreNum];
+  std::unique_lock<std::mutex> lock(fifo.mutex);
+  fifo.ready.wait(lock, [&fifo]() { return !fifo.data.empty(); });
+
+  uint32_t data = fifo.data.front();
+  fifo.data.pop_front();
+  return data;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Host stand-in for the parts of the Pico SDK stdlib used by the examples
+
+#include "pico.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hardware/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint64_t absolute_time_t;
+
+// Microseconds since the program started
+uint64_t time_us_64(void);
+
+static inline uint32_t time_us_32(void)
+{
+  return (uint32_t)time_us_64();
+}
+
+static inline absolute_time_t get_absolute_time(void)
+{
+  return time_us_64();
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t)
+{
+  return (uint32_t)(t / 1000);
+}
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+static inline bool set_sys_clock_khz(uint32_t freq_khz, bool required)
+{
+  return true;
+}
+
+static inline bool stdio_init_all(void)
+{
+  return true;
+}
+
+static inline void tight_loop_contents(void)
+{
+}
+
+#ifdef __cplusplus
+}
+
+// Core the calling thread runs as, core 1 is a thread started by multicore_launch_core1()
+inline thread_local uint hostCoreNum = 0;
+
+static inline uint get_core_num(void)
+{
+  return hostCoreNum;
+}
+#endif